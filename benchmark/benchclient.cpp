@@ -0,0 +1,20 @@
+#include "benchclient.h"
+
+#include <QPainter>
+
+BenchClient::BenchClient(int index)
+    : m_index(index)
+{
+    setTitle(QStringLiteral("bench client %1").arg(index));
+    resize(320, 240);
+}
+
+void BenchClient::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+    p.fillRect(QRect(QPoint(), size()), QColor::fromHsv((m_index * 37 + m_frame) % 360, 160, 200));
+    p.drawText(QRect(QPoint(), size()), Qt::AlignCenter, QString::number(m_frame));
+    ++m_frame;
+    // throttled by the compositor's frame callbacks
+    update();
+}
@@ -0,0 +1,25 @@
+#ifndef BENCHCLIENT_H
+#define BENCHCLIENT_H
+
+#include <QRasterWindow>
+
+/*!
+    A synthetic Wayland client for the benchmark: a window which repaints
+    on every frame callback, so that the compositor always has new content
+    to show, and which follows whatever size the compositor configures.
+*/
+class BenchClient : public QRasterWindow
+{
+    Q_OBJECT
+public:
+    explicit BenchClient(int index);
+
+protected:
+    void paintEvent(QPaintEvent *event) Q_DECL_OVERRIDE;
+
+protected:
+    int m_index;
+    int m_frame = 0;
+};
+
+#endif // BENCHCLIENT_H
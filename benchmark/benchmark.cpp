@@ -0,0 +1,230 @@
+#include "benchmark.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QTextStream>
+
+#include <algorithm>
+
+// beyond the storm itself: startup, waiting for the clients, writing the results
+static const int TimeoutMarginMs = 60000;
+
+Benchmark::Benchmark(const Options &options)
+    : m_options(options)
+{
+    m_dir.setAutoRemove(!options.keepFiles);
+    m_compositor.setProcessChannelMode(QProcess::ForwardedChannels);
+    connect(&m_compositor, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &Benchmark::onCompositorFinished);
+    m_socketPoll.setInterval(50);
+    connect(&m_socketPoll, &QTimer::timeout, this, &Benchmark::onSocketPoll);
+    m_memoryPoll.setInterval(250);
+    connect(&m_memoryPoll, &QTimer::timeout, this, &Benchmark::onMemoryPoll);
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(options.duration * 1000 + TimeoutMarginMs);
+    connect(&m_timeout, &QTimer::timeout, this, &Benchmark::onTimeout);
+}
+
+bool Benchmark::start()
+{
+    if (!m_dir.isValid() || !writeConfig())
+        return false;
+    if (m_options.keepFiles)
+        qDebug() << "config, stats and trace are in" << m_dir.path();
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    if (m_options.headless) {
+        env.insert(QStringLiteral("QT_QPA_PLATFORM"), QStringLiteral("offscreen"));
+        env.insert(QStringLiteral("QT_QUICK_BACKEND"), QStringLiteral("software"));
+    }
+    m_compositor.setProcessEnvironment(env);
+    QStringList args;
+    args << QStringLiteral("-w") << QStringLiteral("-c") << m_dir.path()
+         << QStringLiteral("--stats") << path("stats.json")
+         << QStringLiteral("--trace") << path("trace.json")
+         << QStringLiteral("--wayland-socket-name") << m_options.socketName;
+    m_clock.start();
+    m_compositor.start(m_options.compositor, args);
+    if (!m_compositor.waitForStarted()) {
+        qWarning() << "failed to start" << m_options.compositor << m_compositor.errorString();
+        return false;
+    }
+    m_socketPoll.start();
+    m_memoryPoll.start();
+    m_timeout.start();
+    return true;
+}
+
+bool Benchmark::writeConfig()
+{
+    QFile templateFile(QStringLiteral(":/storm.qml"));
+    if (!templateFile.open(QIODevice::ReadOnly))
+        return false;
+    QString qml = QString::fromUtf8(templateFile.readAll());
+    qml.replace(QLatin1String("@CLIENTS@"), QString::number(m_options.clients));
+    qml.replace(QLatin1String("@DURATION@"), QString::number(m_options.duration * 1000));
+    const char *storms[] = { "move", "resize", "raise" };
+    for (const char *storm : storms) {
+        const bool on = m_options.storms.contains(QLatin1String(storm)) || m_options.storms.contains(QLatin1String("all"));
+        qml.replace(QLatin1Char('@') + QString::fromLatin1(storm).toUpper() + QLatin1Char('@'),
+                    on ? QLatin1String("true") : QLatin1String("false"));
+    }
+    QFile f(path("screen.qml"));
+    if (!f.open(QIODevice::WriteOnly) || f.write(qml.toUtf8()) < 0) {
+        qWarning() << "failed to write" << f.fileName() << f.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Benchmark::onSocketPoll()
+{
+    const QString runtimeDir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (!QFileInfo::exists(runtimeDir + QLatin1Char('/') + m_options.socketName))
+        return;
+    m_socketPoll.stop();
+    qDebug() << "compositor is listening after" << m_clock.elapsed() << "ms; starting" << m_options.clients << "clients";
+    startClients();
+}
+
+void Benchmark::startClients()
+{
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("WAYLAND_DISPLAY"), m_options.socketName);
+    env.insert(QStringLiteral("QT_QPA_PLATFORM"), QStringLiteral("wayland"));
+    env.insert(QStringLiteral("QT_WAYLAND_DISABLE_WINDOWDECORATION"), QStringLiteral("1"));
+    for (int i = 0; i < m_options.clients; ++i) {
+        // half of them on each shell which the compositor supports
+        env.insert(QStringLiteral("QT_WAYLAND_SHELL_INTEGRATION"),
+                   i % 2 ? QStringLiteral("xdg-shell-v5") : QStringLiteral("wl-shell"));
+        QProcess *client = new QProcess(this);
+        client->setProcessEnvironment(env);
+        client->setProcessChannelMode(QProcess::ForwardedChannels);
+        client->start(QCoreApplication::applicationFilePath(),
+                      QStringList() << QStringLiteral("--client") << QString::number(i));
+        m_clients << client;
+    }
+}
+
+void Benchmark::stopClients()
+{
+    for (QProcess *client : m_clients) {
+        client->terminate();
+        if (!client->waitForFinished(1000))
+            client->kill();
+    }
+    qDeleteAll(m_clients);
+    m_clients.clear();
+}
+
+void Benchmark::onMemoryPoll()
+{
+    QFile f(QStringLiteral("/proc/%1/status").arg(m_compositor.processId()));
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+    QTextStream ts(&f);
+    for (QString line = ts.readLine(); !line.isNull(); line = ts.readLine()) {
+        // e.g. "VmRSS:	  123456 kB"
+        if (line.startsWith(QLatin1String("VmRSS:")))
+            m_lastRssKiB = line.mid(6).trimmed().section(QLatin1Char(' '), 0, 0).toLongLong();
+        else if (line.startsWith(QLatin1String("VmHWM:")))
+            m_peakRssKiB = line.mid(6).trimmed().section(QLatin1Char(' '), 0, 0).toLongLong();
+    }
+}
+
+void Benchmark::onTimeout()
+{
+    qWarning() << "the compositor did not finish in time; killing it";
+    m_timedOut = true;
+    m_compositor.kill();
+}
+
+void Benchmark::onCompositorFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    m_socketPoll.stop();
+    m_memoryPoll.stop();
+    m_timeout.stop();
+    stopClients();
+    if (exitStatus != QProcess::NormalExit || exitCode != 0 || m_timedOut) {
+        qWarning() << "the compositor failed: exit code" << exitCode << "status" << exitStatus;
+        QCoreApplication::exit(1);
+        return;
+    }
+
+    const QJsonObject result = report();
+    const QByteArray json = QJsonDocument(result).toJson();
+    if (m_options.reportPath.isEmpty()) {
+        QTextStream(stdout) << json;
+    } else {
+        QFile f(m_options.reportPath);
+        if (!f.open(QIODevice::WriteOnly) || f.write(json) < 0)
+            qWarning() << "failed to write" << m_options.reportPath << f.errorString();
+    }
+    QCoreApplication::exit(0);
+}
+
+QJsonObject Benchmark::readJson(const QString &path) const
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "failed to read" << path << f.errorString();
+        return QJsonObject();
+    }
+    return QJsonDocument::fromJson(f.readAll()).object();
+}
+
+QJsonObject Benchmark::report() const
+{
+    QJsonObject ret;
+    ret.insert(QStringLiteral("clients"), m_options.clients);
+    ret.insert(QStringLiteral("duration"), m_options.duration);
+    ret.insert(QStringLiteral("storms"), QJsonArray::fromStringList(m_options.storms));
+    ret.insert(QStringLiteral("rssKiB"), m_lastRssKiB);
+    ret.insert(QStringLiteral("peakRssKiB"), m_peakRssKiB);
+
+    // startup: from main() to the first frame on any screen; and how long each phase took
+    const QJsonArray events = readJson(path("trace.json")).value(QStringLiteral("traceEvents")).toArray();
+    qint64 mainStart = -1;
+    qint64 firstFrame = -1;
+    QJsonObject phases;
+    for (const QJsonValue &v : events) {
+        const QJsonObject e = v.toObject();
+        const QString name = e.value(QStringLiteral("name")).toString();
+        const qint64 ts = qint64(e.value(QStringLiteral("ts")).toDouble());
+        if (name == QLatin1String("create QGuiApplication"))
+            mainStart = ts;
+        else if (name.startsWith(QLatin1String("first frame on")) && (firstFrame < 0 || ts < firstFrame))
+            firstFrame = ts;
+        if (e.value(QStringLiteral("ph")).toString() == QLatin1String("X"))
+            phases.insert(name, e.value(QStringLiteral("dur")).toDouble() / 1000);
+    }
+    if (mainStart >= 0 && firstFrame >= 0)
+        ret.insert(QStringLiteral("startupMs"), double(firstFrame - mainStart) / 1000);
+    ret.insert(QStringLiteral("phasesMs"), phases);
+
+    // frame statistics cover the storm only, because the storm begins with Instrumentation.reset()
+    const QJsonObject stats = readJson(path("stats.json"));
+    QJsonArray outputs;
+    for (const QJsonValue &v : stats.value(QStringLiteral("outputs")).toArray()) {
+        const QJsonObject o = v.toObject();
+        const QJsonObject interval = o.value(QStringLiteral("frameInterval")).toObject();
+        QJsonObject out;
+        out.insert(QStringLiteral("name"), o.value(QStringLiteral("name")));
+        out.insert(QStringLiteral("fps"), o.value(QStringLiteral("frames")).toDouble() / m_options.duration);
+        out.insert(QStringLiteral("frameTimeP50"), interval.value(QStringLiteral("p50")));
+        out.insert(QStringLiteral("frameTimeP99"), interval.value(QStringLiteral("p99")));
+        out.insert(QStringLiteral("frameTimeMax"), interval.value(QStringLiteral("max")));
+        out.insert(QStringLiteral("renderTimeP99"), o.value(QStringLiteral("renderTime")).toObject().value(QStringLiteral("p99")));
+        out.insert(QStringLiteral("missedVsyncs"), o.value(QStringLiteral("missedVsyncs")));
+        outputs << out;
+    }
+    ret.insert(QStringLiteral("outputs"), outputs);
+    ret.insert(QStringLiteral("surfaceCount"), stats.value(QStringLiteral("surfaceCount")));
+    ret.insert(QStringLiteral("textureBytes"), stats.value(QStringLiteral("textureBytes")));
+    return ret;
+}
@@ -0,0 +1,65 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QProcess>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTimer>
+
+/*!
+    Runs the compositor with a generated config whose screen.qml drives a
+    storm of moves, resizes and raises over a number of synthetic clients,
+    then reports startup time, frame rate, frame time percentiles and memory
+    use, from the compositor's --stats and --trace output and from /proc.
+*/
+class Benchmark : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        QString compositor;
+        QString socketName;
+        QString reportPath;
+        QStringList storms;
+        int clients = 8;
+        int duration = 20; // seconds
+        bool headless = false;
+        bool keepFiles = false;
+    };
+
+    explicit Benchmark(const Options &options);
+
+    bool start();
+
+protected slots:
+    void onSocketPoll();
+    void onMemoryPoll();
+    void onCompositorFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onTimeout();
+
+protected:
+    bool writeConfig();
+    void startClients();
+    void stopClients();
+    QJsonObject report() const;
+    QJsonObject readJson(const QString &path) const;
+    QString path(const char *fileName) const { return m_dir.path() + QLatin1Char('/') + QLatin1String(fileName); }
+
+protected:
+    Options m_options;
+    QTemporaryDir m_dir;
+    QProcess m_compositor;
+    QList<QProcess *> m_clients;
+    QTimer m_socketPoll;
+    QTimer m_memoryPoll;
+    QTimer m_timeout;
+    QElapsedTimer m_clock;
+    qint64 m_peakRssKiB = 0;
+    qint64 m_lastRssKiB = 0;
+    bool m_timedOut = false;
+};
+
+#endif // BENCHMARK_H
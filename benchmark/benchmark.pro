@@ -0,0 +1,15 @@
+QT += gui
+QMAKE_CXXFLAGS += -std=c++11
+TARGET = ../grefsen-bench
+
+SOURCES += *.cpp
+
+HEADERS += *.h
+
+OTHER_FILES = storm.qml
+
+RESOURCES += benchmark.qrc
+
+OBJECTS_DIR = .obj
+MOC_DIR = .moc
+RCC_DIR = .rcc
@@ -0,0 +1,77 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QGuiApplication>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchclient.h"
+#include "benchmark.h"
+
+int main(int argc, char *argv[])
+{
+    // grefsen-bench --client <n> is what the benchmark runs as each synthetic client
+    if (argc == 3 && !strcmp(argv[1], "--client")) {
+        QGuiApplication app(argc, argv);
+        BenchClient window(atoi(argv[2]));
+        window.show();
+        return app.exec();
+    }
+
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark for the Grefsen compositor: starts it with a number of "
+                                     "synthetic clients, moves, resizes and raises them as fast as it can, "
+                                     "and reports startup time, frame times and memory use as JSON");
+    parser.addHelpOption();
+
+    QCommandLineOption compositorOption(QStringList() << "compositor",
+            QCoreApplication::translate("main", "the compositor executable (default: grefsen beside this one)"),
+            QCoreApplication::translate("main", "path"));
+    parser.addOption(compositorOption);
+    QCommandLineOption clientsOption(QStringList() << "n" << "clients",
+            QCoreApplication::translate("main", "number of clients (default 8)"),
+            QCoreApplication::translate("main", "count"), QStringLiteral("8"));
+    parser.addOption(clientsOption);
+    QCommandLineOption durationOption(QStringList() << "d" << "duration",
+            QCoreApplication::translate("main", "how long the storm lasts (default 20)"),
+            QCoreApplication::translate("main", "seconds"), QStringLiteral("20"));
+    parser.addOption(durationOption);
+    QCommandLineOption stormOption(QStringList() << "storm",
+            QCoreApplication::translate("main", "what to do to the windows: move, resize, raise or all (default); may be repeated"),
+            QCoreApplication::translate("main", "kind"));
+    parser.addOption(stormOption);
+    QCommandLineOption headlessOption(QStringList() << "headless",
+            QCoreApplication::translate("main", "run the compositor on the offscreen platform with the software renderer, "
+                                                "if this Qt build supports that; otherwise it opens a window"));
+    parser.addOption(headlessOption);
+    QCommandLineOption socketOption(QStringList() << "wayland-socket-name",
+            QCoreApplication::translate("main", "Wayland socket for the compositor (default grefsen-bench)"),
+            QCoreApplication::translate("main", "name"), QStringLiteral("grefsen-bench"));
+    parser.addOption(socketOption);
+    QCommandLineOption reportOption(QStringList() << "o" << "output",
+            QCoreApplication::translate("main", "write the report to a file rather than stdout"),
+            QCoreApplication::translate("main", "file path"));
+    parser.addOption(reportOption);
+    QCommandLineOption keepOption(QStringList() << "keep",
+            QCoreApplication::translate("main", "keep the generated config, statistics and trace"));
+    parser.addOption(keepOption);
+    parser.process(app);
+
+    Benchmark::Options options;
+    options.compositor = parser.isSet(compositorOption) ? parser.value(compositorOption)
+                                                        : app.applicationDirPath() + QLatin1String("/grefsen");
+    options.clients = qMax(1, parser.value(clientsOption).toInt());
+    options.duration = qMax(1, parser.value(durationOption).toInt());
+    options.storms = parser.isSet(stormOption) ? parser.values(stormOption) : QStringList(QStringLiteral("all"));
+    options.headless = parser.isSet(headlessOption);
+    options.socketName = parser.value(socketOption);
+    options.reportPath = parser.value(reportOption);
+    options.keepFiles = parser.isSet(keepOption);
+
+    Benchmark benchmark(options);
+    if (!benchmark.start())
+        return 1;
+    return app.exec();
+}
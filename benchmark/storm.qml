@@ -0,0 +1,77 @@
+import QtQuick 2.6
+import QtQuick.Window 2.2
+import com.theqtcompany.wlcompositor 1.0
+
+// screen.qml for grefsen-bench: the @...@ placeholders are filled in by the benchmark
+Rectangle {
+    id: root
+    color: "#204060"
+
+    property int clients: @CLIENTS@
+    property int duration: @DURATION@ // ms
+    property bool moveStorm: @MOVE@
+    property bool resizeStorm: @RESIZE@
+    property bool raiseStorm: @RAISE@
+    property bool driving: false
+    property int tick: 0
+    // with several screens, only the first one drives the storm
+    readonly property bool primary: Screen.name === Qt.application.screens[0].name
+
+    Instantiator {
+        id: windows
+        model: WindowStack.altTabModel
+        delegate: QtObject { property QtObject window: model.window }
+    }
+
+    Timer {
+        id: settleTimer
+        running: root.primary
+        interval: 250
+        repeat: true
+        property int waited: 0
+        onTriggered: {
+            waited += interval
+            // wait for all clients, but not forever
+            if (windows.count < root.clients && waited < 20000)
+                return
+            stop()
+            Tracer.instant("storm started with " + windows.count + " windows")
+            Instrumentation.reset()
+            root.driving = true
+            stopTimer.start()
+        }
+    }
+
+    Timer {
+        id: stopTimer
+        interval: root.duration
+        onTriggered: {
+            Tracer.instant("storm finished")
+            Qt.quit()
+        }
+    }
+
+    Timer {
+        running: root.driving
+        interval: 16
+        repeat: true
+        onTriggered: {
+            ++root.tick
+            for (var i = 0; i < windows.count; ++i) {
+                var views = WindowStack.views(windows.objectAt(i).window)
+                for (var v = 0; v < views.length; ++v) {
+                    var chrome = views[v]
+                    var phase = (root.tick + i * 13) / 20
+                    if (root.moveStorm && chrome.moveItem) {
+                        chrome.moveItem.x = (root.width - chrome.width) * (0.5 + 0.5 * Math.sin(phase))
+                        chrome.moveItem.y = (root.height - chrome.height) * (0.5 + 0.5 * Math.cos(phase * 0.7))
+                    }
+                    if (root.resizeStorm && (root.tick + i) % 4 == 0)
+                        chrome.requestSize(320 + 160 * Math.sin(phase), 240 + 120 * Math.cos(phase))
+                }
+            }
+            if (root.raiseStorm && windows.count > 0)
+                WindowStack.raise(windows.objectAt(root.tick % windows.count).window)
+        }
+    }
+}
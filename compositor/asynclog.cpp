@@ -0,0 +1,220 @@
+#include "asynclog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+AsyncLog *AsyncLog::s_instance = 0;
+
+static const int FlushSpinLimit = 1000;
+
+// snprintf is not async-signal-safe
+static size_t formatUnsigned(char *out, quint64 value)
+{
+    char digits[24];
+    size_t n = 0;
+    do {
+        digits[n++] = char('0' + value % 10);
+        value /= 10;
+    } while (value);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = digits[n - 1 - i];
+    return n;
+}
+
+AsyncLog::AsyncLog(const QString &path, qint64 rotateSize)
+    : m_path(path.toLocal8Bit())
+    , m_rotateSize(rotateSize)
+    , m_slots(new Slot[SlotCount])
+    , m_enqueuePos(0)
+    , m_dequeuePos(0)
+    , m_dropped(0)
+    , m_writerSleeping(false)
+    , m_quit(false)
+{
+    for (size_t i = 0; i < SlotCount; ++i)
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    m_fd = ::open(m_path.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        fprintf(stderr, "failed to open log file %s: %s\n", m_path.constData(), strerror(errno));
+        return;
+    }
+    sem_init(&m_wakeup, 0, 0);
+    s_instance = this;
+    m_writer = std::thread(&AsyncLog::run, this);
+}
+
+AsyncLog::~AsyncLog()
+{
+    if (m_writer.joinable()) {
+        m_quit.store(true);
+        sem_post(&m_wakeup);
+        m_writer.join();
+        sem_destroy(&m_wakeup);
+    }
+    if (s_instance == this)
+        s_instance = 0;
+    if (m_fd >= 0) {
+        drain(false);
+        ::close(m_fd);
+    }
+    delete[] m_slots;
+}
+
+void AsyncLog::append(const char *prefix, const char *text, int length)
+{
+    if (m_fd < 0)
+        return;
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &m_slots[pos % SlotCount];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // leave room for the newline, and for "..." if truncated
+    const int room = SlotDataSize - 1;
+    int n = qMin(int(strlen(prefix)), room);
+    memcpy(slot->data, prefix, n);
+    if (length > room - n) {
+        const int keep = qMax(0, room - n - 3);
+        memcpy(slot->data + n, text, keep);
+        memcpy(slot->data + n + keep, "...", 3);
+        n += keep + 3;
+    } else {
+        memcpy(slot->data + n, text, length);
+        n += length;
+    }
+    slot->data[n++] = '\n';
+    slot->length = n;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // wake the writer only if it's asleep, to avoid a syscall per message
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_writerSleeping.load(std::memory_order_relaxed) && m_writerSleeping.exchange(false))
+        sem_post(&m_wakeup);
+}
+
+void AsyncLog::flush()
+{
+    if (m_fd < 0)
+        return;
+    // the writer thread may be in the middle of a batch; let it finish
+    for (int i = 0; i < FlushSpinLimit; ++i) {
+        if (drain(false))
+            return;
+        sched_yield();
+    }
+}
+
+void AsyncLog::run()
+{
+    while (!m_quit.load()) {
+        drain(true);
+        m_writerSleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!isEmpty() || m_quit.load()) {
+            m_writerSleeping.store(false);
+            continue;
+        }
+        // the timeout is only a safety net
+        timespec timeout;
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_sec += 1;
+        while (sem_timedwait(&m_wakeup, &timeout) == -1 && errno == EINTR)
+            ;
+        m_writerSleeping.store(false);
+    }
+}
+
+bool AsyncLog::isEmpty() const
+{
+    const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    const size_t sequence = m_slots[pos % SlotCount].sequence.load(std::memory_order_acquire);
+    return intptr_t(sequence) - intptr_t(pos + 1) < 0;
+}
+
+bool AsyncLog::drain(bool mayRotate)
+{
+    if (m_draining.test_and_set(std::memory_order_acquire))
+        return false;
+    size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    size_t used = 0;
+    for (;;) {
+        const quint64 dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped) {
+            static const char before[] = "[... ";
+            static const char after[] = " messages dropped]\n";
+            if (used + sizeof(before) + sizeof(after) + 24 > BufferSize) {
+                writeOut(m_buffer, used, mayRotate);
+                used = 0;
+            }
+            memcpy(m_buffer + used, before, sizeof(before) - 1);
+            used += sizeof(before) - 1;
+            used += formatUnsigned(m_buffer + used, dropped);
+            memcpy(m_buffer + used, after, sizeof(after) - 1);
+            used += sizeof(after) - 1;
+        }
+
+        Slot &slot = m_slots[pos % SlotCount];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (intptr_t(sequence) - intptr_t(pos + 1) < 0)
+            break;
+        if (used + slot.length > BufferSize) {
+            writeOut(m_buffer, used, mayRotate);
+            used = 0;
+        }
+        memcpy(m_buffer + used, slot.data, slot.length);
+        used += slot.length;
+        slot.sequence.store(pos + SlotCount, std::memory_order_release);
+        m_dequeuePos.store(++pos, std::memory_order_relaxed);
+    }
+    if (used)
+        writeOut(m_buffer, used, mayRotate);
+    m_draining.clear(std::memory_order_release);
+    return true;
+}
+
+void AsyncLog::writeOut(const char *data, size_t length, bool mayRotate)
+{
+    if (mayRotate && m_rotateSize > 0 && m_written > 0 && m_written + qint64(length) > m_rotateSize)
+        rotate();
+    while (length > 0) {
+        const ssize_t n = ::write(m_fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return; // nowhere left to complain to
+        }
+        data += n;
+        length -= n;
+        m_written += n;
+    }
+}
+
+void AsyncLog::rotate()
+{
+    const QByteArray rotated = m_path + ".1";
+    if (::rename(m_path.constData(), rotated.constData()) != 0)
+        return; // keep appending to the current file
+    const int fd = ::open(m_path.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return;
+    ::close(m_fd);
+    m_fd = fd;
+    m_written = 0;
+}
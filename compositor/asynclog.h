@@ -0,0 +1,72 @@
+#ifndef ASYNCLOG_H
+#define ASYNCLOG_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+#include <semaphore.h>
+#include <thread>
+
+/*!
+    Log file writer which doesn't block the threads that log.
+
+    append() copies the message into a slot of a bounded lock-free ring
+    buffer (a Vyukov MPSC queue) and returns; a writer thread drains the ring
+    and writes it out in large batches.  If the ring is full the message is
+    dropped and counted, and the count is written to the log once there is
+    room again.  Messages longer than a slot are truncated.
+
+    flush() drains the ring on the calling thread and is async-signal-safe,
+    so it may be used before abort() or from a crash handler.  If
+    rotateSize is nonzero, the file is renamed to <path>.1 (replacing any
+    previous one) when it would grow beyond that many bytes.
+*/
+class AsyncLog
+{
+public:
+    explicit AsyncLog(const QString &path, qint64 rotateSize = 0);
+    ~AsyncLog();
+
+    bool isOpen() const { return m_fd >= 0; }
+    void append(const char *prefix, const char *text, int length);
+    void flush();
+
+    static AsyncLog *instance() { return s_instance; }
+
+private:
+    enum { SlotCount = 512, SlotDataSize = 1016, BufferSize = 64 * 1024 };
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        int length;
+        char data[SlotDataSize];
+    };
+
+    void run();
+    bool isEmpty() const;
+    bool drain(bool mayRotate);
+    void writeOut(const char *data, size_t length, bool mayRotate);
+    void rotate();
+
+    static AsyncLog *s_instance;
+
+    QByteArray m_path;
+    qint64 m_rotateSize;
+    qint64 m_written = 0;
+    int m_fd = -1;
+
+    Slot *m_slots;
+    std::atomic<size_t> m_enqueuePos;
+    std::atomic<size_t> m_dequeuePos; // advanced only while holding m_draining
+    std::atomic_flag m_draining = ATOMIC_FLAG_INIT;
+    std::atomic<quint64> m_dropped;
+    char m_buffer[BufferSize]; // guarded by m_draining
+
+    sem_t m_wakeup;
+    std::atomic<bool> m_writerSleeping;
+    std::atomic<bool> m_quit;
+    std::thread m_writer;
+};
+
+#endif // ASYNCLOG_H
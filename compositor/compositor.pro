@@ -1,4 +1,4 @@
-QT += gui qml quick
+QT += dbus gui qml quick waylandcompositor
 CONFIG += link_pkgconfig
 QMAKE_CXXFLAGS += -std=c++11
 TARGET = ../grefsen
@@ -7,19 +7,30 @@ SOURCES += *.cpp
 
 HEADERS += *.h
 
+# Chrome uses the plugin's glyph provider, but doesn't import the plugin
+INCLUDEPATH += ../imports/Grefsen
+SOURCES += ../imports/Grefsen/glyphprovider.cpp
+HEADERS += ../imports/Grefsen/glyphprovider.h
+
 INCLUDEPATH += /usr/include/glib-2.0 /usr/lib/glib-2.0/include
 
 OTHER_FILES = \
     qml/main.qml \
     qml/Screen.qml \
-    qml/Chrome.qml
+    qml/Chrome.qml \
+    qml/AltTabSwitcher.qml \
+    qml/StatsOverlay.qml
 
 RESOURCES += grefsen.qrc
 
+# QML in resources is not cached on disk at runtime, so compile it ahead of
+# time where the Qt Quick Compiler (qmlcachegen since Qt 5.11) is available
+exists($$[QT_HOST_DATA]/mkspecs/features/qtquickcompiler.prf): CONFIG += qtquickcompiler
+
 OBJECTS_DIR = .obj
 MOC_DIR = .moc
 RCC_DIR = .rcc
 
-PKGCONFIG += glib-2.0
+PKGCONFIG += egl fontconfig glib-2.0 wayland-server
 
 sources.files = $$SOURCES $$HEADERS $$RESOURCES $$FORMS grefsen.pro
@@ -0,0 +1,313 @@
+#include "damagetracker.h"
+
+#include <QDebug>
+#include <QMetaProperty>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QScreen>
+#include <QWaylandQuickItem>
+#include <QWaylandSurface>
+
+#include <algorithm>
+#include <string.h>
+
+// after the Qt headers: the EGL headers may pull in Xlib, which defines None, Bool etc.
+#define MESA_EGL_NO_X11_HEADERS
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_BUFFER_AGE_KHR
+#define EGL_BUFFER_AGE_KHR 0x313D
+#endif
+
+typedef EGLBoolean (EGLAPIENTRYP SetDamageRegion)(EGLDisplay, EGLSurface, EGLint *, EGLint);
+
+static bool partialUpdate = false;
+static bool flashRepaints = false;
+static SetDamageRegion setDamageRegion = 0;
+
+// for antialiasing, and drawing a little outside the bounds, such as the glow of a Decoration
+static const qreal ContentMargin = 4;
+// how many frames of damage to remember; older back buffers are repainted completely
+static const int MaxBufferAge = 4;
+// beyond this many rectangles, the bounding rectangle is damaged instead
+static const int MaxDamageRects = 32;
+
+DamageTracker::DamageTracker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void DamageTracker::setPartialUpdate(bool enabled)
+{
+    partialUpdate = enabled;
+}
+
+void DamageTracker::setFlashRepaints(bool enabled)
+{
+    flashRepaints = enabled;
+}
+
+void DamageTracker::setWindow(QQuickWindow *window)
+{
+    if (m_window == window)
+        return;
+    if (m_window)
+        disconnect(m_window, 0, this, 0);
+    m_window = window;
+    m_damageAll = true;
+    if (window && partialUpdate) {
+        // like OcclusionCuller: the GUI thread is blocked during beforeSynchronizing
+        connect(window, &QQuickWindow::beforeSynchronizing, this,
+                [this]() { onBeforeSynchronizing(); }, Qt::DirectConnection);
+        connect(window, &QQuickWindow::beforeRendering, this,
+                [this]() { onBeforeRendering(); }, Qt::DirectConnection);
+        connect(window, &QQuickWindow::afterRendering, this,
+                [this]() { onAfterRendering(); }, Qt::DirectConnection);
+    }
+    emit windowChanged();
+}
+
+void DamageTracker::setFullDamage(bool full)
+{
+    if (m_fullDamage == full)
+        return;
+    m_fullDamage = full;
+    // the frame which takes the overlay away must repaint what it covered
+    m_damageAll = true;
+    emit fullDamageChanged();
+}
+
+void DamageTracker::damageAll()
+{
+    m_damageAll = true;
+    if (m_window)
+        m_window->update();
+}
+
+void DamageTracker::onContentChanged()
+{
+    m_contentChanged.insert(sender());
+}
+
+void DamageTracker::watchContent(QQuickItem *item)
+{
+    if (m_watched.contains(item))
+        return;
+    m_watched.insert(item);
+    connect(item, &QObject::destroyed, this, [this](QObject *object) {
+        m_watched.remove(object);
+        m_contentChanged.remove(object);
+        // forget its state too, so that an item created at the same address is watched again
+        auto it = m_items.find(static_cast<const QQuickItem *>(object));
+        if (it != m_items.end()) {
+            m_lostRects << it->rect;
+            m_items.erase(it);
+        }
+    });
+    // the properties of QQuickItem itself are geometry, which is compared anyway
+    static const QMetaMethod slot = staticMetaObject.method(staticMetaObject.indexOfSlot("onContentChanged()"));
+    const QMetaObject *mo = item->metaObject();
+    for (int i = QQuickItem::staticMetaObject.propertyCount(); i < mo->propertyCount(); ++i) {
+        const QMetaProperty property = mo->property(i);
+        if (property.hasNotifySignal())
+            connect(item, property.notifySignal(), this, slot);
+    }
+}
+
+void DamageTracker::watchSurface(QQuickItem *item, QWaylandSurface *surface)
+{
+    SurfaceWatch &watch = m_surfaces[item];
+    if (watch.surface == surface)
+        return;
+    disconnect(watch.connection);
+    watch.surface = surface;
+    if (surface) {
+        watch.connection = connect(surface, &QWaylandSurface::damaged, this, [this, item](const QRegion &region) {
+            m_surfaceDamage[item] += region;
+        });
+    }
+}
+
+void DamageTracker::addDamage(const QRectF &rect)
+{
+    const qreal dpr = m_window->effectiveDevicePixelRatio();
+    const QRectF scaled(rect.x() * dpr, rect.y() * dpr, rect.width() * dpr, rect.height() * dpr);
+    m_frameDamage += scaled.toAlignedRect() & QRect(QPoint(), m_bufferSize);
+}
+
+void DamageTracker::collectDamage(QQuickItem *item, qreal opacity, const QQuickItem **paintedAfter)
+{
+    // a hidden item isn't seen, so it damages where it was
+    if (!item->isVisible())
+        return;
+    opacity *= item->opacity();
+    if (opacity <= 0)
+        return;
+
+    // the paint order: children with negative z, the item, the other children; each by z, then in order
+    QList<QQuickItem *> children = item->childItems();
+    std::stable_sort(children.begin(), children.end(),
+                     [](QQuickItem *a, QQuickItem *b) { return a->z() < b->z(); });
+    auto child = children.constBegin();
+    for (; child != children.constEnd() && (*child)->z() < 0; ++child)
+        collectDamage(*child, opacity, paintedAfter);
+
+    if (item->flags() & QQuickItem::ItemHasContents) {
+        const QRectF rect = item->mapRectToScene(item->boundingRect()).adjusted(
+                -ContentMargin, -ContentMargin, ContentMargin, ContentMargin);
+        auto it = m_items.find(item);
+        if (it == m_items.end()) {
+            addDamage(rect);
+            it = m_items.insert(item, ItemState());
+            if (!qobject_cast<QWaylandQuickItem *>(item))
+                watchContent(item);
+        } else if (it->rect != rect || !qFuzzyCompare(it->opacity, opacity) ||
+                   it->paintedAfter != *paintedAfter || m_contentChanged.contains(item)) {
+            addDamage(it->rect);
+            addDamage(rect);
+        }
+        if (QWaylandQuickItem *surfaceItem = qobject_cast<QWaylandQuickItem *>(item)) {
+            QWaylandSurface *surface = surfaceItem->surface();
+            watchSurface(item, surface);
+            const QRegion damage = m_surfaceDamage.take(item);
+            if (surface && !damage.isEmpty() && !surface->size().isEmpty()) {
+                const qreal sx = item->width() / surface->size().width();
+                const qreal sy = item->height() / surface->size().height();
+                for (const QRect &r : damage.rects())
+                    addDamage(item->mapRectToScene(QRectF(r.x() * sx, r.y() * sy, r.width() * sx, r.height() * sy)));
+            }
+        }
+        it->rect = rect;
+        it->opacity = opacity;
+        it->paintedAfter = *paintedAfter;
+        it->seen = true;
+        *paintedAfter = item;
+    }
+
+    for (; child != children.constEnd(); ++child)
+        collectDamage(*child, opacity, paintedAfter);
+}
+
+void DamageTracker::onBeforeSynchronizing()
+{
+    if (!m_window || (m_eglChecked && !m_eglUsable))
+        return;
+    const QSize size = m_window->size() * m_window->effectiveDevicePixelRatio();
+    if (size != m_bufferSize) {
+        m_bufferSize = size;
+        m_damageAll = true;
+    }
+    for (const QRectF &rect : m_lostRects)
+        addDamage(rect);
+    m_lostRects.clear();
+    const QQuickItem *paintedAfter = 0;
+    collectDamage(m_window->contentItem(), 1, &paintedAfter);
+    for (auto it = m_items.begin(); it != m_items.end(); ) {
+        if (it->seen) {
+            it->seen = false;
+            ++it;
+            continue;
+        }
+        // destroyed or hidden; the pointer may be dangling
+        addDamage(it->rect);
+        auto surface = m_surfaces.find(it.key());
+        if (surface != m_surfaces.end()) {
+            disconnect(surface->connection);
+            m_surfaces.erase(surface);
+        }
+        it = m_items.erase(it);
+    }
+    m_contentChanged.clear();
+    m_surfaceDamage.clear();
+    if (m_damageAll || m_fullDamage) {
+        m_frameDamage = QRect(QPoint(), m_bufferSize);
+        m_damageAll = false;
+    }
+}
+
+bool DamageTracker::initEgl()
+{
+    if (m_eglChecked)
+        return m_eglUsable;
+    m_eglChecked = true;
+    EGLDisplay display = eglGetCurrentDisplay();
+    const char *extensions = display != EGL_NO_DISPLAY ? eglQueryString(display, EGL_EXTENSIONS) : 0;
+    if (!extensions || !strstr(extensions, "EGL_KHR_partial_update")) {
+        qWarning("partial updates need EGL_KHR_partial_update; repainting whole frames");
+        return false;
+    }
+    if (!setDamageRegion)
+        setDamageRegion = reinterpret_cast<SetDamageRegion>(eglGetProcAddress("eglSetDamageRegionKHR"));
+    m_eglUsable = setDamageRegion;
+    if (m_eglUsable)
+        qDebug() << "partial updates on" << (m_window->screen() ? m_window->screen()->name() : QString());
+    return m_eglUsable;
+}
+
+void DamageTracker::onBeforeRendering()
+{
+    // the damage region has to be set before anything is drawn in the frame
+    if (!m_window || !initEgl())
+        return;
+    const QRegion damage = m_frameDamage;
+    m_frameDamage = QRegion();
+    const QRect full(QPoint(), m_bufferSize);
+    // what differs from the last frame; including what was flashed there
+    const QRegion changes = damage + m_flashed;
+    // rendering although nothing seems to have changed: something changed without telling
+    const bool unknown = changes.isEmpty();
+    const QRegion frameChanges = unknown ? QRegion(full) : changes;
+
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+    EGLint age = 0;
+    if (!eglQuerySurface(display, surface, EGL_BUFFER_AGE_KHR, &age))
+        age = 0;
+    QRegion repaint = frameChanges;
+    bool whole = unknown || age <= 0 || age - 1 > m_history.count();
+    for (int i = 0; !whole && i < age - 1; ++i)
+        repaint += m_history.at(i);
+    const QRect bounds = repaint.boundingRect();
+    if (qint64(bounds.width()) * bounds.height() * 4 > qint64(full.width()) * full.height() * 3)
+        whole = true;
+
+    m_history.prepend(frameChanges);
+    if (m_history.count() > MaxBufferAge)
+        m_history.removeLast();
+
+    if (!whole) {
+        QVector<QRect> rects = repaint.rects();
+        if (rects.count() > MaxDamageRects)
+            rects = QVector<QRect>() << bounds;
+        QVector<EGLint> eglRects;
+        eglRects.reserve(rects.count() * 4);
+        for (const QRect &r : rects) {
+            // EGL has the origin at the bottom left
+            eglRects << r.x() << m_bufferSize.height() - r.y() - r.height() << r.width() << r.height();
+        }
+        if (!setDamageRegion(display, surface, eglRects.data(), rects.count()))
+            qWarning("eglSetDamageRegionKHR failed: 0x%x", eglGetError());
+    }
+
+    m_flashed = flashRepaints ? (unknown ? QRegion(full) : damage) : QRegion();
+}
+
+void DamageTracker::onAfterRendering()
+{
+    if (m_flashed.isEmpty())
+        return;
+    QOpenGLFunctions *gl = QOpenGLContext::currentContext()->functions();
+    gl->glEnable(GL_SCISSOR_TEST);
+    gl->glClearColor(1, 0, 1, 1);
+    for (const QRect &r : m_flashed.rects()) {
+        gl->glScissor(r.x(), m_bufferSize.height() - r.y() - r.height(), r.width(), r.height());
+        gl->glClear(GL_COLOR_BUFFER_BIT);
+    }
+    gl->glDisable(GL_SCISSOR_TEST);
+    // another frame to take the flash away
+    QMetaObject::invokeMethod(m_window, "update", Qt::QueuedConnection);
+}
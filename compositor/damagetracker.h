@@ -0,0 +1,116 @@
+#ifndef DAMAGETRACKER_H
+#define DAMAGETRACKER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QRectF>
+#include <QRegion>
+#include <QSet>
+#include <QSize>
+#include <QVector>
+
+class QQuickItem;
+class QQuickWindow;
+class QWaylandSurface;
+
+/*!
+    Lets an output repaint only what changed, with EGL_KHR_partial_update.
+
+    Each frame, while the GUI thread is blocked for the sync, the item tree
+    of the window is compared with the frame before: an item with content
+    which moved, was resized or transformed, was shown or hidden, changed
+    its opacity or its place in the paint order, or was created or
+    destroyed, damages where it was and where it is now.  So do changes of
+    the notify-able properties of such items (a Text's text, a Rectangle's
+    color, a Decoration's glow), and the regions clients damage on their
+    surfaces (wl_surface.damage), mapped into the window.  The window
+    position of the Chrome items, the cursor and the panels and popovers
+    on the glassPane are all covered by this.
+
+    Before rendering, the damage of as many previous frames as the back
+    buffer's age is added, and the total is given to eglSetDamageRegionKHR;
+    the GPU then only needs to read and write that part of the buffer.
+    The whole window is repainted if the buffer age is unknown, if
+    fullDamage is set (while a live ShaderEffectSource is shown, say),
+    if more than most of the window changed anyway, or if the window
+    rendered although nothing detectably changed: some content, such as
+    a Canvas, changes without telling.
+
+    Partial repaints are off unless setPartialUpdate(true) was called
+    (--partial-update); also if the EGL implementation lacks the
+    extension.  With setFlashRepaints(true) (--flash-repaints) each
+    repainted region is filled with magenta for one frame.
+*/
+class DamageTracker : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickWindow *window READ window WRITE setWindow NOTIFY windowChanged)
+    Q_PROPERTY(bool fullDamage READ fullDamage WRITE setFullDamage NOTIFY fullDamageChanged)
+
+public:
+    explicit DamageTracker(QObject *parent = 0);
+
+    static void setPartialUpdate(bool enabled);
+    static void setFlashRepaints(bool enabled);
+
+    QQuickWindow *window() const { return m_window; }
+    void setWindow(QQuickWindow *window);
+
+    bool fullDamage() const { return m_fullDamage; }
+    void setFullDamage(bool full);
+
+    Q_INVOKABLE void damageAll();
+
+signals:
+    void windowChanged();
+    void fullDamageChanged();
+
+protected slots:
+    void onContentChanged();
+
+protected:
+    struct ItemState {
+        QRectF rect; // in window coordinates
+        qreal opacity = 1;
+        const QQuickItem *paintedAfter = 0;
+        bool seen = false;
+    };
+
+    struct SurfaceWatch {
+        QPointer<QWaylandSurface> surface;
+        QMetaObject::Connection connection;
+    };
+
+    void onBeforeSynchronizing();
+    void onBeforeRendering();
+    void onAfterRendering();
+    void collectDamage(QQuickItem *item, qreal opacity, const QQuickItem **paintedAfter);
+    void watchContent(QQuickItem *item);
+    void watchSurface(QQuickItem *item, QWaylandSurface *surface);
+    void addDamage(const QRectF &rect);
+    bool initEgl();
+
+protected:
+    QPointer<QQuickWindow> m_window;
+    bool m_fullDamage = false;
+
+    // the item tree is only read while the GUI thread is blocked, so these need no lock
+    QHash<const QQuickItem *, ItemState> m_items;
+    QSet<const QObject *> m_watched; // content items with their notify signals connected
+    QSet<const QObject *> m_contentChanged;
+    QVector<QRectF> m_lostRects; // where destroyed content items were, damaged at the next sync
+    QHash<const QQuickItem *, SurfaceWatch> m_surfaces;
+    QHash<const QQuickItem *, QRegion> m_surfaceDamage; // in surface coordinates
+    bool m_damageAll = true;
+
+    // render thread
+    QRegion m_frameDamage; // in device pixels, top-left origin
+    QRegion m_flashed; // filled with magenta in the last frame
+    QVector<QRegion> m_history; // damage of the previous frames, most recent first
+    QSize m_bufferSize;
+    bool m_eglChecked = false;
+    bool m_eglUsable = false;
+};
+
+#endif // DAMAGETRACKER_H
@@ -0,0 +1,244 @@
+#include "decorationitem.h"
+
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+#include <QtMath>
+
+static const int CornerSegments = 4;
+static const int PerimeterPoints = 4 * (CornerSegments + 1);
+static const int FillVertices = 3 * PerimeterPoints;
+static const int BorderVertices = 6 * PerimeterPoints;
+static const int TitlebarVertices = 6;
+static const int GlowVertices = 9 * 6; // the inner rectangle, and four edges and four corners fading out
+static const int VertexCount = FillVertices + BorderVertices + TitlebarVertices + GlowVertices;
+
+typedef QSGGeometry::ColoredPoint2D Vertex;
+
+// QSGVertexColorMaterial wants premultiplied colors
+static void setVertex(Vertex *&v, const QPointF &p, const QColor &c, qreal opacity = 1)
+{
+    const qreal a = c.alphaF() * opacity;
+    v->set(p.x(), p.y(), uchar(c.red() * a), uchar(c.green() * a), uchar(c.blue() * a), uchar(a * 255));
+    ++v;
+}
+
+static void addQuad(Vertex *&v, const QPointF &p0, const QColor &c0, const QPointF &p1, const QColor &c1,
+                    const QPointF &p2, const QColor &c2, const QPointF &p3, const QColor &c3, qreal opacity = 1)
+{
+    setVertex(v, p0, c0, opacity);
+    setVertex(v, p1, c1, opacity);
+    setVertex(v, p2, c2, opacity);
+    setVertex(v, p0, c0, opacity);
+    setVertex(v, p2, c2, opacity);
+    setVertex(v, p3, c3, opacity);
+}
+
+// clockwise from the left end of the top left corner
+static void roundedRectPerimeter(const QRectF &rect, qreal radius, QPointF *points)
+{
+    radius = qMax(qreal(0), qMin(radius, qMin(rect.width(), rect.height()) / 2));
+    const QPointF centers[4] = {
+        QPointF(rect.left() + radius, rect.top() + radius),
+        QPointF(rect.right() - radius, rect.top() + radius),
+        QPointF(rect.right() - radius, rect.bottom() - radius),
+        QPointF(rect.left() + radius, rect.bottom() - radius)
+    };
+    int i = 0;
+    for (int corner = 0; corner < 4; ++corner) {
+        const qreal start = M_PI * (1 + corner * 0.5);
+        for (int s = 0; s <= CornerSegments; ++s) {
+            const qreal angle = start + M_PI_2 * s / CornerSegments;
+            points[i++] = centers[corner] + QPointF(qCos(angle), qSin(angle)) * radius;
+        }
+    }
+}
+
+static QSGVertexColorMaterial *sharedMaterial()
+{
+    // never deleted: nodes of any window may be using it until exit
+    static QSGVertexColorMaterial *ret = new QSGVertexColorMaterial;
+    return ret;
+}
+
+DecorationItem::DecorationItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
+}
+
+void DecorationItem::setColor(const QColor &value)
+{
+    if (m_color == value)
+        return;
+    m_color = value;
+    emit colorChanged();
+    update();
+}
+
+void DecorationItem::setBorderColor(const QColor &value)
+{
+    if (m_borderColor == value)
+        return;
+    m_borderColor = value;
+    emit borderColorChanged();
+    update();
+}
+
+void DecorationItem::setBorderWidth(qreal value)
+{
+    if (m_borderWidth == value)
+        return;
+    m_borderWidth = value;
+    emit borderWidthChanged();
+    update();
+}
+
+void DecorationItem::setRadius(qreal value)
+{
+    if (m_radius == value)
+        return;
+    m_radius = value;
+    emit radiusChanged();
+    update();
+}
+
+void DecorationItem::setTitlebarRect(const QRectF &value)
+{
+    if (m_titlebarRect == value)
+        return;
+    m_titlebarRect = value;
+    emit titlebarRectChanged();
+    update();
+}
+
+void DecorationItem::setTitlebarTopColor(const QColor &value)
+{
+    if (m_titlebarTopColor == value)
+        return;
+    m_titlebarTopColor = value;
+    emit titlebarColorsChanged();
+    update();
+}
+
+void DecorationItem::setTitlebarBottomColor(const QColor &value)
+{
+    if (m_titlebarBottomColor == value)
+        return;
+    m_titlebarBottomColor = value;
+    emit titlebarColorsChanged();
+    update();
+}
+
+void DecorationItem::setGlowRect(const QRectF &value)
+{
+    if (m_glowRect == value)
+        return;
+    m_glowRect = value;
+    emit glowRectChanged();
+    update();
+}
+
+void DecorationItem::setGlowRadius(qreal value)
+{
+    if (m_glowRadius == value)
+        return;
+    m_glowRadius = value;
+    emit glowRadiusChanged();
+    update();
+}
+
+void DecorationItem::setGlowColor(const QColor &value)
+{
+    if (m_glowColor == value)
+        return;
+    m_glowColor = value;
+    emit glowColorChanged();
+    update();
+}
+
+void DecorationItem::setGlowOpacity(qreal value)
+{
+    if (m_glowOpacity == value)
+        return;
+    m_glowOpacity = value;
+    emit glowOpacityChanged();
+    update();
+}
+
+void DecorationItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size())
+        update();
+}
+
+QSGNode *DecorationItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QSGGeometryNode *node = static_cast<QSGGeometryNode *>(oldNode);
+    if (!node) {
+        node = new QSGGeometryNode;
+        QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), VertexCount);
+        geometry->setDrawingMode(GL_TRIANGLES);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(sharedMaterial());
+    }
+    fillGeometry(node->geometry());
+    node->markDirty(QSGNode::DirtyGeometry);
+    return node;
+}
+
+void DecorationItem::fillGeometry(QSGGeometry *geometry) const
+{
+    Vertex *v = geometry->vertexDataAsColoredPoint2D();
+    const QRectF outer(0, 0, width(), height());
+    const qreal bw = qMin(m_borderWidth, qMin(width(), height()) / 2);
+    const QRectF inner = outer.adjusted(bw, bw, -bw, -bw);
+
+    QPointF outerPoints[PerimeterPoints];
+    QPointF innerPoints[PerimeterPoints];
+    roundedRectPerimeter(outer, m_radius, outerPoints);
+    roundedRectPerimeter(inner, m_radius - bw, innerPoints);
+
+    // the inside as a fan around the center, not overlapping the border
+    const QPointF center = outer.center();
+    for (int i = 0; i < PerimeterPoints; ++i) {
+        const int next = (i + 1) % PerimeterPoints;
+        setVertex(v, center, m_color);
+        setVertex(v, innerPoints[i], m_color);
+        setVertex(v, innerPoints[next], m_color);
+    }
+    for (int i = 0; i < PerimeterPoints; ++i) {
+        const int next = (i + 1) % PerimeterPoints;
+        addQuad(v, outerPoints[i], m_borderColor, outerPoints[next], m_borderColor,
+                innerPoints[next], m_borderColor, innerPoints[i], m_borderColor);
+    }
+
+    const QRectF &t = m_titlebarRect;
+    addQuad(v, t.topLeft(), m_titlebarTopColor, t.topRight(), m_titlebarTopColor,
+            t.bottomRight(), m_titlebarBottomColor, t.bottomLeft(), m_titlebarBottomColor);
+
+    // a solid rectangle fading out to transparent over glowRadius around it
+    const QRectF &g = m_glowRect;
+    const QRectF o = g.isEmpty() ? g : g.adjusted(-m_glowRadius, -m_glowRadius, m_glowRadius, m_glowRadius);
+    const QColor &c = m_glowColor;
+    const QColor clear = Qt::transparent;
+    const qreal op = m_glowOpacity;
+    addQuad(v, g.topLeft(), c, g.topRight(), c, g.bottomRight(), c, g.bottomLeft(), c, op);
+    addQuad(v, QPointF(g.left(), o.top()), clear, QPointF(g.right(), o.top()), clear,
+            g.topRight(), c, g.topLeft(), c, op);
+    addQuad(v, g.topRight(), c, QPointF(o.right(), g.top()), clear,
+            QPointF(o.right(), g.bottom()), clear, g.bottomRight(), c, op);
+    addQuad(v, g.bottomLeft(), c, g.bottomRight(), c,
+            QPointF(g.right(), o.bottom()), clear, QPointF(g.left(), o.bottom()), clear, op);
+    addQuad(v, QPointF(o.left(), g.top()), clear, g.topLeft(), c,
+            g.bottomLeft(), c, QPointF(o.left(), g.bottom()), clear, op);
+    addQuad(v, o.topLeft(), clear, QPointF(g.left(), o.top()), clear,
+            g.topLeft(), c, QPointF(o.left(), g.top()), clear, op);
+    addQuad(v, QPointF(g.right(), o.top()), clear, o.topRight(), clear,
+            QPointF(o.right(), g.top()), clear, g.topRight(), c, op);
+    addQuad(v, g.bottomRight(), c, QPointF(o.right(), g.bottom()), clear,
+            o.bottomRight(), clear, QPointF(g.right(), o.bottom()), clear, op);
+    addQuad(v, QPointF(o.left(), g.bottom()), clear, g.bottomLeft(), c,
+            QPointF(g.left(), o.bottom()), clear, o.bottomLeft(), clear, op);
+}
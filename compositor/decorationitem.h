@@ -0,0 +1,95 @@
+#ifndef DECORATIONITEM_H
+#define DECORATIONITEM_H
+
+#include <QColor>
+#include <QQuickItem>
+#include <QRectF>
+
+class QSGGeometry;
+
+/*!
+    Draws a window frame: a rounded rectangle with a border, a titlebar with
+    a vertical gradient, and a glow behind the close button.
+
+    Everything is in one QSGGeometryNode with vertex colors, sharing a single
+    material between all decorations, so that the scene graph can batch
+    all window frames together.  The title text
+    and the close icon are not drawn by this item.  The vertex count is the
+    same for any size and shape, so updates never reallocate the geometry.
+*/
+class DecorationItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
+    Q_PROPERTY(QColor borderColor READ borderColor WRITE setBorderColor NOTIFY borderColorChanged)
+    Q_PROPERTY(qreal borderWidth READ borderWidth WRITE setBorderWidth NOTIFY borderWidthChanged)
+    Q_PROPERTY(qreal radius READ radius WRITE setRadius NOTIFY radiusChanged)
+    Q_PROPERTY(QRectF titlebarRect READ titlebarRect WRITE setTitlebarRect NOTIFY titlebarRectChanged)
+    Q_PROPERTY(QColor titlebarTopColor READ titlebarTopColor WRITE setTitlebarTopColor NOTIFY titlebarColorsChanged)
+    Q_PROPERTY(QColor titlebarBottomColor READ titlebarBottomColor WRITE setTitlebarBottomColor NOTIFY titlebarColorsChanged)
+    Q_PROPERTY(QRectF glowRect READ glowRect WRITE setGlowRect NOTIFY glowRectChanged)
+    Q_PROPERTY(qreal glowRadius READ glowRadius WRITE setGlowRadius NOTIFY glowRadiusChanged)
+    Q_PROPERTY(QColor glowColor READ glowColor WRITE setGlowColor NOTIFY glowColorChanged)
+    Q_PROPERTY(qreal glowOpacity READ glowOpacity WRITE setGlowOpacity NOTIFY glowOpacityChanged)
+
+public:
+    explicit DecorationItem(QQuickItem *parent = 0);
+
+    QColor color() const { return m_color; }
+    void setColor(const QColor &color);
+    QColor borderColor() const { return m_borderColor; }
+    void setBorderColor(const QColor &color);
+    qreal borderWidth() const { return m_borderWidth; }
+    void setBorderWidth(qreal width);
+    qreal radius() const { return m_radius; }
+    void setRadius(qreal radius);
+
+    QRectF titlebarRect() const { return m_titlebarRect; }
+    void setTitlebarRect(const QRectF &rect);
+    QColor titlebarTopColor() const { return m_titlebarTopColor; }
+    void setTitlebarTopColor(const QColor &color);
+    QColor titlebarBottomColor() const { return m_titlebarBottomColor; }
+    void setTitlebarBottomColor(const QColor &color);
+
+    QRectF glowRect() const { return m_glowRect; }
+    void setGlowRect(const QRectF &rect);
+    qreal glowRadius() const { return m_glowRadius; }
+    void setGlowRadius(qreal radius);
+    QColor glowColor() const { return m_glowColor; }
+    void setGlowColor(const QColor &color);
+    qreal glowOpacity() const { return m_glowOpacity; }
+    void setGlowOpacity(qreal opacity);
+
+signals:
+    void colorChanged();
+    void borderColorChanged();
+    void borderWidthChanged();
+    void radiusChanged();
+    void titlebarRectChanged();
+    void titlebarColorsChanged();
+    void glowRectChanged();
+    void glowRadiusChanged();
+    void glowColorChanged();
+    void glowOpacityChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) Q_DECL_OVERRIDE;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) Q_DECL_OVERRIDE;
+
+    void fillGeometry(QSGGeometry *geometry) const;
+
+protected:
+    QColor m_color = QColor::fromRgba(0x50ffffffu);
+    QColor m_borderColor = QColor::fromRgba(0x305070a0u);
+    qreal m_borderWidth = 1;
+    qreal m_radius = 0;
+    QRectF m_titlebarRect;
+    QColor m_titlebarTopColor = QColor::fromRgba(0x50ffffffu);
+    QColor m_titlebarBottomColor = QColor::fromRgba(0xe0ffffffu);
+    QRectF m_glowRect;
+    qreal m_glowRadius = 5;
+    QColor m_glowColor = Qt::red;
+    qreal m_glowOpacity = 0;
+};
+
+#endif // DECORATIONITEM_H
@@ -0,0 +1,90 @@
+#include "framecallbackpolicy.h"
+
+#include <QWaylandSurface>
+
+FrameCallbackPolicy *FrameCallbackPolicy::instance()
+{
+    static FrameCallbackPolicy *ret = new FrameCallbackPolicy;
+    return ret;
+}
+
+FrameCallbackPolicy::FrameCallbackPolicy()
+{
+    m_modes[Visible] = EveryFrame;
+    m_modes[Occluded] = Throttled;
+    m_modes[Hidden] = Suspended;
+}
+
+FrameCallbackPolicy::Mode FrameCallbackPolicy::mode(Visibility visibility) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_modes[visibility];
+}
+
+void FrameCallbackPolicy::setMode(Visibility visibility, Mode mode)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_modes[visibility] == mode)
+            return;
+        m_modes[visibility] = mode;
+    }
+    emit modesChanged();
+}
+
+int FrameCallbackPolicy::throttledInterval() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_throttledInterval;
+}
+
+void FrameCallbackPolicy::setThrottledInterval(int ms)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_throttledInterval == ms)
+            return;
+        m_throttledInterval = ms;
+    }
+    emit throttledIntervalChanged();
+}
+
+void FrameCallbackPolicy::addSurface(QWaylandSurface *surface)
+{
+    if (!surface)
+        return;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_lastFrame.contains(surface))
+            return;
+        m_lastFrame.insert(surface, 0);
+    }
+    connect(surface, &QObject::destroyed, this, &FrameCallbackPolicy::onSurfaceDestroyed);
+}
+
+bool FrameCallbackPolicy::wantsFrame(QWaylandSurface *surface, Visibility visibility, qint64 now, int *retryIn)
+{
+    QMutexLocker lock(&m_mutex);
+    const Mode mode = m_modes[visibility];
+    if (mode == Suspended)
+        return false;
+    auto it = m_lastFrame.find(surface);
+    // surfaces which were not added are not throttled; there is nothing to remember them by
+    if (it == m_lastFrame.end())
+        return true;
+    if (mode == Throttled) {
+        const qint64 due = it.value() + m_throttledInterval;
+        if (now < due) {
+            *retryIn = qMin(*retryIn, int(due - now));
+            return false;
+        }
+    }
+    it.value() = now;
+    return true;
+}
+
+void FrameCallbackPolicy::onSurfaceDestroyed()
+{
+    QMutexLocker lock(&m_mutex);
+    m_lastFrame.remove(static_cast<QWaylandSurface *>(sender()));
+}
@@ -0,0 +1,86 @@
+#ifndef FRAMECALLBACKPOLICY_H
+#define FRAMECALLBACKPOLICY_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+
+class QWaylandSurface;
+
+/*!
+    Decides, per surface and per frame, whether a client gets its frame
+    callbacks.
+
+    A client which doesn't get a frame callback doesn't draw its next frame,
+    so this is how clients that nobody can see are kept from using power.
+    Each frame, OcclusionCuller classifies each surface in its output's
+    window as Visible, Occluded (covered by other windows) or Hidden (its
+    view is not visible), and asks wantsFrame(); the mode for that
+    visibility decides:
+
+    \list
+    \li EveryFrame: callbacks every frame the output renders
+    \li Throttled: at most one callback per throttledInterval ms
+    \li Suspended: no callbacks; the client only draws again when something
+        else (input, a configure, becoming visible) prompts it
+    \endlist
+
+    Surfaces are paced only by the output which has their primary view, and
+    not at all on outputs which are not rendering (powered off, say).  The
+    modes can be set from the config QML, e.g.
+    FrameCallbackPolicy.occludedMode = FrameCallbackPolicy.Suspended
+*/
+class FrameCallbackPolicy : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(Mode visibleMode READ visibleMode WRITE setVisibleMode NOTIFY modesChanged)
+    Q_PROPERTY(Mode occludedMode READ occludedMode WRITE setOccludedMode NOTIFY modesChanged)
+    Q_PROPERTY(Mode hiddenMode READ hiddenMode WRITE setHiddenMode NOTIFY modesChanged)
+    Q_PROPERTY(int throttledInterval READ throttledInterval WRITE setThrottledInterval NOTIFY throttledIntervalChanged)
+
+public:
+    enum Mode { EveryFrame, Throttled, Suspended };
+    Q_ENUM(Mode)
+
+    enum Visibility { Visible, Occluded, Hidden };
+    Q_ENUM(Visibility)
+
+    static FrameCallbackPolicy *instance();
+
+    Mode visibleMode() const { return mode(Visible); }
+    void setVisibleMode(Mode mode) { setMode(Visible, mode); }
+    Mode occludedMode() const { return mode(Occluded); }
+    void setOccludedMode(Mode mode) { setMode(Occluded, mode); }
+    Mode hiddenMode() const { return mode(Hidden); }
+    void setHiddenMode(Mode mode) { setMode(Hidden, mode); }
+
+    int throttledInterval() const;
+    void setThrottledInterval(int ms);
+
+    // on the GUI thread, when the surface is created (WaylandCompositor.surfaceCreated)
+    Q_INVOKABLE void addSurface(QWaylandSurface *surface);
+
+    // thread-safe: called from render threads.  If the answer is no, but
+    // it would be yes later, *retryIn is lowered to the ms until then.
+    bool wantsFrame(QWaylandSurface *surface, Visibility visibility, qint64 now, int *retryIn);
+
+signals:
+    void modesChanged();
+    void throttledIntervalChanged();
+
+protected slots:
+    void onSurfaceDestroyed();
+
+protected:
+    FrameCallbackPolicy();
+    Mode mode(Visibility visibility) const;
+    void setMode(Visibility visibility, Mode mode);
+
+protected:
+    mutable QMutex m_mutex; // guards everything below: QML sets the modes while render threads read them
+    QHash<QWaylandSurface *, qint64> m_lastFrame; // ms
+    Mode m_modes[3];
+    int m_throttledInterval = 1000;
+};
+
+#endif // FRAMECALLBACKPOLICY_H
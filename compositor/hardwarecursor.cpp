@@ -0,0 +1,163 @@
+#include "hardwarecursor.h"
+
+#include <QCursor>
+#include <QGuiApplication>
+#include <QPixmap>
+#include <QScreen>
+#include <QWaylandBufferRef>
+#include <QWaylandSeat>
+#include <QWaylandSurface>
+
+// the usual size of a KMS cursor plane; Qt's eglfs cursor doesn't scale larger images down
+static const int MaxKmsCursorSize = 64;
+
+static bool softwareOnly = false;
+
+HardwareCursor *HardwareCursor::instance()
+{
+    static HardwareCursor *ret = new HardwareCursor;
+    return ret;
+}
+
+HardwareCursor::HardwareCursor()
+    : m_cursor(Qt::ArrowCursor)
+    , m_active(!softwareOnly && platformHasCursor())
+{
+    m_frameTimer.setSingleShot(true);
+    connect(&m_frameTimer, &QTimer::timeout, this, &HardwareCursor::sendFrameCallbacks);
+}
+
+void HardwareCursor::setSoftwareOnly(bool software)
+{
+    softwareOnly = software;
+}
+
+bool HardwareCursor::platformHasCursor()
+{
+    const QString platform = QGuiApplication::platformName();
+    // nested: the host's cursor
+    if (platform == QLatin1String("xcb") || platform.startsWith(QLatin1String("wayland")))
+        return true;
+    if (platform != QLatin1String("eglfs") || qEnvironmentVariableIntValue("QT_QPA_EGLFS_HIDECURSOR"))
+        return false;
+    // the other eglfs backends draw the cursor with OpenGL, rendering the whole window again
+    const QByteArray integration = qgetenv("QT_QPA_EGLFS_INTEGRATION");
+    return integration.isEmpty() || integration.startsWith("eglfs_kms");
+}
+
+void HardwareCursor::addItem(QQuickItem *item)
+{
+    if (!item || m_items.contains(item))
+        return;
+    m_items << item;
+    if (m_active)
+        item->setCursor(m_cursor);
+}
+
+void HardwareCursor::setSeat(QWaylandSeat *seat)
+{
+    if (m_seat == seat)
+        return;
+    if (m_seat)
+        disconnect(m_seat, 0, this, 0);
+    m_seat = seat;
+    if (seat && m_active) {
+        connect(seat, &QWaylandSeat::cursorSurfaceRequest, this, &HardwareCursor::onCursorSurfaceRequest);
+        connect(seat, &QWaylandSeat::mouseFocusChanged, this, &HardwareCursor::onMouseFocusChanged);
+    }
+    emit seatChanged();
+}
+
+void HardwareCursor::setActive(bool active)
+{
+    if (m_active == active)
+        return;
+    m_active = active;
+    // WaylandMouseTracker hides the window system cursor while that is disabled
+    if (!active)
+        applyCursor(QCursor(Qt::BlankCursor));
+    emit activeChanged();
+}
+
+void HardwareCursor::applyCursor(const QCursor &cursor)
+{
+    m_cursor = cursor;
+    for (int i = m_items.count() - 1; i >= 0; --i) {
+        if (QQuickItem *item = m_items.at(i))
+            item->setCursor(cursor);
+        else
+            m_items.remove(i); // its screen has gone
+    }
+}
+
+void HardwareCursor::onCursorSurfaceRequest(QWaylandSurface *surface, int hotspotX, int hotspotY)
+{
+    if (m_surface)
+        disconnect(m_surface, 0, this, 0);
+    m_surface = surface;
+    m_hotspot = QPoint(hotspotX, hotspotY);
+    m_view.setSurface(surface);
+    if (!surface) {
+        // the client hides the cursor
+        applyCursor(QCursor(Qt::BlankCursor));
+        setActive(true);
+        return;
+    }
+    connect(surface, &QWaylandSurface::redraw, this, &HardwareCursor::onRedraw);
+    // the buffer may have been committed before the request
+    onRedraw();
+}
+
+void HardwareCursor::onMouseFocusChanged(QWaylandView *newFocus)
+{
+    // over the compositor's own items, nobody else sets a cursor
+    if (!newFocus) {
+        if (m_surface)
+            disconnect(m_surface, 0, this, 0);
+        m_surface = 0;
+        m_view.setSurface(0);
+        applyCursor(QCursor(Qt::ArrowCursor));
+        setActive(true);
+    }
+}
+
+void HardwareCursor::onRedraw()
+{
+    if (!m_surface)
+        return;
+    m_view.advance();
+    QWaylandBufferRef buffer = m_view.currentBuffer();
+    if (!buffer.hasBuffer()) {
+        applyCursor(QCursor(Qt::BlankCursor));
+        setActive(true);
+    } else if (!buffer.isSharedMemory()) {
+        // an EGL buffer would have to be read back from the GPU
+        setActive(false);
+    } else {
+        const QImage image = buffer.image();
+        if (QGuiApplication::platformName() == QLatin1String("eglfs") &&
+                (image.width() > MaxKmsCursorSize || image.height() > MaxKmsCursorSize)) {
+            setActive(false);
+        } else {
+            // fromImage copies, so the client can reuse its buffer
+            QPixmap pixmap = QPixmap::fromImage(image);
+            pixmap.setDevicePixelRatio(m_surface->bufferScale());
+            applyCursor(QCursor(pixmap, m_hotspot.x(), m_hotspot.y()));
+            setActive(true);
+        }
+    }
+    // there is no frame to wait for, but animated cursors shouldn't go faster than one
+    if (!m_frameTimer.isActive()) {
+        const QScreen *screen = QGuiApplication::primaryScreen();
+        const qreal refreshRate = screen && screen->refreshRate() > 1 ? screen->refreshRate() : 60;
+        m_frameTimer.start(qMax(1, qRound(1000 / refreshRate)));
+    }
+}
+
+void HardwareCursor::sendFrameCallbacks()
+{
+    if (!m_surface)
+        return;
+    m_surface->frameStarted();
+    m_surface->sendFrameCallbacks();
+}
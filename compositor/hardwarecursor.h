@@ -0,0 +1,80 @@
+#ifndef HARDWARECURSOR_H
+#define HARDWARECURSOR_H
+
+#include <QCursor>
+#include <QPointer>
+#include <QQuickItem>
+#include <QTimer>
+#include <QVector>
+#include <QWaylandView>
+
+class QWaylandSeat;
+class QWaylandSurface;
+
+/*!
+    Shows the clients' cursor surfaces with the platform's cursor.
+
+    On eglfs with KMS that is the cursor plane, and on a nested session the
+    host's cursor; either way the platform moves it straight from its input
+    handling, so moving the mouse doesn't make the window render at all.
+    Each new buffer of the cursor surface which the seat's mouse focus asked
+    for is copied into a QCursor, once, which is set on every item added
+    with addItem() (the WaylandMouseTracker which covers each output).  Over
+    the compositor's own UI, where no client has mouse focus, the arrow is
+    shown.  There is one for all outputs, and its seat is set once.
+
+    No frame is rendered for the cursor, so its frame callbacks are sent
+    from a timer at the primary screen's refresh rate after each commit;
+    a client animating its cursor goes no faster than that.
+
+    active is false when the cursor can't be shown this way: on platforms
+    without a hardware cursor, for buffers which are not in shared memory,
+    for cursors too large for a KMS cursor plane, or when
+    setSoftwareOnly(true) was called (--software-cursor).  A
+    WaylandCursorItem should then show it instead.
+*/
+class HardwareCursor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QWaylandSeat *seat READ seat WRITE setSeat NOTIFY seatChanged)
+    Q_PROPERTY(bool active READ isActive NOTIFY activeChanged)
+
+public:
+    static HardwareCursor *instance();
+    static void setSoftwareOnly(bool softwareOnly);
+
+    Q_INVOKABLE void addItem(QQuickItem *item);
+
+    QWaylandSeat *seat() const { return m_seat; }
+    void setSeat(QWaylandSeat *seat);
+
+    bool isActive() const { return m_active; }
+
+signals:
+    void seatChanged();
+    void activeChanged();
+
+protected slots:
+    void onCursorSurfaceRequest(QWaylandSurface *surface, int hotspotX, int hotspotY);
+    void onMouseFocusChanged(QWaylandView *newFocus);
+    void onRedraw();
+    void sendFrameCallbacks();
+
+protected:
+    HardwareCursor();
+    static bool platformHasCursor();
+    void setActive(bool active);
+    void applyCursor(const QCursor &cursor);
+
+protected:
+    QVector<QPointer<QQuickItem> > m_items;
+    QCursor m_cursor;
+    QPointer<QWaylandSeat> m_seat;
+    QPointer<QWaylandSurface> m_surface;
+    QWaylandView m_view; // of the cursor surface, to get at its buffers
+    QPoint m_hotspot;
+    QTimer m_frameTimer;
+    bool m_active = false;
+};
+
+#endif // HARDWARECURSOR_H
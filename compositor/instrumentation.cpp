@@ -0,0 +1,381 @@
+#include "instrumentation.h"
+#include "outputscheduler.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonDocument>
+#include <QQuickWindow>
+#include <QSaveFile>
+#include <QScreen>
+#include <QWaylandClient>
+#include <QWaylandSurface>
+
+#include <algorithm>
+#include <string.h>
+
+static const int TickInterval = 1000; // ms
+static const int DumpEveryTicks = 10;
+// a gap of more than this many refresh periods is idle time, not missed frames
+static const int IdleFrameGap = 4;
+
+void DurationHistogram::add(qreal ms)
+{
+    const int bucket = qBound(0, int(ms * 1000 / BucketMicroseconds), int(BucketCount));
+    ++m_buckets[bucket];
+    ++m_count;
+    m_max = qMax(m_max, ms);
+}
+
+void DurationHistogram::reset()
+{
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_count = 0;
+    m_max = 0;
+}
+
+qreal DurationHistogram::percentile(qreal p) const
+{
+    if (!m_count)
+        return 0;
+    const quint64 rank = qMax(quint64(1), quint64(p * m_count / 100 + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank)
+            return qreal(i + 1) * BucketMicroseconds / 1000; // upper edge of the bucket
+    }
+    return m_max;
+}
+
+QVariantMap DurationHistogram::toVariantMap() const
+{
+    QVariantMap ret;
+    ret.insert(QStringLiteral("count"), m_count);
+    ret.insert(QStringLiteral("p50"), percentile(50));
+    ret.insert(QStringLiteral("p95"), percentile(95));
+    ret.insert(QStringLiteral("p99"), percentile(99));
+    ret.insert(QStringLiteral("max"), m_max);
+    return ret;
+}
+
+Instrumentation *Instrumentation::instance()
+{
+    static Instrumentation *ret = new Instrumentation;
+    return ret;
+}
+
+Instrumentation::Instrumentation()
+{
+    m_clock.start();
+    m_tickTimer.setInterval(TickInterval);
+    connect(&m_tickTimer, &QTimer::timeout, this, &Instrumentation::onTick);
+}
+
+void Instrumentation::setOverlayVisible(bool visible)
+{
+    if (m_overlayVisible == visible)
+        return;
+    m_overlayVisible = visible;
+    updateCollecting();
+    emit overlayVisibleChanged();
+}
+
+void Instrumentation::setStatsFilePath(const QString &path)
+{
+    m_statsFilePath = path;
+    updateCollecting();
+}
+
+void Instrumentation::updateCollecting()
+{
+    const bool collecting = isCollecting();
+    if (collecting && !m_tickTimer.isActive())
+        m_tickTimer.start();
+    else if (!collecting)
+        m_tickTimer.stop();
+    for (OutputStats *stats : qAsConst(m_outputs)) {
+        if (collecting && stats->connections.isEmpty() && stats->window)
+            watch(stats);
+        else if (!collecting)
+            unwatch(stats);
+    }
+}
+
+void Instrumentation::addWindow(QQuickWindow *window)
+{
+    OutputStats *stats = new OutputStats;
+    stats->window = window;
+    if (QScreen *screen = window->screen()) {
+        stats->name = screen->name();
+        if (screen->refreshRate() > 1)
+            stats->refreshRate = screen->refreshRate();
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        m_outputs << stats;
+    }
+    connect(window, &QWindow::screenChanged, this, [this, stats](QScreen *screen) {
+        QMutexLocker lock(&m_mutex);
+        stats->name = screen ? screen->name() : QString();
+        if (screen && screen->refreshRate() > 1)
+            stats->refreshRate = screen->refreshRate();
+    });
+    if (isCollecting())
+        watch(stats);
+}
+
+void Instrumentation::watch(OutputStats *stats)
+{
+    QQuickWindow *window = stats->window;
+    // the rendering signals may come from the render thread
+    stats->connections << connect(window, &QQuickWindow::beforeRendering, this,
+            [this, stats]() { onBeforeRendering(stats); }, Qt::DirectConnection);
+    stats->connections << connect(window, &QQuickWindow::afterRendering, this,
+            [this, stats]() { onAfterRendering(stats); }, Qt::DirectConnection);
+    stats->connections << connect(window, &QQuickWindow::frameSwapped, this,
+            [this, stats]() { onFrameSwapped(stats); }, Qt::DirectConnection);
+    window->installEventFilter(this);
+}
+
+void Instrumentation::unwatch(OutputStats *stats)
+{
+    if (stats->connections.isEmpty())
+        return;
+    for (const QMetaObject::Connection &connection : qAsConst(stats->connections))
+        disconnect(connection);
+    stats->connections.clear();
+    if (stats->window)
+        stats->window->removeEventFilter(this);
+    // otherwise the pause would count as a frame interval, and so on, once watched again
+    QMutexLocker lock(&m_mutex);
+    stats->lastSwapNs = 0;
+    stats->renderStartNs = 0;
+    stats->inputPendingNs = 0;
+}
+
+void Instrumentation::onBeforeRendering(OutputStats *stats)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    QMutexLocker lock(&m_mutex);
+    stats->renderStartNs = now;
+}
+
+void Instrumentation::onAfterRendering(OutputStats *stats)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    QMutexLocker lock(&m_mutex);
+    if (stats->renderStartNs)
+        stats->renderTime.add((now - stats->renderStartNs) / 1e6);
+    stats->renderStartNs = 0;
+}
+
+void Instrumentation::onFrameSwapped(OutputStats *stats)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    QMutexLocker lock(&m_mutex);
+    ++stats->frames;
+    if (stats->lastSwapNs) {
+        const qreal interval = (now - stats->lastSwapNs) / 1e6;
+        const qreal period = 1000 / stats->refreshRate;
+        if (interval < period * IdleFrameGap) {
+            stats->frameInterval.add(interval);
+            const int periods = qRound(interval / period);
+            if (periods > 1)
+                stats->missedVsyncs += periods - 1;
+        }
+    }
+    stats->lastSwapNs = now;
+    if (stats->inputPendingNs) {
+        stats->inputLatency.add((now - stats->inputPendingNs) / 1e6);
+        stats->inputPendingNs = 0;
+    }
+}
+
+bool Instrumentation::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseMove:
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::TouchEnd:
+    case QEvent::Wheel: {
+        // only the first event before a frame counts: that's the one which waited longest
+        const qint64 now = m_clock.nsecsElapsed();
+        QMutexLocker lock(&m_mutex);
+        for (OutputStats *stats : m_outputs) {
+            if (stats->window.data() == watched) {
+                if (!stats->inputPendingNs)
+                    stats->inputPendingNs = now;
+                break;
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return false;
+}
+
+void Instrumentation::addSurface(QWaylandSurface *surface)
+{
+    if (!surface || m_surfaces.contains(surface))
+        return;
+    m_surfaces.insert(surface, 0);
+    connect(surface, &QWaylandSurface::sizeChanged, this, &Instrumentation::onSurfaceSizeChanged);
+    connect(surface, &QWaylandSurface::bufferScaleChanged, this, &Instrumentation::onSurfaceSizeChanged);
+    connect(surface, &QWaylandSurface::surfaceDestroyed, this, &Instrumentation::onSurfaceDestroyed);
+}
+
+void Instrumentation::onSurfaceSizeChanged()
+{
+    QWaylandSurface *surface = static_cast<QWaylandSurface *>(sender());
+    const QSize size = surface->size() * surface->bufferScale();
+    // assume 32-bit pixels; a client may use less, but rarely
+    m_surfaces[surface] = qint64(size.width()) * size.height() * 4;
+}
+
+void Instrumentation::onSurfaceDestroyed()
+{
+    QWaylandSurface *surface = static_cast<QWaylandSurface *>(sender());
+    m_surfaces.remove(surface);
+    m_allocated.remove(surface);
+    disconnect(surface, 0, this, 0);
+}
+
+void Instrumentation::count(const QString &name, int delta)
+{
+    m_counters.insert(name, m_counters.value(name).toLongLong() + delta);
+}
+
+void Instrumentation::recordLaunch(const QString &app, int milliseconds)
+{
+    QVariantMap launch = m_launches.value(app).toMap();
+    const int count = launch.value(QStringLiteral("count")).toInt();
+    launch.insert(QStringLiteral("count"), count + 1);
+    launch.insert(QStringLiteral("last"), milliseconds);
+    launch.insert(QStringLiteral("best"), count ? qMin(milliseconds, launch.value(QStringLiteral("best")).toInt()) : milliseconds);
+    launch.insert(QStringLiteral("worst"), qMax(milliseconds, launch.value(QStringLiteral("worst")).toInt()));
+    m_launches.insert(app, launch);
+}
+
+void Instrumentation::setTextureBytes(QWaylandSurface *surface, qint64 bytes)
+{
+    if (bytes < 0)
+        m_allocated.remove(surface);
+    else if (m_surfaces.contains(surface))
+        m_allocated.insert(surface, bytes);
+}
+
+qint64 Instrumentation::textureBytes() const
+{
+    qint64 ret = 0;
+    for (auto it = m_surfaces.constBegin(); it != m_surfaces.constEnd(); ++it)
+        ret += m_allocated.value(it.key(), it.value());
+    return ret;
+}
+
+QVariantList Instrumentation::clients() const
+{
+    QHash<qint64, QVariantMap> clients;
+    for (auto it = m_surfaces.constBegin(); it != m_surfaces.constEnd(); ++it) {
+        const qint64 pid = it.key()->client() ? it.key()->client()->processId() : 0;
+        QVariantMap &client = clients[pid];
+        client.insert(QStringLiteral("pid"), pid);
+        client.insert(QStringLiteral("surfaces"), client.value(QStringLiteral("surfaces")).toInt() + 1);
+        client.insert(QStringLiteral("textureBytes"), client.value(QStringLiteral("textureBytes")).toLongLong() +
+                      m_allocated.value(it.key(), it.value()));
+    }
+    QList<QVariantMap> sorted = clients.values();
+    std::sort(sorted.begin(), sorted.end(), [](const QVariantMap &a, const QVariantMap &b) {
+        return a.value(QStringLiteral("textureBytes")).toLongLong() > b.value(QStringLiteral("textureBytes")).toLongLong();
+    });
+    QVariantList ret;
+    for (const QVariantMap &client : sorted)
+        ret << client;
+    return ret;
+}
+
+QVariantMap Instrumentation::outputData(const OutputStats *stats) const
+{
+    QVariantMap ret;
+    ret.insert(QStringLiteral("name"), stats->name);
+    ret.insert(QStringLiteral("refreshRate"), stats->refreshRate);
+    ret.insert(QStringLiteral("frames"), stats->frames);
+    ret.insert(QStringLiteral("missedVsyncs"), stats->missedVsyncs);
+    ret.insert(QStringLiteral("frameInterval"), stats->frameInterval.toVariantMap());
+    ret.insert(QStringLiteral("renderTime"), stats->renderTime.toVariantMap());
+    ret.insert(QStringLiteral("inputLatency"), stats->inputLatency.toVariantMap());
+    ret.insert(QStringLiteral("scheduler"), OutputScheduler::instance()->outputData(stats->window));
+    return ret;
+}
+
+QVariantList Instrumentation::outputs() const
+{
+    QVariantList ret;
+    QMutexLocker lock(&m_mutex);
+    for (const OutputStats *stats : m_outputs)
+        ret << outputData(stats);
+    return ret;
+}
+
+QVariantMap Instrumentation::counters() const
+{
+    return m_counters;
+}
+
+QVariantMap Instrumentation::snapshot() const
+{
+    QVariantMap ret;
+    ret.insert(QStringLiteral("uptime"), m_clock.elapsed());
+    ret.insert(QStringLiteral("outputs"), outputs());
+    ret.insert(QStringLiteral("counters"), m_counters);
+    ret.insert(QStringLiteral("launches"), m_launches);
+
+    ret.insert(QStringLiteral("clients"), clients());
+    ret.insert(QStringLiteral("surfaceCount"), m_surfaces.count());
+    ret.insert(QStringLiteral("textureBytes"), textureBytes());
+    return ret;
+}
+
+bool Instrumentation::dump(const QString &path) const
+{
+    const QString filePath = path.isEmpty() ? m_statsFilePath : path;
+    if (filePath.isEmpty())
+        return false;
+    QSaveFile f(filePath);
+    if (!f.open(QIODevice::WriteOnly) ||
+            f.write(QJsonDocument::fromVariant(snapshot()).toJson()) < 0 || !f.commit()) {
+        qWarning() << "failed to write statistics to" << filePath << f.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Instrumentation::reset()
+{
+    QMutexLocker lock(&m_mutex);
+    for (OutputStats *stats : m_outputs) {
+        stats->frames = 0;
+        stats->missedVsyncs = 0;
+        stats->frameInterval.reset();
+        stats->renderTime.reset();
+        stats->inputLatency.reset();
+    }
+    OutputScheduler::instance()->reset();
+}
+
+void Instrumentation::onTick()
+{
+    if (m_overlayVisible)
+        emit updated();
+    if (!m_statsFilePath.isEmpty() && ++m_ticksSinceDump >= DumpEveryTicks) {
+        m_ticksSinceDump = 0;
+        dump();
+    }
+}
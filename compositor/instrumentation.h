@@ -0,0 +1,148 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+class QQuickWindow;
+class QWaylandSurface;
+
+/*!
+    Histogram of durations in milliseconds, in 0.25 ms buckets up to 100 ms.
+*/
+class DurationHistogram
+{
+public:
+    DurationHistogram() { reset(); }
+
+    void add(qreal ms);
+    void reset();
+    quint64 count() const { return m_count; }
+    qreal max() const { return m_max; }
+    qreal percentile(qreal p) const;
+    QVariantMap toVariantMap() const;
+
+private:
+    enum { BucketMicroseconds = 250, BucketCount = 400 };
+    quint32 m_buckets[BucketCount + 1]; // the last one is for everything longer
+    quint64 m_count;
+    qreal m_max;
+};
+
+/*!
+    Collects performance statistics of the compositor.
+
+    For each output window: frame intervals (from one frameSwapped to the
+    next), render time (beforeRendering to afterRendering), missed vsyncs,
+    and the latency from an input event arriving to the next frame being
+    presented.  Also the surfaces which exist and the texture memory they
+    use, for each client: what ShmTextureCache has allocated, or else an
+    estimate from the surface size; and generic counters which QML can bump, such as the
+    number of live Chrome items; OutputScheduler's view of each output;
+    and how long each application took from
+    being launched to showing its first surface.
+
+    The statistics are available to QML as properties, updated once a
+    second, for the StatsOverlay; and can be written to a JSON file with
+    dump(), periodically if statsFilePath is set.  The windows' rendering
+    signals and input events are only watched while one of those needs
+    them (--stats-overlay or --stats), so that otherwise they cost nothing.
+*/
+class Instrumentation : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool overlayVisible READ overlayVisible WRITE setOverlayVisible NOTIFY overlayVisibleChanged)
+    Q_PROPERTY(QVariantList outputs READ outputs NOTIFY updated)
+    Q_PROPERTY(QVariantMap counters READ counters NOTIFY updated)
+    Q_PROPERTY(int surfaceCount READ surfaceCount NOTIFY updated)
+    Q_PROPERTY(qint64 textureBytes READ textureBytes NOTIFY updated)
+    Q_PROPERTY(QVariantList clients READ clients NOTIFY updated)
+
+public:
+    static Instrumentation *instance();
+
+    bool overlayVisible() const { return m_overlayVisible; }
+    void setOverlayVisible(bool visible);
+
+    QString statsFilePath() const { return m_statsFilePath; }
+    void setStatsFilePath(const QString &path);
+
+    void addWindow(QQuickWindow *window);
+
+    QVariantList outputs() const;
+    QVariantMap counters() const;
+    int surfaceCount() const { return m_surfaces.count(); }
+    qint64 textureBytes() const;
+    // by texture memory, the most first
+    QVariantList clients() const;
+    // what is actually allocated for the surface; negative to go back to the estimate
+    void setTextureBytes(QWaylandSurface *surface, qint64 bytes);
+
+    Q_INVOKABLE void addSurface(QWaylandSurface *surface);
+    Q_INVOKABLE void count(const QString &name, int delta = 1);
+    Q_INVOKABLE void recordLaunch(const QString &app, int milliseconds);
+    Q_INVOKABLE QVariantMap snapshot() const;
+    Q_INVOKABLE bool dump(const QString &path = QString()) const;
+    Q_INVOKABLE void reset();
+
+signals:
+    void overlayVisibleChanged();
+    void updated();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) Q_DECL_OVERRIDE;
+
+protected slots:
+    void onTick();
+    void onSurfaceSizeChanged();
+    void onSurfaceDestroyed();
+
+protected:
+    Instrumentation();
+
+    struct OutputStats {
+        QPointer<QQuickWindow> window;
+        QString name;
+        qreal refreshRate = 60;
+        qint64 lastSwapNs = 0;
+        qint64 renderStartNs = 0;
+        qint64 inputPendingNs = 0;
+        quint64 frames = 0;
+        quint64 missedVsyncs = 0;
+        DurationHistogram frameInterval;
+        DurationHistogram renderTime;
+        DurationHistogram inputLatency;
+        QVector<QMetaObject::Connection> connections; // while collecting
+    };
+
+    bool isCollecting() const { return m_overlayVisible || !m_statsFilePath.isEmpty(); }
+    void updateCollecting();
+    void watch(OutputStats *stats);
+    void unwatch(OutputStats *stats);
+    void onBeforeRendering(OutputStats *stats);
+    void onAfterRendering(OutputStats *stats);
+    void onFrameSwapped(OutputStats *stats);
+    QVariantMap outputData(const OutputStats *stats) const;
+
+protected:
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex; // guards the OutputStats, which are updated from render threads
+    QVector<OutputStats *> m_outputs;
+    QHash<QWaylandSurface *, qint64> m_surfaces; // estimated texture bytes
+    QHash<QWaylandSurface *, qint64> m_allocated; // known texture bytes
+    QVariantMap m_counters;
+    QVariantMap m_launches; // app name -> time to first surface statistics
+    QTimer m_tickTimer;
+    QString m_statsFilePath;
+    int m_ticksSinceDump = 0;
+    bool m_overlayVisible = false;
+};
+
+#endif // INSTRUMENTATION_H
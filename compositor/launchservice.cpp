@@ -0,0 +1,439 @@
+#include "launchservice.h"
+#include "instrumentation.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QWaylandClient>
+#include <QWaylandSurface>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static const int PollInterval = 500; // ms
+static const int ReadChunk = 16 * 1024; // at most this much per stream per wakeup
+static const int MaxLineLength = 4096;
+static const qint64 OutputBytesPerSecond = 32 * 1024;
+static const qint64 OutputBurstBytes = 256 * 1024;
+// how far up the process tree a client may be from what was launched (wrapper scripts)
+static const int MaxAncestry = 4;
+
+// posix_spawn_file_actions_addchdir_np() is in glibc since 2.29
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 29)
+#define HAVE_SPAWN_CHDIR 1
+#endif
+#endif
+#ifndef HAVE_SPAWN_CHDIR
+#define HAVE_SPAWN_CHDIR 0
+#endif
+
+/*
+    Reads a child's stdout and stderr and logs them line by line.
+    Deletes itself when both are closed.  Once the child has used up its
+    output budget, the pipes are not read until the bucket has refilled, so
+    a chatty child blocks on its own writes instead of flooding the log.
+*/
+class ClientOutput : public QObject
+{
+public:
+    ClientOutput(const QString &name, qint64 pid, int outFd, int errFd, QObject *parent)
+        : QObject(parent)
+        , m_prefix(QString(QStringLiteral("%1[%2]")).arg(name).arg(pid).toLocal8Bit())
+        , m_tokens(OutputBurstBytes)
+    {
+        m_clock.start();
+        m_refillTimer.setSingleShot(true);
+        connect(&m_refillTimer, &QTimer::timeout, this, &ClientOutput::resume);
+        m_streams[0].fd = outFd;
+        m_streams[0].tag = "out";
+        m_streams[1].fd = errFd;
+        m_streams[1].tag = "err";
+        for (Stream &stream : m_streams) {
+            fcntl(stream.fd, F_SETFL, fcntl(stream.fd, F_GETFL) | O_NONBLOCK);
+            stream.notifier = new QSocketNotifier(stream.fd, QSocketNotifier::Read, this);
+            Stream *s = &stream;
+            connect(stream.notifier, &QSocketNotifier::activated, this, [this, s]() { read(s); });
+        }
+    }
+
+    ~ClientOutput()
+    {
+        for (Stream &stream : m_streams) {
+            if (stream.fd >= 0)
+                ::close(stream.fd);
+        }
+    }
+
+private:
+    struct Stream {
+        int fd = -1;
+        const char *tag = 0;
+        QSocketNotifier *notifier = 0;
+        QByteArray partial;
+    };
+
+    void read(Stream *stream)
+    {
+        char buf[ReadChunk];
+        const ssize_t n = ::read(stream->fd, buf, sizeof(buf));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        if (n <= 0) {
+            if (!stream->partial.isEmpty())
+                logLine(stream, stream->partial);
+            stream->partial.clear();
+            stream->notifier->setEnabled(false);
+            ::close(stream->fd);
+            stream->fd = -1;
+            if (m_streams[0].fd < 0 && m_streams[1].fd < 0)
+                deleteLater();
+            return;
+        }
+
+        // what has been read is logged anyway; the bucket may go into debt
+        refill();
+        m_tokens -= n;
+        if (m_tokens <= 0)
+            suspend();
+
+        int start = 0;
+        for (int i = 0; i < n; ++i) {
+            if (buf[i] != '\n')
+                continue;
+            stream->partial.append(buf + start, i - start);
+            logLine(stream, stream->partial);
+            stream->partial.clear();
+            start = i + 1;
+        }
+        stream->partial.append(buf + start, int(n) - start);
+        if (stream->partial.size() > MaxLineLength) {
+            logLine(stream, stream->partial + "...");
+            stream->partial.clear();
+        }
+    }
+
+    void refill()
+    {
+        const qint64 now = m_clock.elapsed();
+        m_tokens = qMin(OutputBurstBytes, m_tokens + (now - m_lastRefill) * OutputBytesPerSecond / 1000);
+        m_lastRefill = now;
+    }
+
+    void suspend()
+    {
+        for (Stream &stream : m_streams) {
+            if (stream.fd >= 0)
+                stream.notifier->setEnabled(false);
+        }
+        // until there is room for a whole chunk again
+        m_refillTimer.start(int((ReadChunk - m_tokens) * 1000 / OutputBytesPerSecond) + 1);
+    }
+
+    void resume()
+    {
+        refill();
+        for (Stream &stream : m_streams) {
+            if (stream.fd >= 0)
+                stream.notifier->setEnabled(true);
+        }
+    }
+
+    void logLine(const Stream *stream, const QByteArray &line)
+    {
+        // no function and line context: that would be ours, not the client's
+        QMessageLogger().info("%s %s: %s", m_prefix.constData(), stream->tag, line.constData());
+    }
+
+    QByteArray m_prefix;
+    Stream m_streams[2];
+    QElapsedTimer m_clock;
+    QTimer m_refillTimer;
+    qint64 m_lastRefill = 0;
+    qint64 m_tokens;
+};
+
+LaunchService *LaunchService::instance()
+{
+    static LaunchService *ret = new LaunchService;
+    return ret;
+}
+
+LaunchService::LaunchService()
+{
+    m_clock.start();
+    m_pollTimer.setInterval(PollInterval);
+    connect(&m_pollTimer, &QTimer::timeout, this, &LaunchService::pollChildren);
+}
+
+void LaunchService::prepareEnvironment()
+{
+    m_environment.clear();
+    m_envp.clear();
+    for (char **e = environ; *e; ++e)
+        m_environment << QByteArray(*e);
+    for (QByteArray &e : m_environment)
+        m_envp << e.data();
+    m_envp << 0;
+}
+
+void LaunchService::refreshEnvironment()
+{
+    prepareEnvironment();
+}
+
+int LaunchService::launch(const QString &program)
+{
+    return launchCommand(QStringList() << program << QStringLiteral("-platform") << QStringLiteral("wayland"));
+}
+
+void LaunchService::launchEntry(const QVariantMap &entry, const QString &name)
+{
+    const QStringList command = entry.value(QStringLiteral("command")).toStringList();
+    const QString workingDirectory = entry.value(QStringLiteral("workingDirectory")).toString();
+    const QString service = entry.value(QStringLiteral("dbusName")).toString();
+    if (service.isEmpty()) {
+        launchCommand(command, name, workingDirectory);
+        return;
+    }
+    // org.freedesktop.Application, as the desktop entry spec has it
+    QString path = QLatin1Char('/') + service;
+    path.replace(QLatin1Char('.'), QLatin1Char('/'));
+    path.replace(QLatin1Char('-'), QLatin1Char('_'));
+    QDBusMessage message = QDBusMessage::createMethodCall(service, path, QStringLiteral("org.freedesktop.Application"),
+                                                          QStringLiteral("Activate"));
+    message << QVariantMap(); // platform-data
+    // not blocking: the application may have to be started first
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [=]() {
+        watcher->deleteLater();
+        if (!watcher->isError()) {
+            qDebug() << "activated" << name << "via D-Bus as" << service;
+            return;
+        }
+        qWarning() << "failed to activate" << service << watcher->error().message() << "; running its command";
+        launchCommand(command, name, workingDirectory);
+    });
+}
+
+int LaunchService::launchCommand(const QStringList &command, const QString &name, const QString &workingDirectory)
+{
+    const QString appName = name.isEmpty() && !command.isEmpty() ? QFileInfo(command.first()).fileName() : name;
+    if (command.isEmpty()) {
+        emit launchFailed(appName, tr("nothing to launch"));
+        return -1;
+    }
+    if (m_envp.isEmpty())
+        prepareEnvironment();
+
+    QByteArrayList args;
+    QVector<char *> argv;
+    const QByteArray directory = QFile::encodeName(workingDirectory);
+#if !HAVE_SPAWN_CHDIR
+    // the shell execs the command, so the PID stays the same
+    if (!directory.isEmpty())
+        args << "/bin/sh" << "-c" << "cd -- \"$0\" && exec \"$@\"" << directory;
+#endif
+    for (const QString &arg : command)
+        args << arg.toLocal8Bit();
+    for (QByteArray &arg : args)
+        argv << arg.data();
+    argv << 0;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+#if HAVE_SPAWN_CHDIR
+    if (!directory.isEmpty())
+        posix_spawn_file_actions_addchdir_np(&actions, directory.constData());
+#endif
+    int outPipe[2] = { -1, -1 };
+    int errPipe[2] = { -1, -1 };
+    if (m_captureOutput) {
+        // close-on-exec: other children must not inherit them; dup2() clears that for the child's copies
+        if (pipe2(outPipe, O_CLOEXEC) == 0 && pipe2(errPipe, O_CLOEXEC) == 0) {
+            posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+            posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO);
+        } else {
+            qWarning() << "failed to create pipes for the output of" << appName << strerror(errno);
+            for (int fd : { outPipe[0], outPipe[1] })
+                if (fd >= 0)
+                    ::close(fd);
+            outPipe[0] = outPipe[1] = -1;
+        }
+    }
+
+    // not in our process group, and without our signal handlers and mask
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigfillset(&signals);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    pid_t pid = 0;
+    const int err = posix_spawnp(&pid, argv.first(), &actions, &attr, argv.data(), m_envp.data());
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    const bool captured = outPipe[0] >= 0;
+    if (captured) {
+        ::close(outPipe[1]);
+        ::close(errPipe[1]);
+        if (err) {
+            ::close(outPipe[0]);
+            ::close(errPipe[0]);
+        } else {
+            new ClientOutput(appName, pid, outPipe[0], errPipe[0], this);
+        }
+    }
+    if (err) {
+        const QString error = QString::fromLocal8Bit(strerror(err));
+        qWarning() << "failed to launch" << command << error;
+        emit launchFailed(appName, error);
+        return -1;
+    }
+
+    Child *child = new Child;
+    child->name = appName;
+    child->command = command;
+    child->pid = pid;
+    child->started = m_clock.elapsed();
+#ifdef SYS_pidfd_open
+    child->pidfd = int(syscall(SYS_pidfd_open, pid, 0));
+#endif
+    if (child->pidfd >= 0) {
+        fcntl(child->pidfd, F_SETFD, FD_CLOEXEC);
+        child->notifier = new QSocketNotifier(child->pidfd, QSocketNotifier::Read, this);
+        connect(child->notifier, &QSocketNotifier::activated, this, [this, pid]() {
+            if (Child *c = m_children.value(pid))
+                reap(c);
+        });
+    } else if (!m_pollTimer.isActive()) {
+        m_pollTimer.start();
+    }
+    m_children.insert(pid, child);
+    m_ancestors.clear();
+    qDebug() << "launched" << appName << "PID" << pid;
+    emit launched(appName, pid);
+    return pid;
+}
+
+bool LaunchService::reap(Child *child)
+{
+    int status = 0;
+    const pid_t ret = waitpid(pid_t(child->pid), &status, WNOHANG);
+    if (ret == 0 || (ret < 0 && errno == EINTR))
+        return false;
+    // ECHILD: someone else reaped it; it's gone in any case
+    const int exitStatus = ret < 0 ? -1 : WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (child->surfaceSeen)
+        qDebug() << child->name << "PID" << child->pid << "exited with status" << exitStatus;
+    else
+        qWarning() << child->name << "PID" << child->pid << "exited with status" << exitStatus << "before showing a surface";
+    m_children.remove(child->pid);
+    m_ancestors.clear();
+    if (child->notifier) {
+        child->notifier->setEnabled(false);
+        child->notifier->deleteLater();
+    }
+    if (child->pidfd >= 0)
+        ::close(child->pidfd);
+    emit finished(child->name, int(child->pid), exitStatus);
+    delete child;
+    return true;
+}
+
+void LaunchService::pollChildren()
+{
+    bool polling = false;
+    const QList<Child *> children = m_children.values();
+    for (Child *child : children) {
+        if (child->pidfd < 0 && !reap(child))
+            polling = true;
+    }
+    if (!polling)
+        m_pollTimer.stop();
+}
+
+void LaunchService::surfaceCreated(QWaylandSurface *surface)
+{
+    if (!surface || !surface->client() || m_children.isEmpty())
+        return;
+    Child *child = launchedAncestor(surface->client()->processId());
+    if (!child || child->surfaceSeen)
+        return;
+    if (surface->hasContent())
+        onSurfaceContent();
+    else
+        connect(surface, &QWaylandSurface::hasContentChanged, this, &LaunchService::onSurfaceContent);
+}
+
+void LaunchService::onSurfaceContent()
+{
+    QWaylandSurface *surface = qobject_cast<QWaylandSurface *>(sender());
+    if (!surface || !surface->hasContent())
+        return;
+    disconnect(surface, &QWaylandSurface::hasContentChanged, this, &LaunchService::onSurfaceContent);
+    Child *child = surface->client() ? launchedAncestor(surface->client()->processId()) : 0;
+    if (!child || child->surfaceSeen)
+        return;
+    child->surfaceSeen = true;
+    const int ms = int(m_clock.elapsed() - child->started);
+    qDebug() << child->name << "PID" << child->pid << "showed its first surface after" << ms << "ms";
+    Instrumentation::instance()->recordLaunch(child->name, ms);
+    emit firstSurface(child->name, int(child->pid), ms);
+}
+
+QVariantMap LaunchService::launchedApp(qint64 pid) const
+{
+    QVariantMap ret;
+    if (const Child *child = launchedAncestor(pid)) {
+        ret.insert(QStringLiteral("name"), child->name);
+        ret.insert(QStringLiteral("pid"), child->pid);
+        ret.insert(QStringLiteral("command"), child->command);
+    }
+    return ret;
+}
+
+LaunchService::Child *LaunchService::launchedAncestor(qint64 clientPid) const
+{
+    auto cached = m_ancestors.constFind(clientPid);
+    if (cached != m_ancestors.constEnd())
+        return m_children.value(cached.value());
+    m_ancestors.insert(clientPid, 0);
+    qint64 pid = clientPid;
+    for (int i = 0; i < MaxAncestry && pid > 1; ++i) {
+        if (Child *child = m_children.value(pid)) {
+            m_ancestors.insert(clientPid, pid);
+            return child;
+        }
+        // the parent PID is the fourth field; the second one, the name, may contain spaces
+        QFile stat(QStringLiteral("/proc/%1/stat").arg(pid));
+        if (!stat.open(QIODevice::ReadOnly))
+            return 0;
+        const QByteArray line = stat.readAll();
+        const int nameEnd = line.lastIndexOf(')');
+        const QList<QByteArray> fields = line.mid(nameEnd + 2).split(' ');
+        if (nameEnd < 0 || fields.count() < 2)
+            return 0;
+        pid = fields.at(1).toLongLong();
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef LAUNCHSERVICE_H
+#define LAUNCHSERVICE_H
+
+#include <QByteArrayList>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+#include <QTimer>
+#include <QVector>
+
+class QSocketNotifier;
+class QWaylandSurface;
+
+/*!
+    Starts client applications, and measures how long they take to show up.
+
+    Children are started with posix_spawnp() using an environment which is
+    prepared once (so QT_QPA_PLATFORM and the like must be set before the
+    first launch, or refreshEnvironment() called afterwards).  They are
+    reaped via a pidfd where the kernel supports it, or else by polling.
+
+    With captureOutput set (as it is when logging to a file), each child's
+    stdout and stderr go through pipes and are read as data arrives; each
+    line is logged with the application name and PID as a prefix.  A noisy
+    client can't flood the log or starve the event loop: reads are limited
+    per wakeup, and beyond a per-client rate (a token bucket) its pipes are
+    not read until the bucket has refilled, so the client waits in write().
+
+    surfaceCreated() should be called for each new surface: when a surface
+    of a client which was launched here (or of a descendant of one, in case
+    of wrapper scripts) gets content for the first time, the time since the
+    launch is logged and recorded in Instrumentation.  Which launched child
+    a client PID descends from is looked up in /proc once, and cached until
+    the children change.
+*/
+class LaunchService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static LaunchService *instance();
+
+    // the program with "-platform wayland", for Qt applications; returns the PID, or -1
+    Q_INVOKABLE int launch(const QString &program);
+    // argv as given, e.g. from the Exec line of a desktop file
+    Q_INVOKABLE int launchCommand(const QStringList &command, const QString &name = QString(),
+                                  const QString &workingDirectory = QString());
+    // from LauncherModel.select(): activated via D-Bus if it has a dbusName, else (or if that fails)
+    // the command is run in workingDirectory
+    Q_INVOKABLE void launchEntry(const QVariantMap &entry, const QString &name);
+
+    Q_INVOKABLE void surfaceCreated(QWaylandSurface *surface);
+    // name, pid and command of the launched application which the process is, or descends from
+    QVariantMap launchedApp(qint64 pid) const;
+    Q_INVOKABLE void refreshEnvironment();
+
+    bool captureOutput() const { return m_captureOutput; }
+    void setCaptureOutput(bool capture) { m_captureOutput = capture; }
+
+signals:
+    void launched(const QString &name, int pid);
+    void launchFailed(const QString &name, const QString &error);
+    void firstSurface(const QString &name, int pid, int milliseconds);
+    void finished(const QString &name, int pid, int exitStatus);
+
+protected slots:
+    void onSurfaceContent();
+    void pollChildren();
+
+protected:
+    LaunchService();
+
+    struct Child {
+        QString name;
+        QStringList command;
+        qint64 pid = 0;
+        qint64 started = 0;
+        int pidfd = -1;
+        QSocketNotifier *notifier = 0;
+        bool surfaceSeen = false;
+    };
+
+    void prepareEnvironment();
+    bool reap(Child *child);
+    Child *launchedAncestor(qint64 pid) const;
+
+protected:
+    QElapsedTimer m_clock;
+    QByteArrayList m_environment;
+    QVector<char *> m_envp;
+    QHash<qint64, Child *> m_children;
+    mutable QHash<qint64, qint64> m_ancestors; // client pid -> launched child's pid, or 0
+    QTimer m_pollTimer; // only if there are children without pidfds
+    bool m_captureOutput = false;
+};
+
+#endif // LAUNCHSERVICE_H
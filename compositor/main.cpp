@@ -22,31 +22,56 @@
 #include <QElapsedTimer>
 #include <QFontDatabase>
 #include <QGuiApplication>
+#include <QResource>
 #include <QScreen>
 #include <QUrl>
 #include <QWindow>
+#include <QWaylandCompositor>
 
 #include <QtQml/qqml.h>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQuickItem>
+#include <QQuickWindow>
 
+#include "asynclog.h"
+#include "damagetracker.h"
+#include "decorationitem.h"
+#include "framecallbackpolicy.h"
+#include "glyphprovider.h"
+#include "hardwarecursor.h"
+#include "instrumentation.h"
+#include "launchservice.h"
+#include "movecontroller.h"
+#include "occlusionculler.h"
+#include "outputscheduler.h"
+#include "outputtracker.h"
 #include "processlauncher.h"
+#include "resizecontroller.h"
+#include "sessionstore.h"
+#include "shmsurfaceitem.h"
+#include "shmtexturecache.h"
 #include "stackableitem.h"
+#include "supervisor.h"
+#include "tracer.h"
+#include "windowstack.h"
 
 #include <errno.h>
+#include <fontconfig/fontconfig.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/prctl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <wayland-server.h>
 
 static QLatin1String glassPaneName("glassPane");
 static QByteArray grefsonExecutablePath;
 static qint64 grefsonPID;
 static void *signalHandlerStack;
 static QString logFilePath;
+static AsyncLog *asyncLog = 0;
 static QElapsedTimer sinceStartup;
 
 QString grefsenConfigDirPath(QDir::homePath() + "/.config/grefsen/");
@@ -58,6 +83,8 @@ extern "C" void signalHandler(int signal)
     if (QX11Info::display())
         close(ConnectionNumber(QX11Info::display()));
 #endif
+    if (AsyncLog *log = AsyncLog::instance())
+        log->flush();
     pid_t pid = fork();
     switch (pid) {
     case -1: // error
@@ -115,9 +142,6 @@ static void setupSignalHandler()
 
 void qtMsgLog(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
-    static QFile log(logFilePath);
-    if (!log.isOpen())
-        log.open(QIODevice::WriteOnly | QIODevice::Text);
     char typeChar = ' ';
     switch (type) {
     case QtDebugMsg:
@@ -135,24 +159,102 @@ void qtMsgLog(QtMsgType type, const QMessageLogContext &context, const QString &
     case QtFatalMsg:
         typeChar = 'F';
     }
-    char buf[64];
+    char buf[128];
     qint64 ts = sinceStartup.elapsed();
-    snprintf(buf, 64, "[%6lld.%03lld %c] ", ts / 1000, ts % 1000, typeChar);
-    log.write(buf);
-    if (context.function) {
-        snprintf(buf, 64, "%s:%d: ", context.function, context.line);
-        log.write(buf);
-    }
-    log.write(msg.toUtf8());
-    log.write("\n");
-    if (type == QtFatalMsg)
+    int n = snprintf(buf, 64, "[%6lld.%03lld %c] ", ts / 1000, ts % 1000, typeChar);
+    if (context.function)
+        snprintf(buf + n, 64, "%s:%d: ", context.function, context.line);
+    const QByteArray text = msg.toUtf8();
+    asyncLog->append(buf, text.constData(), text.size());
+    if (type == QtFatalMsg) {
+        asyncLog->flush();
         abort();
+    }
+}
+
+// for measuring startup time; the log has timestamps too, but stdout doesn't
+static void startupPhase(const char *phase)
+{
+    qDebug("startup: %s after %lld ms", phase, sinceStartup.elapsed());
+    Tracer::instance()->instant(QLatin1String(phase));
+}
+
+static void stopLog()
+{
+    qInstallMessageHandler(0);
+    delete asyncLog;
+    asyncLog = 0;
 }
 
 static void registerTypes()
 {
     qmlRegisterType<WaylandProcessLauncher>("com.theqtcompany.wlprocesslauncher", 1, 0, "ProcessLauncher");
+    qmlRegisterSingletonType<LaunchService>("com.theqtcompany.wlprocesslauncher", 1, 0, "LaunchService",
+        [](QQmlEngine *, QJSEngine *) -> QObject * {
+            QQmlEngine::setObjectOwnership(LaunchService::instance(), QQmlEngine::CppOwnership);
+            return LaunchService::instance();
+        });
     qmlRegisterType<StackableItem>("com.theqtcompany.wlcompositor", 1, 0, "StackableItem");
+    qmlRegisterType<DecorationItem>("com.theqtcompany.wlcompositor", 1, 0, "Decoration");
+    qmlRegisterType<DamageTracker>("com.theqtcompany.wlcompositor", 1, 0, "DamageTracker");
+    qmlRegisterSingletonType<HardwareCursor>("com.theqtcompany.wlcompositor", 1, 0, "HardwareCursor",
+        [](QQmlEngine *, QJSEngine *) -> QObject * {
+            QQmlEngine::setObjectOwnership(HardwareCursor::instance(), QQmlEngine::CppOwnership);
+            return HardwareCursor::instance();
+        });
+    qmlRegisterType<MoveController>("com.theqtcompany.wlcompositor", 1, 0, "MoveController");
+    qmlRegisterType<OcclusionCuller>("com.theqtcompany.wlcompositor", 1, 0, "OcclusionCuller");
+    qmlRegisterType<OutputTracker>("com.theqtcompany.wlcompositor", 1, 0, "OutputTracker");
+    qmlRegisterType<ResizeController>("com.theqtcompany.wlcompositor", 1, 0, "ResizeController");
+    qmlRegisterType<ShmSurfaceItem>("com.theqtcompany.wlcompositor", 1, 0, "ShmSurfaceItem");
+    qmlRegisterSingletonType<FrameCallbackPolicy>("com.theqtcompany.wlcompositor", 1, 0, "FrameCallbackPolicy",
+        [](QQmlEngine *, QJSEngine *) -> QObject * {
+            QQmlEngine::setObjectOwnership(FrameCallbackPolicy::instance(), QQmlEngine::CppOwnership);
+            return FrameCallbackPolicy::instance();
+        });
+    qmlRegisterSingletonType<WindowStack>("com.theqtcompany.wlcompositor", 1, 0, "WindowStack",
+        [](QQmlEngine *, QJSEngine *) -> QObject * {
+            QQmlEngine::setObjectOwnership(WindowStack::instance(), QQmlEngine::CppOwnership);
+            return WindowStack::instance();
+        });
+    qmlRegisterSingletonType<Tracer>("com.theqtcompany.wlcompositor", 1, 0, "Tracer",
+        [](QQmlEngine *, QJSEngine *) -> QObject * {
+            QQmlEngine::setObjectOwnership(Tracer::instance(), QQmlEngine::CppOwnership);
+            return Tracer::instance();
+        });
+    qmlRegisterSingletonType<Instrumentation>("com.theqtcompany.wlcompositor", 1, 0, "Instrumentation",
+        [](QQmlEngine *, QJSEngine *) -> QObject * {
+            QQmlEngine::setObjectOwnership(Instrumentation::instance(), QQmlEngine::CppOwnership);
+            return Instrumentation::instance();
+        });
+}
+
+static bool fontconfigHasFamily(const char *family)
+{
+    // only fonts of this family are listed; QFontDatabase would list all of them first, here
+    // on the GUI thread, whereas GlyphProvider::prewarm() leaves that to a pool thread
+    FcPattern *pattern = FcPatternBuild(0, FC_FAMILY, FcTypeString, family, (char *) 0);
+    FcObjectSet *objects = FcObjectSetBuild(FC_FAMILY, (char *) 0);
+    FcFontSet *fonts = FcFontList(0, pattern, objects);
+    const bool ret = fonts && fonts->nfont > 0;
+    if (fonts)
+        FcFontSetDestroy(fonts);
+    FcObjectSetDestroy(objects);
+    FcPatternDestroy(pattern);
+    return ret;
+}
+
+static void registerBundledFont(const char *family, const QString &resourcePath)
+{
+    if (fontconfigHasFamily(family))
+        return;
+    QResource resource(resourcePath);
+    // uncompressed resources are used in place, from the mapped executable
+    const QByteArray data = resource.isCompressed() ?
+            qUncompress(resource.data(), int(resource.size())) :
+            QByteArray::fromRawData(reinterpret_cast<const char *>(resource.data()), int(resource.size()));
+    if (data.isEmpty() || QFontDatabase::addApplicationFontFromData(data) == -1)
+        qWarning("failed to load the %s font from resources", family);
 }
 
 static void screenCheck(QList<QScreen *> &screens)
@@ -163,9 +265,31 @@ static void screenCheck(QList<QScreen *> &screens)
     }
 }
 
+// linux-dmabuf buffers go straight into an EGLImage, without copies; QtWayland has the
+// integration since 5.11, and only uses it when asked to.  Returns whether the variable was set here.
+static bool enableDmabufImport()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    if (qEnvironmentVariableIsSet("QT_WAYLAND_CLIENT_BUFFER_INTEGRATION"))
+        return false;
+    for (const QString &path : QCoreApplication::libraryPaths()) {
+        QDir dir(path + QLatin1String("/wayland-graphics-integration-server"));
+        if (!dir.entryList(QStringList() << QStringLiteral("*linux-dmabuf-unstable-v1*")).isEmpty()) {
+            // and wayland-egl for the clients which don't know dmabuf yet
+            qputenv("QT_WAYLAND_CLIENT_BUFFER_INTEGRATION", "linux-dmabuf-unstable-v1;wayland-egl");
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
 int main(int argc, char *argv[])
 {
+    // with --supervise, only returns in the compositor process
+    Supervisor::start(argc, argv);
     sinceStartup.start();
+    const qint64 mainStart = Tracer::now();
     if (!qEnvironmentVariableIsSet("QT_XCB_GL_INTEGRATION"))
         qputenv("QT_XCB_GL_INTEGRATION", "xcb_egl"); // use xcomposite-glx if no EGL
     if (!qEnvironmentVariableIsSet("QT_WAYLAND_DISABLE_WINDOWDECORATION"))
@@ -174,13 +298,22 @@ int main(int argc, char *argv[])
         qputenv("QT_LABS_CONTROLS_STYLE", "Universal");
     if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORMTHEME"))
         qputenv("QT_QPA_PLATFORMTHEME", "generic");
+    // so that a client buffer is imported or uploaded once for all outputs, and by ShmTextureCache's thread
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
     QGuiApplication app(argc, argv);
+    const qint64 appCreated = Tracer::now();
     //QCoreApplication::setApplicationName("grefsen"); // defaults to name of the executable
     QCoreApplication::setApplicationVersion("0.1");
 //    app.setAttribute(Qt::AA_DisableHighDpiScaling); // better use the env variable... but that's not enough on eglfs
     grefsonExecutablePath = app.applicationFilePath().toLocal8Bit();
     grefsonPID = QCoreApplication::applicationPid();
     bool windowed = false;
+    QString socketName;
+    // Qt keeps linked shader programs (including the QtGraphicalEffects ones)
+    // in ~/.cache/grefsen/qtshadercache, so that only the first start has to compile them
+    if (QCoreApplication::testAttribute(Qt::AA_DisableShaderDiskCache) ||
+            qEnvironmentVariableIsSet("QT_DISABLE_SHADER_DISK_CACHE"))
+        qWarning("the shader disk cache is disabled; shaders will be compiled at every start");
 
     QList<QScreen *> screens = QGuiApplication::screens();
     {
@@ -193,11 +326,20 @@ int main(int argc, char *argv[])
                 QCoreApplication::translate("main", "respawn grefsen after a crash"));
         parser.addOption(respawnOption);
 
+        QCommandLineOption superviseOption(QStringList() << "supervise",
+                QCoreApplication::translate("main", "restart grefsen after a crash, keeping the Wayland socket, and restore the session"));
+        parser.addOption(superviseOption);
+
         QCommandLineOption logFileOption(QStringList() << "l" << "log",
                 QCoreApplication::translate("main", "redirect all debug/warning/error output to a log file"),
                 QCoreApplication::translate("main", "file path"));
         parser.addOption(logFileOption);
 
+        QCommandLineOption logRotateOption(QStringList() << "log-rotate-size",
+                QCoreApplication::translate("main", "when the log file grows beyond this size, rename it to <file>.1 and start a new one"),
+                QCoreApplication::translate("main", "KiB"));
+        parser.addOption(logRotateOption);
+
         QCommandLineOption configDirOption(QStringList() << "c" << "config",
                 QCoreApplication::translate("main", "load config files from the given directory (default is ~/.config/grefsen)"),
                 QCoreApplication::translate("main", "directory path"));
@@ -212,15 +354,73 @@ int main(int argc, char *argv[])
                 QCoreApplication::translate("main", "run in a window rather than fullscreen"));
         parser.addOption(windowOption);
 
+        QCommandLineOption statsOption(QStringList() << "stats",
+                QCoreApplication::translate("main", "write frame timing and other statistics to a JSON file every 10 seconds and at exit"),
+                QCoreApplication::translate("main", "file path"));
+        parser.addOption(statsOption);
+
+        QCommandLineOption statsOverlayOption(QStringList() << "stats-overlay",
+                QCoreApplication::translate("main", "show frame timing statistics on each screen"));
+        parser.addOption(statsOverlayOption);
+
+        QCommandLineOption partialUpdateOption(QStringList() << "partial-update",
+                QCoreApplication::translate("main", "repaint only the damaged parts of each screen, where EGL_KHR_partial_update is available"));
+        parser.addOption(partialUpdateOption);
+
+        QCommandLineOption flashRepaintsOption(QStringList() << "flash-repaints",
+                QCoreApplication::translate("main", "with --partial-update, flash the damaged regions in magenta"));
+        parser.addOption(flashRepaintsOption);
+
+        QCommandLineOption softwareCursorOption(QStringList() << "software-cursor",
+                QCoreApplication::translate("main", "draw the mouse cursor in the scene rather than with the hardware cursor"));
+        parser.addOption(softwareCursorOption);
+
+        QCommandLineOption moveModeOption(QStringList() << "move-mode",
+                QCoreApplication::translate("main", "how windows are dragged: live (the default), or outline to draw only a frame until released"),
+                QCoreApplication::translate("main", "mode"));
+        parser.addOption(moveModeOption);
+
+        QCommandLineOption syncShmUploadOption(QStringList() << "sync-shm-upload",
+                QCoreApplication::translate("main", "upload shared memory buffers of clients on the render thread of each screen, rather than once on a thread of their own"));
+        parser.addOption(syncShmUploadOption);
+
+        QCommandLineOption traceOption(QStringList() << "trace",
+                QCoreApplication::translate("main", "write a Chrome trace (for chrome://tracing or Perfetto) of startup and other events at exit"),
+                QCoreApplication::translate("main", "file path"));
+        parser.addOption(traceOption);
+
+        QCommandLineOption socketNameOption(QStringList() << "wayland-socket-name",
+                QCoreApplication::translate("main", "name of the Wayland socket for clients to connect to"),
+                QCoreApplication::translate("main", "name"));
+        parser.addOption(socketNameOption);
+
         parser.process(app);
-        if (parser.isSet(respawnOption))
+        // the supervisor handles crashes better
+        if (parser.isSet(respawnOption) && !Supervisor::isSupervised())
             setupSignalHandler();
         if (parser.isSet(configDirOption))
             grefsenConfigDirPath = parser.value(configDirOption);
         if (parser.isSet(logFileOption)) {
             logFilePath = parser.value(logFileOption);
-            qInstallMessageHandler(qtMsgLog);
+            asyncLog = new AsyncLog(logFilePath, parser.value(logRotateOption).toLongLong() * 1024);
+            if (asyncLog->isOpen()) {
+                qInstallMessageHandler(qtMsgLog);
+                qAddPostRoutine(stopLog);
+                // clients' output goes into the same log
+                LaunchService::instance()->setCaptureOutput(true);
+            } else {
+                delete asyncLog;
+                asyncLog = 0;
+            }
+        }
+        if (parser.isSet(traceOption)) {
+            // after the log file's handler, so that other messages are passed on to it
+            Tracer::instance()->setFilePath(parser.value(traceOption));
+            Tracer::instance()->complete("create QGuiApplication", mainStart, appCreated - mainStart);
         }
+        startupPhase("application created");
+        if (parser.isSet(socketNameOption))
+            socketName = parser.value(socketNameOption);
         if (parser.isSet(screenOption)) {
             QStringList scrNames = parser.values(screenOption);
             QList<QScreen *> keepers;
@@ -237,25 +437,78 @@ int main(int argc, char *argv[])
         }
         if (parser.isSet(windowOption))
             windowed = true;
+        if (parser.isSet(statsOption))
+            Instrumentation::instance()->setStatsFilePath(parser.value(statsOption));
+        if (parser.isSet(statsOverlayOption))
+            Instrumentation::instance()->setOverlayVisible(true);
+        DamageTracker::setPartialUpdate(parser.isSet(partialUpdateOption));
+        DamageTracker::setFlashRepaints(parser.isSet(flashRepaintsOption));
+        HardwareCursor::setSoftwareOnly(parser.isSet(softwareCursorOption));
+        ShmTextureCache::setEnabled(!parser.isSet(syncShmUploadOption));
+        if (parser.isSet(moveModeOption)) {
+            const QString mode = parser.value(moveModeOption);
+            if (mode == QLatin1String("outline"))
+                MoveController::setDefaultMode(MoveController::Outline);
+            else if (mode != QLatin1String("live"))
+                qWarning() << "unknown move mode" << mode << "; using live";
+        }
 
         screenCheck(screens);
+        OutputScheduler::selectRenderLoop(screens.count());
 
-        QFontDatabase fd;
-        if (!fd.families().contains(QLatin1String("FontAwesome")))
-            if (QFontDatabase::addApplicationFont(":/fonts/FontAwesome.otf"))
-                qWarning("failed to load FontAwesome from resources");
-        if (!fd.families().contains(QLatin1String("Manzanita")))
-            if (QFontDatabase::addApplicationFont(":/fonts/manzanit.pfb"))
-                qWarning("failed to load Manzanita font from resources");
+        Tracer::Scope fontsTrace("register fonts");
+        registerBundledFont("FontAwesome", QStringLiteral(":/fonts/FontAwesome.otf"));
+        registerBundledFont("Manzanita", QStringLiteral(":/fonts/manzanit.pfb"));
     }
 
-    registerTypes();
+    startupPhase("options and fonts done");
+
+    {
+        Tracer::Scope trace("register types");
+        registerTypes();
+    }
+    const bool dmabufImport = enableDmabufImport();
     qputenv("QT_QPA_PLATFORM", "wayland"); // not for grefsen but for child processes
+    if (Supervisor::isSupervised()) {
+        // clients use the supervisor's socket; the compositor's own is a spare, named so that
+        // the supervisor can clean it up after a crash
+        qputenv("WAYLAND_DISPLAY", Supervisor::socketName());
+        socketName = QString::fromLocal8Bit(Supervisor::socketName()) + QLatin1Char('-') +
+                QString::number(QCoreApplication::applicationPid());
+    } else if (!socketName.isEmpty()) {
+        qputenv("WAYLAND_DISPLAY", socketName.toLocal8Bit());
+    }
 
     QQmlApplicationEngine appEngine;
     appEngine.addImportPath(app.applicationDirPath() + QLatin1String("/imports"));
-    appEngine.load(QUrl("qrc:///qml/main.qml"));
+    GlyphProvider *glyphs = new GlyphProvider;
+    // the close buttons of Chrome and of QuitButton
+    glyphs->prewarm(QStringLiteral("f00d"), 20);
+    glyphs->prewarm(QStringLiteral("f00d/white"), 36);
+    appEngine.addImageProvider(QStringLiteral("glyph"), glyphs);
+    // an empty name means the default, $WAYLAND_DISPLAY or wayland-0
+    appEngine.rootContext()->setContextProperty(QStringLiteral("waylandSocketName"), socketName);
+    {
+        Tracer::Scope trace("load main.qml");
+        appEngine.load(QUrl("qrc:///qml/main.qml"));
+    }
+    if (dmabufImport) {
+        // the compositor has read it; QtWaylandClient reads the same name as the key of a
+        // single client plugin, so the clients must not inherit it
+        qunsetenv("QT_WAYLAND_CLIENT_BUFFER_INTEGRATION");
+        LaunchService::instance()->refreshEnvironment();
+    }
+    startupPhase("QML loaded");
     QObject *root = appEngine.rootObjects().first();
+    if (Supervisor::isSupervised()) {
+        QWaylandCompositor *compositor = qobject_cast<QWaylandCompositor *>(root);
+        const int fd = Supervisor::takeSocket();
+        if (compositor && fd >= 0 && wl_display_add_socket_fd(compositor->display(), fd) < 0) {
+            qWarning() << "failed to take over the Wayland socket" << Supervisor::socketName();
+            ::close(fd);
+        }
+        SessionStore::instance()->setFilePath(QString::fromLocal8Bit(Supervisor::sessionFilePath()));
+    }
     root->setProperty("fullscreenAllowed", !windowed);
     appEngine.rootContext()->setContextProperty(glassPaneName,
         root->findChild<QQuickItem*>(glassPaneName));
@@ -266,6 +519,18 @@ int main(int argc, char *argv[])
         QWindow * window = *windowIter;
         QScreen * screen = *screenIter;
         window->setScreen(screen);
+        if (QQuickWindow *quickWindow = qobject_cast<QQuickWindow *>(window)) {
+            Instrumentation::instance()->addWindow(quickWindow);
+            OutputScheduler::instance()->addWindow(quickWindow);
+            // frameSwapped comes from the render thread; disconnecting there is fine
+            QMetaObject::Connection *firstFrame = new QMetaObject::Connection;
+            const QByteArray phase = "first frame on " + screen->name().toLocal8Bit();
+            *firstFrame = QObject::connect(quickWindow, &QQuickWindow::frameSwapped, [firstFrame, phase]() {
+                startupPhase(phase.constData());
+                QObject::disconnect(*firstFrame);
+                delete firstFrame;
+            });
+        }
         if (windowed) {
             window->showNormal();
         } else {
@@ -275,6 +540,12 @@ int main(int argc, char *argv[])
         ++windowIter;
         ++screenIter;
     }
+    startupPhase("windows shown");
+    if (Supervisor::restarts() > 0)
+        SessionStore::instance()->restore();
 
-    return app.exec();
+    int ret = app.exec();
+    Instrumentation::instance()->dump();
+    Tracer::instance()->write();
+    return ret;
 }
@@ -0,0 +1,123 @@
+#include "movecontroller.h"
+#include <QGuiApplication>
+#include <QQuickWindow>
+#include <QStyleHints>
+
+static MoveController::Mode defaultMode = MoveController::Live;
+
+MoveController::MoveController(QObject *parent)
+    : QObject(parent)
+    , m_mode(defaultMode)
+{
+}
+
+void MoveController::setDefaultMode(Mode mode)
+{
+    defaultMode = mode;
+}
+
+void MoveController::setTarget(QQuickItem *target)
+{
+    if (m_target == target)
+        return;
+    if (m_moving)
+        finish();
+    m_target = target;
+    emit targetChanged();
+}
+
+void MoveController::setMode(Mode mode)
+{
+    if (m_mode == mode)
+        return;
+    // not in the middle of a move
+    if (m_moving)
+        finish();
+    m_mode = mode;
+    emit modeChanged();
+}
+
+QPointF MoveController::position() const
+{
+    if (m_moving || !m_target)
+        return m_position;
+    return m_target->position();
+}
+
+void MoveController::start(const QPointF &globalPos, QQuickItem *view)
+{
+    if (!m_target)
+        return;
+    if (m_moving)
+        finish();
+    m_pressPos = globalPos;
+    m_startPos = m_target->position();
+    m_position = m_startPos;
+    m_dragging = false;
+    m_hasPending = false;
+    m_awaitingFrame = false;
+    m_window = view ? view->window() : 0;
+    // frameSwapped comes from the render thread; handle it on ours
+    if (m_window)
+        connect(m_window, &QQuickWindow::frameSwapped, this, &MoveController::onFrameSwapped, Qt::QueuedConnection);
+    m_moving = true;
+    emit movingChanged();
+    emit positionChanged();
+}
+
+void MoveController::moveTo(const QPointF &globalPos)
+{
+    if (!m_moving)
+        return;
+    const QPointF delta = globalPos - m_pressPos;
+    if (!m_dragging) {
+        if (delta.manhattanLength() < QGuiApplication::styleHints()->startDragDistance())
+            return;
+        m_dragging = true;
+    }
+    m_pending = m_startPos + delta;
+    m_hasPending = true;
+    if (!m_awaitingFrame)
+        apply();
+}
+
+void MoveController::apply()
+{
+    m_hasPending = false;
+    if (m_mode == Live && m_target)
+        m_target->setPosition(m_pending);
+    if (m_position != m_pending) {
+        m_position = m_pending;
+        emit positionChanged();
+    }
+    if (!m_window)
+        return;
+    // the next position waits for the frame which shows this one
+    m_awaitingFrame = true;
+    m_window->update();
+}
+
+void MoveController::onFrameSwapped()
+{
+    m_awaitingFrame = false;
+    if (m_hasPending)
+        apply();
+}
+
+void MoveController::finish()
+{
+    if (!m_moving)
+        return;
+    if (m_window)
+        disconnect(m_window, &QQuickWindow::frameSwapped, this, &MoveController::onFrameSwapped);
+    m_window = 0;
+    if (m_hasPending)
+        m_position = m_pending;
+    m_hasPending = false;
+    m_awaitingFrame = false;
+    if (m_dragging && m_target)
+        m_target->setPosition(m_position);
+    m_moving = false;
+    emit movingChanged();
+    emit positionChanged();
+}
@@ -0,0 +1,85 @@
+#ifndef MOVECONTROLLER_H
+#define MOVECONTROLLER_H
+
+#include <QPointer>
+#include <QPointF>
+#include <QQuickItem>
+
+/*!
+    Paces an interactive move of a window.
+
+    The target is the per-surface moveItem, in global compositor
+    coordinates.  start() is called on press, moveTo() on every mouse
+    motion event, both with global pointer positions, so that nothing
+    depends on the view which is being dragged; and finish() on release.
+    The drag only starts beyond the platform's drag distance.
+
+    In Live mode the target is moved at most once per frame of the view's
+    window, so that the bindings of all the Chrome views of the window are
+    evaluated once per frame rather than once per event.  In Outline mode
+    the target stays where it is until finish(), and the views only
+    draw an outline at position (paced the same way), which is much
+    cheaper than moving a large client texture on a weak GPU.  The default
+    mode can be set with setDefaultMode() (--move-mode).
+*/
+class MoveController : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem *target READ target WRITE setTarget NOTIFY targetChanged)
+    Q_PROPERTY(Mode mode READ mode WRITE setMode NOTIFY modeChanged)
+    Q_PROPERTY(bool moving READ isMoving NOTIFY movingChanged)
+    Q_PROPERTY(QPointF position READ position NOTIFY positionChanged)
+
+public:
+    enum Mode {
+        Live,
+        Outline
+    };
+    Q_ENUM(Mode)
+
+    explicit MoveController(QObject *parent = 0);
+
+    static void setDefaultMode(Mode mode);
+
+    QQuickItem *target() const { return m_target; }
+    void setTarget(QQuickItem *target);
+
+    Mode mode() const { return m_mode; }
+    void setMode(Mode mode);
+
+    bool isMoving() const { return m_moving; }
+
+    // where the target is being moved to
+    QPointF position() const;
+
+    Q_INVOKABLE void start(const QPointF &globalPos, QQuickItem *view);
+    Q_INVOKABLE void moveTo(const QPointF &globalPos);
+    Q_INVOKABLE void finish();
+
+signals:
+    void targetChanged();
+    void modeChanged();
+    void movingChanged();
+    void positionChanged();
+
+protected slots:
+    void onFrameSwapped();
+
+protected:
+    void apply();
+
+protected:
+    QPointer<QQuickItem> m_target;
+    QPointer<QQuickWindow> m_window;
+    Mode m_mode;
+    QPointF m_pressPos;
+    QPointF m_startPos;
+    QPointF m_pending;
+    QPointF m_position;
+    bool m_moving = false;
+    bool m_dragging = false;
+    bool m_hasPending = false;
+    bool m_awaitingFrame = false;
+};
+
+#endif // MOVECONTROLLER_H
@@ -0,0 +1,291 @@
+#include "occlusionculler.h"
+#include "outputscheduler.h"
+#include "stackableitem.h"
+
+#include <QQuickWindow>
+#include <QWaylandClient>
+#include <QWaylandCompositor>
+#include <QWaylandQuickItem>
+#include <QWaylandQuickOutput>
+#include <QWaylandSurface>
+
+#include <algorithm>
+#include <limits.h>
+#include <wayland-server.h>
+
+OcclusionCuller::OcclusionCuller(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+    m_throttleTimer.setSingleShot(true);
+    connect(&m_throttleTimer, &QTimer::timeout, this, &OcclusionCuller::sendThrottledFrameCallbacks);
+}
+
+void OcclusionCuller::setStack(QQuickItem *stack)
+{
+    if (m_stack == stack)
+        return;
+    if (m_stack)
+        disconnect(m_stack, 0, this, 0);
+    for (QQuickItem *item : m_watched)
+        disconnect(item, 0, this, 0);
+    m_watched.clear();
+    m_stack = stack;
+    if (stack) {
+        connect(stack, &QQuickItem::childrenChanged, this, &OcclusionCuller::onChildrenChanged);
+        connect(stack, &QQuickItem::widthChanged, this, &OcclusionCuller::scheduleCull);
+        connect(stack, &QQuickItem::heightChanged, this, &OcclusionCuller::scheduleCull);
+        connect(stack, &QQuickItem::windowChanged, this, &OcclusionCuller::onWindowChanged);
+        onChildrenChanged();
+    }
+    onWindowChanged();
+    emit stackChanged();
+}
+
+void OcclusionCuller::setOutput(QWaylandQuickOutput *output)
+{
+    if (m_output == output)
+        return;
+    m_output = output;
+    emit outputChanged();
+}
+
+void OcclusionCuller::setOverlaysActive(bool active)
+{
+    if (m_overlaysActive == active)
+        return;
+    m_overlaysActive = active;
+    emit overlaysActiveChanged();
+    // uncover right away, before the overlay's first frame
+    cull();
+}
+
+void OcclusionCuller::onChildrenChanged()
+{
+    for (QQuickItem *item : m_stack->childItems())
+        watch(item);
+    scheduleCull();
+}
+
+void OcclusionCuller::watch(QQuickItem *item)
+{
+    if (m_watched.contains(item))
+        return;
+    m_watched.insert(item);
+    connect(item, &QObject::destroyed, this, [this, item]() {
+        m_watched.remove(item);
+        scheduleCull();
+    });
+    connect(item, &QQuickItem::visibleChanged, this, &OcclusionCuller::scheduleCull);
+    connect(item, &QQuickItem::opacityChanged, this, &OcclusionCuller::scheduleCull);
+    connect(item, &QQuickItem::xChanged, this, &OcclusionCuller::scheduleCull);
+    connect(item, &QQuickItem::yChanged, this, &OcclusionCuller::scheduleCull);
+    connect(item, &QQuickItem::widthChanged, this, &OcclusionCuller::scheduleCull);
+    connect(item, &QQuickItem::heightChanged, this, &OcclusionCuller::scheduleCull);
+    connect(item, &QQuickItem::zChanged, this, &OcclusionCuller::scheduleCull);
+    if (StackableItem *stackable = qobject_cast<StackableItem *>(item)) {
+        connect(stackable, &StackableItem::stackingChanged, this, &OcclusionCuller::scheduleCull);
+        connect(stackable, &StackableItem::opaqueRegionChanged, this, &OcclusionCuller::scheduleCull);
+    }
+}
+
+void OcclusionCuller::scheduleCull()
+{
+    // many changes tend to come at once, e.g. while a window is moved
+    if (m_cullPending)
+        return;
+    m_cullPending = true;
+    QMetaObject::invokeMethod(this, "cull", Qt::QueuedConnection);
+}
+
+void OcclusionCuller::cull()
+{
+    m_cullPending = false;
+    if (!m_stack)
+        return;
+    const QRect area = QRectF(0, 0, m_stack->width(), m_stack->height()).toAlignedRect();
+    QRegion covered;
+    QQuickItem *cover = 0;
+    QList<QQuickItem *> children = m_stack->childItems();
+    // childItems() is in paint order only for equal z
+    std::stable_sort(children.begin(), children.end(), [](QQuickItem *a, QQuickItem *b) { return a->z() < b->z(); });
+    for (int i = children.count() - 1; i >= 0; --i) {
+        StackableItem *item = qobject_cast<StackableItem *>(children.at(i));
+        if (!item)
+            continue;
+        // popups and transients are children which may reach outside the item
+        const QRect bounds = item->mapRectToItem(m_stack, item->boundingRect() | item->childrenRect())
+                .toAlignedRect() & area;
+        if (!m_overlaysActive && !bounds.isEmpty() && QRegion(bounds).subtracted(covered).isEmpty()) {
+            item->setOccluded(true);
+            continue;
+        }
+        // un-occluding first lets isVisible() say whether it would be visible
+        item->setOccluded(false);
+        if (m_overlaysActive || !item->isVisible() || item->opacity() < 1)
+            continue;
+        QRegion opaque;
+        for (const QRect &r : item->opaqueRegion().rects())
+            opaque += item->mapRectToItem(m_stack, r).toRect();
+        opaque &= area;
+        if (!opaque.isEmpty()) {
+            if (!cover && QRegion(area).subtracted(opaque).isEmpty())
+                cover = item;
+            covered += opaque;
+        }
+    }
+
+    if (m_coveringItem != cover) {
+        m_coveringItem = cover;
+        emit coveringItemChanged();
+    }
+    const bool backgroundOccluded = !m_overlaysActive && !area.isEmpty() && QRegion(area).subtracted(covered).isEmpty();
+    if (m_backgroundOccluded != backgroundOccluded) {
+        m_backgroundOccluded = backgroundOccluded;
+        emit backgroundOccludedChanged();
+    }
+}
+
+void OcclusionCuller::onWindowChanged()
+{
+    QQuickWindow *window = m_stack ? m_stack->window() : 0;
+    if (m_window == window)
+        return;
+    if (m_window)
+        disconnect(m_window, 0, this, 0);
+    m_window = window;
+    if (!window)
+        return;
+    // the same threads and connection types as QWaylandQuickOutput uses for automatic frame callbacks
+    connect(window, &QQuickWindow::beforeSynchronizing, this,
+            [this]() { onBeforeSynchronizing(); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterRendering, this,
+            [this]() { onAfterRendering(); }, Qt::DirectConnection);
+}
+
+void OcclusionCuller::collectSurfaces(QQuickItem *item, FrameCallbackPolicy::Visibility visibility, bool includeVisible,
+                                      QVector<QPointer<QWaylandSurface> > *surfaces, qint64 now, int *retryIn) const
+{
+    StackableItem *stackable = qobject_cast<StackableItem *>(item);
+    if (stackable && !stackable->isPrimaryView())
+        return;
+    // below an occluded item everything is invisible because of it
+    if (visibility == FrameCallbackPolicy::Visible) {
+        if (stackable && stackable->isOccluded())
+            visibility = FrameCallbackPolicy::Occluded;
+        else if (!item->isVisible())
+            visibility = FrameCallbackPolicy::Hidden;
+    }
+    if (QWaylandQuickItem *surfaceItem = qobject_cast<QWaylandQuickItem *>(item)) {
+        QWaylandSurface *surface = surfaceItem->surface();
+        if (surface && (includeVisible || visibility != FrameCallbackPolicy::Visible) && !surfaces->contains(surface) &&
+                FrameCallbackPolicy::instance()->wantsFrame(surface, visibility, now, retryIn))
+            surfaces->append(surface);
+    }
+    // subsurfaces are child items of their parent's surface item
+    for (QQuickItem *child : item->childItems())
+        collectSurfaces(child, visibility, includeVisible, surfaces, now, retryIn);
+}
+
+void OcclusionCuller::collectViewlessSurfaces(QVector<QPointer<QWaylandSurface> > *surfaces, qint64 now, int *retryIn) const
+{
+    // surfaces which no window shows (no role yet, drag icons and the like)
+    // are hidden; the culler of the default output paces them
+    if (!m_output || m_output != m_output->compositor()->defaultOutput())
+        return;
+    QWaylandCompositor *compositor = m_output->compositor();
+    for (QWaylandClient *client : compositor->clients()) {
+        for (QWaylandSurface *surface : compositor->surfacesForClient(client)) {
+            if (surface->views().isEmpty() && !surfaces->contains(surface) &&
+                    FrameCallbackPolicy::instance()->wantsFrame(surface, FrameCallbackPolicy::Hidden, now, retryIn))
+                surfaces->append(surface);
+        }
+    }
+}
+
+void OcclusionCuller::onBeforeSynchronizing()
+{
+    // the GUI thread is blocked, so the item tree may be read here
+    if (!m_output || m_output->automaticFrameCallback() || !m_window)
+        return;
+    QVector<QPointer<QWaylandSurface> > surfaces;
+    int retryIn = INT_MAX;
+    collectSurfaces(m_window->contentItem(), FrameCallbackPolicy::Visible, true, &surfaces, m_clock.elapsed(), &retryIn);
+    for (QWaylandSurface *surface : surfaces)
+        surface->frameStarted();
+    if (retryIn != INT_MAX)
+        QMetaObject::invokeMethod(this, "scheduleThrottledFrame", Qt::QueuedConnection, Q_ARG(int, retryIn));
+    QMutexLocker lock(&m_frameMutex);
+    m_frameSurfaces = surfaces;
+}
+
+void OcclusionCuller::scheduleThrottledFrame(int ms)
+{
+    // nothing else might send the callbacks while only hidden clients are busy
+    if (!m_throttleTimer.isActive() || m_throttleTimer.remainingTime() > ms)
+        m_throttleTimer.start(ms);
+}
+
+void OcclusionCuller::onAfterRendering()
+{
+    {
+        QMutexLocker lock(&m_frameMutex);
+        if (m_frameSurfaces.isEmpty())
+            return;
+        m_renderedSurfaces += m_frameSurfaces;
+        m_frameSurfaces.clear();
+    }
+    QMetaObject::invokeMethod(this, "sendFrameCallbacks", Qt::QueuedConnection);
+}
+
+void OcclusionCuller::sendFrameCallbacks()
+{
+    QVector<QPointer<QWaylandSurface> > surfaces;
+    {
+        QMutexLocker lock(&m_frameMutex);
+        surfaces.swap(m_renderedSurfaces);
+    }
+    if (!m_output)
+        return;
+    QVector<QPointer<QWaylandSurface> > viewless;
+    int retryIn = INT_MAX;
+    collectViewlessSurfaces(&viewless, m_clock.elapsed(), &retryIn);
+    for (QWaylandSurface *surface : viewless)
+        surface->frameStarted();
+    if (retryIn != INT_MAX)
+        scheduleThrottledFrame(retryIn);
+    sendCallbacks(surfaces + viewless);
+}
+
+void OcclusionCuller::sendThrottledFrameCallbacks()
+{
+    // throttled surfaces are not visible, so their callbacks don't need a
+    // frame to be rendered; visible ones get theirs when the window renders
+    if (!m_output || m_output->automaticFrameCallback() || !m_window)
+        return;
+    QVector<QPointer<QWaylandSurface> > surfaces;
+    int retryIn = INT_MAX;
+    const qint64 now = m_clock.elapsed();
+    collectSurfaces(m_window->contentItem(), FrameCallbackPolicy::Visible, false, &surfaces, now, &retryIn);
+    collectViewlessSurfaces(&surfaces, now, &retryIn);
+    for (QWaylandSurface *surface : surfaces)
+        surface->frameStarted();
+    if (retryIn != INT_MAX)
+        scheduleThrottledFrame(retryIn);
+    sendCallbacks(surfaces);
+}
+
+void OcclusionCuller::sendCallbacks(const QVector<QPointer<QWaylandSurface> > &surfaces)
+{
+    if (surfaces.isEmpty())
+        return;
+    int sent = 0;
+    for (QWaylandSurface *surface : surfaces) {
+        if (surface && surface->hasContent()) {
+            surface->sendFrameCallbacks();
+            ++sent;
+        }
+    }
+    OutputScheduler::instance()->frameCallbacksSent(m_window, sent);
+    wl_display_flush_clients(m_output->compositor()->display());
+}
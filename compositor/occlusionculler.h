@@ -0,0 +1,111 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QQuickItem>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include "framecallbackpolicy.h"
+
+class QQuickWindow;
+class QWaylandQuickOutput;
+class QWaylandSurface;
+class StackableItem;
+
+/*!
+    Stops rendering, and stops clients from rendering, what can't be seen
+    on an output.
+
+    Walks the children of the stack item (the compositorArea of a Screen)
+    from the top down, accumulating the opaque regions of the visible
+    StackableItems (see StackableItem::opaqueRegion()).  An item entirely
+    inside the region covered by the items above it is marked occluded, and
+    so is the background when the stack is covered completely.  Nothing is
+    culled while overlaysActive is set, because popovers and panels above
+    the stack may be translucent.  Partly covered items are left alone: the
+    scene graph renders opaque content front to back with depth testing,
+    so covered pixels of opaque surfaces are not shaded anyway.
+
+    If output is set, its automatic frame callbacks should be turned off:
+    instead, the surfaces in the output's window get their frame callbacks
+    as FrameCallbackPolicy decides, and only from the window which has their
+    primary view.  So clients which are completely hidden stop rendering,
+    or render less often.  Throttled clients can't be seen, so their
+    callbacks are sent from a timer without rendering a frame.  Surfaces
+    which have no view at all count as hidden, and are paced by the culler
+    of the compositor's default output.
+
+    Qt Quick has no way to put a client buffer directly onto a KMS plane,
+    so a fullscreen window is still composited; but only that window.
+*/
+class OcclusionCuller : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem *stack READ stack WRITE setStack NOTIFY stackChanged)
+    Q_PROPERTY(QWaylandQuickOutput *output READ output WRITE setOutput NOTIFY outputChanged)
+    Q_PROPERTY(bool overlaysActive READ overlaysActive WRITE setOverlaysActive NOTIFY overlaysActiveChanged)
+    Q_PROPERTY(bool backgroundOccluded READ backgroundOccluded NOTIFY backgroundOccludedChanged)
+    Q_PROPERTY(QQuickItem *coveringItem READ coveringItem NOTIFY coveringItemChanged)
+
+public:
+    explicit OcclusionCuller(QObject *parent = 0);
+
+    QQuickItem *stack() const { return m_stack; }
+    void setStack(QQuickItem *stack);
+
+    QWaylandQuickOutput *output() const { return m_output; }
+    void setOutput(QWaylandQuickOutput *output);
+
+    bool overlaysActive() const { return m_overlaysActive; }
+    void setOverlaysActive(bool active);
+
+    bool backgroundOccluded() const { return m_backgroundOccluded; }
+    QQuickItem *coveringItem() const { return m_coveringItem; }
+
+signals:
+    void stackChanged();
+    void outputChanged();
+    void overlaysActiveChanged();
+    void backgroundOccludedChanged();
+    void coveringItemChanged();
+
+protected slots:
+    void scheduleCull();
+    void cull();
+    void onChildrenChanged();
+    void onWindowChanged();
+    void sendFrameCallbacks();
+    void sendThrottledFrameCallbacks();
+    void scheduleThrottledFrame(int ms);
+
+protected:
+    void watch(QQuickItem *item);
+    void onBeforeSynchronizing();
+    void onAfterRendering();
+    void collectSurfaces(QQuickItem *item, FrameCallbackPolicy::Visibility visibility, bool includeVisible,
+                         QVector<QPointer<QWaylandSurface> > *surfaces, qint64 now, int *retryIn) const;
+    void collectViewlessSurfaces(QVector<QPointer<QWaylandSurface> > *surfaces, qint64 now, int *retryIn) const;
+    void sendCallbacks(const QVector<QPointer<QWaylandSurface> > &surfaces);
+
+protected:
+    QPointer<QQuickItem> m_stack;
+    QPointer<QWaylandQuickOutput> m_output;
+    QPointer<QQuickWindow> m_window;
+    QPointer<QQuickItem> m_coveringItem;
+    QSet<QQuickItem *> m_watched;
+    bool m_overlaysActive = false;
+    bool m_backgroundOccluded = false;
+    bool m_cullPending = false;
+
+    QMutex m_frameMutex; // guards the surface lists, which are touched from the render thread
+    QVector<QPointer<QWaylandSurface> > m_frameSurfaces; // frame started, not rendered yet
+    QVector<QPointer<QWaylandSurface> > m_renderedSurfaces; // rendered, callbacks not sent yet
+    QElapsedTimer m_clock;
+    QTimer m_throttleTimer; // to send the callbacks of throttled surfaces when they are due
+};
+
+#endif // OCCLUSIONCULLER_H
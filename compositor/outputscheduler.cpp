@@ -0,0 +1,172 @@
+#include "outputscheduler.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QQuickWindow>
+#include <QScreen>
+#include <QThread>
+
+#include <algorithm>
+
+// longer gaps between swaps are idle time, which says nothing about the vsync
+static const qreal MaxVsyncInterval = 100; // ms
+// a frame still in flight after this many vsync intervals didn't render at all
+// (nothing had changed), so it doesn't hold back the next one
+static const int InFlightIntervals = 2;
+
+OutputScheduler *OutputScheduler::instance()
+{
+    static OutputScheduler *ret = new OutputScheduler;
+    return ret;
+}
+
+OutputScheduler::OutputScheduler()
+{
+    m_clock.start();
+}
+
+void OutputScheduler::selectRenderLoop(int screenCount)
+{
+    // must happen before the first QQuickWindow is created; an explicit choice wins
+    if (screenCount > 1 && !qEnvironmentVariableIsSet("QSG_RENDER_LOOP"))
+        qputenv("QSG_RENDER_LOOP", "threaded");
+}
+
+void OutputScheduler::addWindow(QQuickWindow *window)
+{
+    Output *output = new Output;
+    output->window = window;
+    if (window->screen() && window->screen()->refreshRate() > 1)
+        output->vsyncInterval = 1000 / window->screen()->refreshRate();
+    output->releaseTimer = new QTimer(this);
+    output->releaseTimer->setSingleShot(true);
+    connect(output->releaseTimer, &QTimer::timeout, this, [this, output]() { releaseUpdate(output); });
+    {
+        QMutexLocker lock(&m_mutex);
+        m_outputs << output;
+    }
+    // these come from the render thread, if there is one
+    connect(window, &QQuickWindow::sceneGraphInitialized, this,
+            [this, output]() { onSceneGraphInitialized(output); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::beforeSynchronizing, this,
+            [this, output]() { onBeforeSynchronizing(output); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped, this,
+            [this, output]() { onFrameSwapped(output); }, Qt::DirectConnection);
+    window->installEventFilter(this);
+}
+
+OutputScheduler::Output *OutputScheduler::output(const QObject *window) const
+{
+    for (Output *output : m_outputs) {
+        if (output->window.data() == window)
+            return output;
+    }
+    return 0;
+}
+
+void OutputScheduler::onSceneGraphInitialized(Output *output)
+{
+    const bool threaded = QThread::currentThread() != QCoreApplication::instance()->thread();
+    QMutexLocker lock(&m_mutex);
+    output->threaded = threaded;
+    if (!threaded && m_outputs.count() > 1 && !m_warnedNotThreaded) {
+        m_warnedNotThreaded = true;
+        qWarning("the Qt Quick render loop is not threaded: all outputs render on the GUI thread, "
+                 "at the pace of the slowest");
+    }
+}
+
+void OutputScheduler::onBeforeSynchronizing(Output *output)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    QMutexLocker lock(&m_mutex);
+    output->frameStartNs = now;
+}
+
+void OutputScheduler::onFrameSwapped(Output *output)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    QMutexLocker lock(&m_mutex);
+    if (output->lastSwapNs) {
+        const qreal interval = (now - output->lastSwapNs) / 1e6;
+        if (interval < MaxVsyncInterval) {
+            output->intervals[output->intervalCount++ % VsyncSamples] = interval;
+            // the median, so that the occasional missed vsync doesn't count
+            const int n = qMin(output->intervalCount, int(VsyncSamples));
+            qreal sorted[VsyncSamples];
+            std::copy(output->intervals, output->intervals + n, sorted);
+            std::nth_element(sorted, sorted + n / 2, sorted + n);
+            output->vsyncInterval = sorted[n / 2];
+        }
+    }
+    output->lastSwapNs = now;
+    output->frameStartNs = 0;
+    if (output->updateDeferred && output->window) {
+        output->updateDeferred = false;
+        // postEvent is thread-safe; the window handles it on the GUI thread
+        QCoreApplication::postEvent(output->window, new QEvent(QEvent::UpdateRequest));
+    }
+}
+
+void OutputScheduler::releaseUpdate(Output *output)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!output->updateDeferred || !output->window)
+        return;
+    output->updateDeferred = false;
+    output->frameStartNs = 0;
+    QCoreApplication::postEvent(output->window, new QEvent(QEvent::UpdateRequest));
+}
+
+bool OutputScheduler::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() != QEvent::UpdateRequest)
+        return false;
+    const qint64 now = m_clock.nsecsElapsed();
+    QMutexLocker lock(&m_mutex);
+    Output *output = this->output(watched);
+    if (!output || !output->threaded || !output->frameStartNs)
+        return false;
+    const qint64 inFlightNs = qint64(output->vsyncInterval * InFlightIntervals * 1e6);
+    const qint64 remainingNs = output->frameStartNs + inFlightNs - now;
+    if (remainingNs <= 0)
+        return false;
+    // polishing and syncing now would block until the render thread is done
+    if (!output->updateDeferred) {
+        output->updateDeferred = true;
+        ++output->deferredUpdates;
+        output->releaseTimer->start(int(remainingNs / 1000000) + 1);
+    }
+    return true;
+}
+
+void OutputScheduler::frameCallbacksSent(QQuickWindow *window, int surfaces)
+{
+    QMutexLocker lock(&m_mutex);
+    if (Output *output = this->output(window))
+        output->frameCallbacks += surfaces;
+}
+
+QVariantMap OutputScheduler::outputData(QQuickWindow *window) const
+{
+    QVariantMap ret;
+    QMutexLocker lock(&m_mutex);
+    const Output *output = this->output(window);
+    if (!output)
+        return ret;
+    ret.insert(QStringLiteral("threaded"), output->threaded);
+    ret.insert(QStringLiteral("vsyncInterval"), output->vsyncInterval);
+    ret.insert(QStringLiteral("deferredUpdates"), output->deferredUpdates);
+    ret.insert(QStringLiteral("frameCallbacks"), output->frameCallbacks);
+    return ret;
+}
+
+void OutputScheduler::reset()
+{
+    QMutexLocker lock(&m_mutex);
+    for (Output *output : m_outputs) {
+        output->deferredUpdates = 0;
+        output->frameCallbacks = 0;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef OUTPUTSCHEDULER_H
+#define OUTPUTSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+class QQuickWindow;
+
+/*!
+    Keeps the outputs from holding each other up.
+
+    Each output is a QQuickWindow of its own.  With Qt Quick's threaded
+    render loop each of them renders on its own thread and waits for its
+    own vsync; selectRenderLoop() asks for that when there is more than one
+    screen, since the basic loop renders all windows on the GUI thread, one
+    after the other, so that every output runs at the pace of the slowest.
+
+    Even then, starting a frame (polish and sync) blocks the GUI thread
+    until that window's render thread has finished the frame before,
+    so an update requested while a 30 Hz output is still busy would keep
+    the GUI thread, and thereby the clients and all other outputs, waiting
+    for up to 33 ms.  So update requests for an output whose previous frame
+    is still in flight are held back, and delivered when that frame has
+    been swapped.
+
+    Frame callbacks are sent per output by OcclusionCuller, from the window
+    which has the surface's primary view, right after that window has
+    rendered; so a client is paced by the output it is mainly shown on.
+
+    The scheduler also estimates each output's actual vsync interval from
+    its swaps, and counts the frame callbacks sent and the updates held
+    back; Instrumentation includes these in its output statistics.
+*/
+class OutputScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static OutputScheduler *instance();
+    static void selectRenderLoop(int screenCount);
+
+    void addWindow(QQuickWindow *window);
+    void frameCallbacksSent(QQuickWindow *window, int surfaces);
+    QVariantMap outputData(QQuickWindow *window) const;
+    void reset();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) Q_DECL_OVERRIDE;
+
+protected:
+    OutputScheduler();
+
+    enum { VsyncSamples = 16 };
+
+    struct Output {
+        QPointer<QQuickWindow> window;
+        bool threaded = false;
+        bool updateDeferred = false;
+        qint64 frameStartNs = 0; // sync started; 0 when no frame is in flight
+        qint64 lastSwapNs = 0;
+        qreal vsyncInterval = 1000.0 / 60; // ms
+        qreal intervals[VsyncSamples];
+        int intervalCount = 0;
+        quint64 deferredUpdates = 0;
+        quint64 frameCallbacks = 0;
+        QTimer *releaseTimer = 0; // delivers a held back update if no swap comes
+    };
+
+    Output *output(const QObject *window) const;
+    void onSceneGraphInitialized(Output *output);
+    void onBeforeSynchronizing(Output *output);
+    void onFrameSwapped(Output *output);
+    void releaseUpdate(Output *output);
+
+protected:
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex; // guards the Outputs, which are updated from render threads
+    QVector<Output *> m_outputs;
+    bool m_warnedNotThreaded = false;
+};
+
+#endif // OUTPUTSCHEDULER_H
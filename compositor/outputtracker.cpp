@@ -0,0 +1,142 @@
+#include "outputtracker.h"
+
+OutputTracker::OutputTracker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void OutputTracker::setTarget(QQuickItem *target)
+{
+    if (m_target == target)
+        return;
+    if (m_target)
+        disconnect(m_target, 0, this, 0);
+    m_target = target;
+    if (target) {
+        connect(target, &QQuickItem::xChanged, this, &OutputTracker::update);
+        connect(target, &QQuickItem::yChanged, this, &OutputTracker::update);
+        connect(target, &QQuickItem::widthChanged, this, &OutputTracker::update);
+        connect(target, &QQuickItem::heightChanged, this, &OutputTracker::update);
+    }
+    emit targetChanged();
+    update();
+}
+
+void OutputTracker::setOutputs(const QVariantList &outputs)
+{
+    if (m_outputs == outputs)
+        return;
+    m_outputs = outputs;
+    // outputs are known only by their geometry; when one goes away, those
+    // after it move up in the list, and whether the window is inside them
+    // has to move along.  Views on outputs which have gone away go with their
+    // windows; a new output (or one with a new geometry) starts out empty.
+    QVector<QRectF> oldRects = m_outputRects;
+    const QVector<bool> oldInside = m_inside;
+    const int oldPrimary = m_primaryOutput;
+    m_outputRects.clear();
+    m_inside.clear();
+    m_primaryOutput = -1;
+    for (const QVariant &o : outputs) {
+        const QRectF rect = o.toRectF();
+        const int old = oldRects.indexOf(rect);
+        if (old >= 0 && old == oldPrimary)
+            m_primaryOutput = m_outputRects.count();
+        m_outputRects << rect;
+        m_inside << (old >= 0 && oldInside.at(old));
+        if (old >= 0)
+            oldRects[old] = QRectF(); // each old output matches once
+    }
+    if (m_primaryOutput != oldPrimary)
+        emit primaryOutputChanged();
+    emit outputsChanged();
+    update();
+}
+
+void OutputTracker::setDecorationWidth(qreal w)
+{
+    if (qFuzzyCompare(m_decorationWidth, w))
+        return;
+    m_decorationWidth = w;
+    emit decorationSizeChanged();
+    update();
+}
+
+void OutputTracker::setDecorationHeight(qreal h)
+{
+    if (qFuzzyCompare(m_decorationHeight, h))
+        return;
+    m_decorationHeight = h;
+    emit decorationSizeChanged();
+    update();
+}
+
+void OutputTracker::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+    emit enabledChanged();
+    update();
+}
+
+void OutputTracker::setKeepViews(bool keep)
+{
+    if (m_keepViews == keep)
+        return;
+    m_keepViews = keep;
+    emit keepViewsChanged();
+    update();
+}
+
+bool OutputTracker::intersects(int output) const
+{
+    return output >= 0 && output < m_inside.count() && m_inside.at(output);
+}
+
+void OutputTracker::update()
+{
+    if (!m_enabled || !m_target)
+        return;
+    const QRectF frame(m_target->x(), m_target->y(),
+                       m_target->width() + m_decorationWidth, m_target->height() + m_decorationHeight);
+    QVector<bool> wanted(m_outputRects.count(), false);
+    int primary = -1;
+    qreal primaryArea = 0;
+    int wantedCount = 0;
+    for (int i = 0; i < m_outputRects.count(); ++i) {
+        const QRectF overlap = frame.intersected(m_outputRects.at(i));
+        if (overlap.isEmpty())
+            continue;
+        wanted[i] = true;
+        ++wantedCount;
+        const qreal area = overlap.width() * overlap.height();
+        if (primary < 0 || area > primaryArea) {
+            primary = i;
+            primaryArea = area;
+        }
+    }
+
+    for (int i = 0; i < wanted.count(); ++i) {
+        if (wanted.at(i) && !m_inside.at(i)) {
+            m_inside[i] = true;
+            emit outputEntered(i);
+        }
+    }
+    // entering is done first, so that there is always at least one view
+    if (!m_keepViews && wantedCount > 0) {
+        for (int i = 0; i < wanted.count(); ++i) {
+            if (!wanted.at(i) && m_inside.at(i)) {
+                m_inside[i] = false;
+                emit outputLeft(i);
+            }
+        }
+    }
+
+    if (primary < 0)
+        primary = m_primaryOutput; // off all outputs: stay where it was
+    if (primary != m_primaryOutput) {
+        m_primaryOutput = primary;
+        emit primaryOutputChanged();
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef OUTPUTTRACKER_H
+#define OUTPUTTRACKER_H
+
+#include <QPointer>
+#include <QQuickItem>
+#include <QRectF>
+#include <QVariantList>
+#include <QVector>
+
+/*!
+    Tracks which outputs a window overlaps.
+
+    The target is the per-surface moveItem, whose geometry is in global
+    compositor coordinates; decorationWidth and decorationHeight are added to
+    its size to get the extent of the Chrome around it.  outputEntered() is
+    emitted when the window starts to intersect an output, and outputLeft()
+    when it no longer does, so that a view can be created only for the
+    outputs where the window is actually visible.  While keepViews is set
+    (during an interactive move, for example) no output is left; and the
+    last output a window was on is never left, so that it can't get lost.
+*/
+class OutputTracker : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem *target READ target WRITE setTarget NOTIFY targetChanged)
+    Q_PROPERTY(QVariantList outputs READ outputs WRITE setOutputs NOTIFY outputsChanged)
+    Q_PROPERTY(qreal decorationWidth READ decorationWidth WRITE setDecorationWidth NOTIFY decorationSizeChanged)
+    Q_PROPERTY(qreal decorationHeight READ decorationHeight WRITE setDecorationHeight NOTIFY decorationSizeChanged)
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool keepViews READ keepViews WRITE setKeepViews NOTIFY keepViewsChanged)
+    Q_PROPERTY(int primaryOutput READ primaryOutput NOTIFY primaryOutputChanged)
+
+public:
+    explicit OutputTracker(QObject *parent = 0);
+
+    QQuickItem *target() const { return m_target; }
+    void setTarget(QQuickItem *target);
+
+    QVariantList outputs() const { return m_outputs; }
+    void setOutputs(const QVariantList &outputs);
+
+    qreal decorationWidth() const { return m_decorationWidth; }
+    void setDecorationWidth(qreal w);
+    qreal decorationHeight() const { return m_decorationHeight; }
+    void setDecorationHeight(qreal h);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    bool keepViews() const { return m_keepViews; }
+    void setKeepViews(bool keep);
+
+    int primaryOutput() const { return m_primaryOutput; }
+
+    Q_INVOKABLE bool intersects(int output) const;
+
+signals:
+    void targetChanged();
+    void outputsChanged();
+    void decorationSizeChanged();
+    void enabledChanged();
+    void keepViewsChanged();
+    void primaryOutputChanged();
+    void outputEntered(int output);
+    void outputLeft(int output);
+
+protected slots:
+    void update();
+
+protected:
+    QPointer<QQuickItem> m_target;
+    QVariantList m_outputs;
+    QVector<QRectF> m_outputRects;
+    QVector<bool> m_inside;
+    qreal m_decorationWidth = 0;
+    qreal m_decorationHeight = 0;
+    int m_primaryOutput = -1;
+    bool m_enabled = true;
+    bool m_keepViews = false;
+};
+
+#endif // OUTPUTTRACKER_H
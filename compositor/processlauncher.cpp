@@ -17,7 +17,7 @@
 ****************************************************************************/
 
 #include "processlauncher.h"
-#include <QDebug>
+#include "launchservice.h"
 
 WaylandProcessLauncher::WaylandProcessLauncher(QObject *parent)
     : QObject(parent)
@@ -30,36 +30,5 @@ WaylandProcessLauncher::~WaylandProcessLauncher()
 
 void WaylandProcessLauncher::launch(const QString &program)
 {
-    QProcess *process = new QProcess(this);
-
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    process->setProcessEnvironment(env);
-
-    connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-            process, &QProcess::deleteLater);
-    connect(process, &QProcess::errorOccurred, &QProcess::deleteLater);
-    connect(process, &QProcess::errorOccurred, this, &WaylandProcessLauncher::onError);
-    connect(process, &QProcess::stateChanged, this, &WaylandProcessLauncher::onStateChanged);
-
-    QStringList arguments;
-    arguments << "-platform" << "wayland";
-    process->start(program, arguments);
-
+    LaunchService::instance()->launch(program);
 }
-
-void WaylandProcessLauncher::onError(QProcess::ProcessError error)
-{
-    QProcess *proc = qobject_cast<QProcess *>(sender());
-    qWarning() << error << "from" << proc;
-    if (proc)
-        qWarning() << proc->readAllStandardError();
-}
-
-void WaylandProcessLauncher::onStateChanged(QProcess::ProcessState state)
-{
-    QProcess *proc = qobject_cast<QProcess *>(sender());
-    qDebug() << proc << "state changed" << state;
-    if (proc)
-        qDebug() << proc->readAllStandardError();
-}
-
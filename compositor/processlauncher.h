@@ -20,9 +20,8 @@
 #define PROCESSLAUNCHER_H
 
 #include <QObject>
-#include <QProcess>
-
 
+// kept for existing configs: LaunchService does the work
 class WaylandProcessLauncher : public QObject
 {
     Q_OBJECT
@@ -31,9 +30,6 @@ public:
     explicit WaylandProcessLauncher(QObject *parent = 0);
     ~WaylandProcessLauncher();
     Q_INVOKABLE void launch(const QString &program);
-protected slots:
-    void onError(QProcess::ProcessError error);
-    void onStateChanged(QProcess::ProcessState state);
 };
 
 #endif // PROCESSLAUNCHER_H
@@ -0,0 +1,52 @@
+import QtQuick 2.6
+import com.theqtcompany.wlcompositor 1.0
+
+/*!
+    The window list shown while alt-tabbing; releasing Alt activates the
+    chosen window, Escape cancels.
+*/
+Rectangle {
+    id: root
+    anchors.centerIn: parent
+    width: 400
+    height: Math.min(list.contentHeight, parent.height * 0.8) + 20
+    color: "#d0333333"
+    border.color: "#FF6600"
+    border.width: 2
+    radius: 10
+    visible: activeFocus && WindowStack.cycleIndex >= 0
+
+    function step(n) {
+        if (WindowStack.cycle(n))
+            forceActiveFocus()
+    }
+
+    onActiveFocusChanged: if (!activeFocus) WindowStack.cancelCycle()
+    Keys.onReleased: if (event.key === Qt.Key_Alt) WindowStack.commitCycle()
+    Keys.onPressed: {
+        if (event.key === Qt.Key_Backtab)
+            step(-1)
+        else if (event.key === Qt.Key_Tab)
+            step(1)
+        else if (event.key === Qt.Key_Escape)
+            WindowStack.cancelCycle()
+    }
+
+    ListView {
+        id: list
+        anchors.fill: parent
+        anchors.margins: 10
+        interactive: false
+        model: WindowStack.altTabModel
+        currentIndex: WindowStack.cycleIndex
+        highlight: Rectangle { color: "#FF6600"; radius: 4 }
+        highlightMoveDuration: 0
+        delegate: Text {
+            width: list.width
+            padding: 4
+            color: "white"
+            elide: Text.ElideRight
+            text: model.title || qsTr("untitled")
+        }
+    }
+}
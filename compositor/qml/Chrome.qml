@@ -18,7 +18,6 @@
 
 import QtQuick 2.6
 import QtWayland.Compositor 1.0
-import QtGraphicalEffects 1.0
 import com.theqtcompany.wlcompositor 1.0
 
 StackableItem {
@@ -32,21 +31,54 @@ StackableItem {
     property int marginWidth : surfaceItem.isFullscreen ? 0 : (surfaceItem.isPopup ? 1 : 6)
     property int titlebarHeight : surfaceItem.isPopup || surfaceItem.isFullscreen ? 0 : 25
     property string screenName: ""
+    // the window's own OutputTracker, if it has one; the primary view tells it the size of the Chrome
+    property QtObject outputTracker: null
 
     x: surfaceItem.moveItem.x - surfaceItem.output.geometry.x
     y: surfaceItem.moveItem.y - surfaceItem.output.geometry.y
     height: surfaceItem.height + marginWidth + titlebarHeight
     width: surfaceItem.width + 2 * marginWidth
-    visible: surfaceItem.valid
+    visible: surfaceItem.valid && !occluded
+    // a fullscreen surface is assumed to be opaque, whatever its buffer format
+    opaqueRect: surfaceItem.isFullscreen && !surfaceItem.moveItem.moving ?
+                    Qt.rect(surfaceItem.x, surfaceItem.y, surfaceItem.width, surfaceItem.height) : Qt.rect(0, 0, 0, 0)
+    waylandItem: surfaceItem // opaque if its buffer is
+    stackKey: shellSurface
+    stackLayer: surfaceItem.isFullscreen ? WindowStack.Fullscreen : surfaceItem.isPopup ? WindowStack.Popup : WindowStack.Normal
 
-    Rectangle {
+    Binding {
+        target: rootChrome.outputTracker
+        property: "decorationWidth"
+        value: 2 * rootChrome.marginWidth
+        when: rootChrome.outputTracker !== null && rootChrome.primaryView
+    }
+    Binding {
+        target: rootChrome.outputTracker
+        property: "decorationHeight"
+        value: rootChrome.marginWidth + rootChrome.titlebarHeight
+        when: rootChrome.outputTracker !== null && rootChrome.primaryView
+    }
+
+    Component.onCompleted: Instrumentation.count("chromes", 1)
+    Component.onDestruction: Instrumentation.count("chromes", -1)
+
+    Decoration {
         id: decoration
         anchors.fill: parent
-        border.width: 1
+        borderWidth: 1
         radius: marginWidth
-        border.color: (resizeArea.pressed || resizeArea.containsMouse) ? "#ffc02020" :"#305070a0"
+        borderColor: (resizeArea.pressed || resizeArea.containsMouse) ? "#ffc02020" :"#305070a0"
         color: "#50ffffff"
         visible: rootChrome.decorationVisible && !surfaceItem.isFullscreen
+        titlebarRect: titlebar.visible ? Qt.rect(titlebar.x, titlebar.y, titlebar.width, titlebar.height) : Qt.rect(0, 0, 0, 0)
+        titlebarTopColor: "#50ffffff"
+        titlebarBottomColor: "#e0ffffff"
+        glowRect: closeButton.visible && titlebar.visible ?
+                      Qt.rect(titlebar.x + closeButton.x + closeIcon.x + 2, titlebar.y + closeButton.y + closeIcon.y + 2,
+                              closeIcon.width - 4, closeIcon.height - 4) : Qt.rect(0, 0, 0, 0)
+        glowRadius: 5
+        glowColor: "red"
+        glowOpacity: closeButton.containsMouse ? 0.5 : 0
 
         MouseArea {
             id: resizeArea
@@ -69,7 +101,7 @@ StackableItem {
                 if (mouse.x > rootChrome.width - titlebarHeight)
                     edges |= 8 //right edge
             }
-            onMouseXChanged: {
+            function resize(mouse) {
                 if (pressed) {
                     var w = startW
                     var h = startH
@@ -78,9 +110,10 @@ StackableItem {
                     if (edges & 4)
                         h += mouse.y - pressY
                     rootChrome.requestSize(w, h)
-                    console.log("resize " + rootChrome + " " + rootChrome.x + ", ", rootChrome.y)
                 }
             }
+            onMouseXChanged: resize(mouse)
+            onMouseYChanged: resize(mouse)
         }
 
         Item {
@@ -92,16 +125,6 @@ StackableItem {
             height: titlebarHeight - marginWidth
             visible: !surfaceItem.isPopup
 
-            LinearGradient {
-                anchors.fill: parent
-                start: Qt.point(0, 0)
-                end: Qt.point(0, height)
-                gradient: Gradient {
-                    GradientStop { position: 0.0; color: "#50ffffff" }
-                    GradientStop { position: 1.0; color: "#e0ffffff" }
-                }
-            }
-
             Text {
                 color: "gray"
                 text: surfaceItem.shellSurface ? surfaceItem.shellSurface.title : ""
@@ -114,11 +137,10 @@ StackableItem {
             MouseArea {
                 id: moveArea
                 anchors.fill: parent
-                drag.target: surfaceItem.moveItem
                 hoverEnabled: true
                 acceptedButtons: Qt.LeftButton | Qt.MiddleButton |Qt.RightButton
                 onPressed: {
-                    surfaceItem.moveItem.moving = true
+                    surfaceItem.moveItem.mover.start(mapToGlobal(mouse.x, mouse.y), rootChrome)
                     if (mouse.button === Qt.LeftButton) {
                         rootChrome.raise()
                     } else if (mouse.button === Qt.RightButton) {
@@ -128,7 +150,9 @@ StackableItem {
                         rootChrome.lower()
                     }
                 }
-                onReleased: surfaceItem.moveItem.moving = false
+                onPositionChanged: if (pressed) surfaceItem.moveItem.mover.moveTo(mapToGlobal(mouse.x, mouse.y))
+                onReleased: surfaceItem.moveItem.mover.finish()
+                onCanceled: surfaceItem.moveItem.mover.finish()
                 //cursorShape: Qt.OpenHandCursor
             }
 
@@ -142,29 +166,24 @@ StackableItem {
                 anchors.verticalCenter: parent.verticalCenter
                 onClicked: shellSurface.surface.client.close()
                 hoverEnabled: true
-                RectangularGlow {
-                    id: effect
-                    anchors.fill: closeIcon
-                    anchors.margins: 2
-                    glowRadius: 5
-                    cornerRadius: glowRadius
-                    spread: 0.4
-                    color: "red"
-                    opacity: parent.containsMouse ? 0.5 : 0
-                }
-                Text {
+                Image {
                     id: closeIcon
                     anchors.centerIn: parent
-                    font.pixelSize: parent.height
-                    font.family: "FontAwesome"
-                    text: "\uf00d"
+                    source: "image://glyph/f00d" // prerendered at this size: see main.cpp
+                    sourceSize.height: parent.height
                 }
             }
         }
     }
     function requestSize(w, h) {
         //console.log("request size " + w + ", " + h)
-        surfaceItem.shellSurface.sendConfigure(Qt.size(w - 2 * marginWidth, h - titlebarHeight - marginWidth), WlShellSurface.DefaultEdge)
+        resizeController.requestSize(w - 2 * marginWidth, h - titlebarHeight - marginWidth)
+    }
+
+    ResizeController {
+        id: resizeController
+        target: surfaceItem
+        onConfigure: surfaceItem.shellSurface.sendConfigure(Qt.size(width, height), WlShellSurface.DefaultEdge)
     }
 
     SequentialAnimation {
@@ -211,10 +230,20 @@ StackableItem {
         property bool isTransient: false
         property bool isFullscreen: false
 
-        opacity: surfaceItem.moveItem.moving ? 0.5 : 1.0
-
         x: marginWidth
         y: titlebarHeight
+        // shm buffers are uploaded once for all outputs, on a thread of their own
+        paintEnabled: !shmView.active
+
+        ShmSurfaceItem {
+            id: shmView
+            anchors.fill: parent
+        }
+
+        Connections {
+            target: WindowStack
+            onActivated: if (window === rootChrome.shellSurface && rootChrome.primaryView) surfaceItem.takeFocus()
+        }
 
         Connections {
             target: shellSurface
@@ -233,8 +262,12 @@ StackableItem {
             }
             onSetFullScreen: {
                 surfaceItem.isFullscreen = true
-                rootChrome.x = 0
-                rootChrome.y = 0
+                // move the window rather than this view, so that the views
+                // on the other outputs follow it and are dropped
+                if (rootChrome.primaryView) {
+                    surfaceItem.moveItem.x = surfaceItem.output.geometry.x
+                    surfaceItem.moveItem.y = surfaceItem.output.geometry.y
+                }
             }
         }
 
@@ -255,6 +288,18 @@ StackableItem {
         }
     }
 
+    // in the outline move mode, where the window will be when released
+    Rectangle {
+        visible: surfaceItem.moveItem.moving && surfaceItem.moveItem.mover.mode === MoveController.Outline
+        x: surfaceItem.moveItem.mover.position.x - surfaceItem.moveItem.x
+        y: surfaceItem.moveItem.mover.position.y - surfaceItem.moveItem.y
+        width: rootChrome.width
+        height: rootChrome.height
+        color: "transparent"
+        border.color: "white"
+        border.width: 2
+    }
+
     Rectangle {
         visible: surfaceItem.moveItem.moving
         border.color: "white"
@@ -267,7 +312,8 @@ StackableItem {
             id: moveGeometryText
             color: "white"
             anchors.centerIn: parent
-            text: Math.round(rootChrome.x) + "," + Math.round(rootChrome.y) + " on " + rootChrome.screenName
+            text: Math.round(surfaceItem.moveItem.mover.position.x - surfaceItem.output.geometry.x) + "," +
+                  Math.round(surfaceItem.moveItem.mover.position.y - surfaceItem.output.geometry.y) + " on " + rootChrome.screenName
         }
     }
 }
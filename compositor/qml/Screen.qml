@@ -20,6 +20,7 @@ import QtQuick 2.8
 import QtQuick.Window 2.3
 import QtWayland.Compositor 1.0
 import Grefsen 1.0
+import com.theqtcompany.wlcompositor 1.0
 
 WaylandOutput {
     id: output
@@ -27,6 +28,8 @@ WaylandOutput {
     property alias surfaceArea: compositorArea // Chrome instances are parented to compositorArea
     property alias targetScreen: win.screen
     sizeFollowsWindow: true
+    automaticFrameCallback: false // sent by culler, only to surfaces which are shown
+    Component.onCompleted: Tracer.instant("output created on " + win.screen.name)
 
     window: Window {
         id: win
@@ -37,10 +40,12 @@ WaylandOutput {
         WaylandMouseTracker {
             id: mouseTracker
             anchors.fill: parent
+            Component.onCompleted: HardwareCursor.addItem(mouseTracker)
 
             Item {
                 id: background
                 anchors.fill: parent
+                visible: !culler.backgroundOccluded
                 Loader {
                     id: desktopLoader
                     anchors.fill: parent
@@ -51,13 +56,32 @@ WaylandOutput {
                 id: compositorArea
                 anchors.fill: parent
             }
+            Shortcut {
+                sequence: "Alt+Tab"
+                onActivated: altTabSwitcher.step(1)
+            }
+            Shortcut {
+                sequence: "Alt+Shift+Backtab"
+                onActivated: altTabSwitcher.step(-1)
+            }
+            OcclusionCuller {
+                id: culler
+                stack: compositorArea
+                output: output
+                overlaysActive: glassPane.activeOverlays > 0
+            }
+            DamageTracker {
+                window: win
+            }
+            // only where the platform can't show the cursor itself; not even
+            // moved otherwise, since moving a hidden item still renders a frame
             WaylandCursorItem {
                 id: cursor
                 inputEventsEnabled: false
-                x: mouseTracker.mouseX
-                y: mouseTracker.mouseY
+                x: HardwareCursor.active ? 0 : mouseTracker.mouseX
+                y: HardwareCursor.active ? 0 : mouseTracker.mouseY
                 seat: output.compositor.defaultSeat
-                visible: mouseTracker.containsMouse
+                visible: mouseTracker.containsMouse && !HardwareCursor.active
             }
             /*
             Loader {
@@ -69,6 +93,21 @@ WaylandOutput {
                 id: glassPane
                 objectName: "glassPane"
                 anchors.fill: parent
+                // popovers and open panels; while there are any, nothing is culled
+                property int activeOverlays: 0
+
+                AltTabSwitcher {
+                    id: altTabSwitcher
+                    z: 1001
+                }
+                Loader {
+                    anchors.right: parent.right
+                    anchors.bottom: parent.bottom
+                    anchors.margins: 10
+                    z: 1000
+                    active: Instrumentation.overlayVisible
+                    source: "StatsOverlay.qml"
+                }
             }
         }
     }
@@ -0,0 +1,55 @@
+import QtQuick 2.6
+import com.theqtcompany.wlcompositor 1.0
+
+Rectangle {
+    color: "#c0000000"
+    radius: 5
+    width: statsColumn.implicitWidth + 20
+    height: statsColumn.implicitHeight + 20
+
+    function ms(value) { return value.toFixed(2) }
+
+    Column {
+        id: statsColumn
+        x: 10
+        y: 10
+        spacing: 4
+
+        Repeater {
+            model: Instrumentation.outputs
+            Text {
+                color: "white"
+                font.family: "monospace"
+                font.pixelSize: 12
+                text: modelData.name + ": " + modelData.frames + " frames, " + modelData.missedVsyncs + " missed vsyncs\n" +
+                      "  interval p50 " + ms(modelData.frameInterval.p50) + " p95 " + ms(modelData.frameInterval.p95) +
+                      " p99 " + ms(modelData.frameInterval.p99) + " ms\n" +
+                      "  render   p50 " + ms(modelData.renderTime.p50) + " p95 " + ms(modelData.renderTime.p95) +
+                      " p99 " + ms(modelData.renderTime.p99) + " ms\n" +
+                      "  vsync    " + ms(modelData.scheduler.vsyncInterval || 0) + " ms" +
+                      (modelData.scheduler.threaded ? "" : " (not threaded)") + ", " +
+                      (modelData.scheduler.frameCallbacks || 0) + " frame callbacks, " +
+                      (modelData.scheduler.deferredUpdates || 0) + " updates deferred\n" +
+                      "  input    p50 " + ms(modelData.inputLatency.p50) + " p95 " + ms(modelData.inputLatency.p95) + " ms"
+            }
+        }
+        Text {
+            color: "white"
+            font.family: "monospace"
+            font.pixelSize: 12
+            text: (Instrumentation.counters.chromes || 0) + " chromes, " + Instrumentation.surfaceCount + " surfaces, ~" +
+                  Math.round(Instrumentation.textureBytes / 1048576) + " MiB textures"
+        }
+        // the clients with the most texture memory
+        Repeater {
+            model: Instrumentation.clients.slice(0, 5)
+            Text {
+                color: "white"
+                font.family: "monospace"
+                font.pixelSize: 12
+                text: "  pid " + modelData.pid + ": " + modelData.surfaces + " surfaces, " +
+                      (modelData.textureBytes / 1048576).toFixed(1) + " MiB"
+            }
+        }
+    }
+}
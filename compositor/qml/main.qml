@@ -18,9 +18,30 @@
 import QtQml 2.2
 import QtQuick 2.6
 import QtWayland.Compositor 1.0
+import com.theqtcompany.wlcompositor 1.0
+import com.theqtcompany.wlprocesslauncher 1.0
 
 WaylandCompositor {
     id: comp
+    socketName: waylandSocketName // from the --wayland-socket-name option
+
+    // global geometry of each output, in the same order as screens
+    property var outputGeometries: []
+    // OutputTracker for each toplevel surface; popups and transients share their parent's
+    property variant trackersBySurface: ({})
+
+    // one for all the screens, which add their mouse trackers to it
+    Binding {
+        target: HardwareCursor
+        property: "seat"
+        value: comp.defaultSeat
+    }
+
+    onSurfaceCreated: {
+        Instrumentation.addSurface(surface)
+        FrameCallbackPolicy.addSurface(surface)
+        LaunchService.surfaceCreated(surface)
+    }
 
     Instantiator {
         id: screens
@@ -31,7 +52,10 @@ WaylandCompositor {
             targetScreen: modelData
             Component.onCompleted: if (!comp.defaultOutput) comp.defaultOutput = this
             position: Qt.point(virtualX, virtualY)
+            onGeometryChanged: comp.updateOutputGeometries()
         }
+        onObjectAdded: comp.updateOutputGeometries()
+        onObjectRemoved: comp.updateOutputGeometries()
     }
 
     Component {
@@ -43,7 +67,21 @@ WaylandCompositor {
     Component {
         id: moveItemComponent
         Item {
-            property bool moving: false
+            id: moveItem
+            property alias mover: mover
+            property bool moving: mover.moving
+            MoveController {
+                id: mover
+                target: moveItem
+            }
+        }
+    }
+
+    Component {
+        id: outputTrackerComponent
+        OutputTracker {
+            // decorationWidth and decorationHeight come from the primary Chrome
+            outputs: comp.outputGeometries
         }
     }
 
@@ -64,7 +102,19 @@ WaylandCompositor {
     TextInputManager {
     }
 
-    function createShellSurfaceItem(shellSurface, moveItem, output) {
+    function updateOutputGeometries() {
+        var ret = [];
+        for (var i = 0; i < screens.count; ++i) {
+            var output = screens.objectAt(i);
+            if (output)
+                ret.push(output.geometry);
+        }
+        outputGeometries = ret;
+    }
+
+    function createShellSurfaceItem(shellSurface, moveItem, output, tracker, index) {
+        if (output.viewsBySurface[shellSurface.surface])
+            return;
         var parentSurfaceItem = output.viewsBySurface[shellSurface.parentSurface];
         var parent = parentSurfaceItem || output.surfaceArea;
         var item = chromeComponent.createObject(parent, {
@@ -72,7 +122,9 @@ WaylandCompositor {
             "moveItem": moveItem,
             "output": output,
             "screenName": output.targetScreen.name,
-            "decorationVisible": true
+            "decorationVisible": true,
+            "outputTracker": trackersBySurface[shellSurface.surface] === tracker ? tracker : null,
+            "primaryView": Qt.binding(function() { return tracker.primaryOutput === index; })
         });
         if (parentSurfaceItem) {
             item.x += output.position.x;
@@ -81,6 +133,14 @@ WaylandCompositor {
         output.viewsBySurface[shellSurface.surface] = item;
     }
 
+    function destroyShellSurfaceItem(shellSurface, output) {
+        var item = output.viewsBySurface[shellSurface.surface];
+        if (!item)
+            return;
+        delete output.viewsBySurface[shellSurface.surface];
+        item.destroy();
+    }
+
     function handleShellSurfaceCreated(shellSurface) {
         var moveItem = moveItemComponent.createObject(defaultOutput.surfaceArea, {
             "x": screens.objectAt(0).position.x,
@@ -88,7 +148,47 @@ WaylandCompositor {
             "width": Qt.binding(function() { return shellSurface.surface.width; }),
             "height": Qt.binding(function() { return shellSurface.surface.height; })
         });
-        for (var i = 0; i < screens.count; ++i)
-            createShellSurfaceItem(shellSurface, moveItem, screens.objectAt(i));
+
+        // A popup or transient is shown wherever its parent is, since its own
+        // moveItem doesn't say where it is.  Otherwise there is a view on each
+        // output the window overlaps, and no more.
+        var tracker = trackersBySurface[shellSurface.parentSurface];
+        var ownTracker = !tracker;
+        if (ownTracker) {
+            tracker = outputTrackerComponent.createObject(moveItem, {
+                "target": moveItem,
+                "keepViews": Qt.binding(function() { return moveItem.moving; }),
+                "enabled": false
+            });
+            trackersBySurface[shellSurface.surface] = tracker;
+        }
+        var surface = shellSurface.surface;
+        var entered = function(index) {
+            createShellSurfaceItem(shellSurface, moveItem, screens.objectAt(index), tracker, index);
+        };
+        var left = function(index) {
+            destroyShellSurfaceItem(shellSurface, screens.objectAt(index));
+        };
+        tracker.outputEntered.connect(entered);
+        tracker.outputLeft.connect(left);
+        surface.surfaceDestroyed.connect(function() {
+            // the views run their destroy animations and go away by themselves
+            tracker.outputEntered.disconnect(entered);
+            tracker.outputLeft.disconnect(left);
+            for (var i = 0; i < screens.count; ++i)
+                delete screens.objectAt(i).viewsBySurface[surface];
+            if (ownTracker) {
+                tracker.enabled = false;
+                delete trackersBySurface[surface];
+            }
+        });
+
+        if (ownTracker) {
+            tracker.enabled = true;
+        } else {
+            for (var i = 0; i < screens.count; ++i)
+                if (tracker.intersects(i))
+                    entered(i);
+        }
     }
 }
@@ -0,0 +1,108 @@
+#include "resizecontroller.h"
+#include <QQuickWindow>
+
+static const int DefaultAckTimeout = 100; // ms
+
+ResizeController::ResizeController(QObject *parent)
+    : QObject(parent)
+{
+    m_ackTimer.setSingleShot(true);
+    m_ackTimer.setInterval(DefaultAckTimeout);
+    connect(&m_ackTimer, &QTimer::timeout, this, &ResizeController::onAckTimeout);
+}
+
+void ResizeController::setTarget(QQuickItem *target)
+{
+    if (m_target == target)
+        return;
+    if (m_target)
+        disconnect(m_target, 0, this, 0);
+    m_target = target;
+    if (target) {
+        connect(target, &QQuickItem::widthChanged, this, &ResizeController::onTargetResized);
+        connect(target, &QQuickItem::heightChanged, this, &ResizeController::onTargetResized);
+        connect(target, &QQuickItem::windowChanged, this, &ResizeController::onWindowChanged);
+    }
+    onWindowChanged(target ? target->window() : 0);
+    emit targetChanged();
+}
+
+void ResizeController::setAckTimeout(int ms)
+{
+    if (m_ackTimer.interval() == ms)
+        return;
+    m_ackTimer.setInterval(ms);
+    emit ackTimeoutChanged();
+}
+
+void ResizeController::requestSize(int width, int height)
+{
+    m_pending = QSize(width, height);
+    m_hasPending = true;
+    if (!m_awaitingAck)
+        scheduleFrame();
+}
+
+void ResizeController::scheduleFrame()
+{
+    if (m_awaitingFrame)
+        return;
+    m_awaitingFrame = true;
+    if (!m_window) {
+        // nothing to pace against: configure right away
+        onFrameSwapped();
+        return;
+    }
+    // frameSwapped comes from the render thread; handle it on ours.  Only
+    // connected while waiting for it, so idle windows cost no queued calls
+    m_frameConnection = connect(m_window.data(), &QQuickWindow::frameSwapped,
+                                this, &ResizeController::onFrameSwapped, Qt::QueuedConnection);
+    // mouse motion alone doesn't necessarily cause a frame
+    m_window->update();
+}
+
+void ResizeController::onFrameSwapped()
+{
+    // a call queued before the disconnection may still arrive
+    if (!m_awaitingFrame)
+        return;
+    m_awaitingFrame = false;
+    disconnect(m_frameConnection);
+    if (!m_hasPending || m_awaitingAck)
+        return;
+    m_hasPending = false;
+    if (m_pending == m_sent && m_target && m_target->size().toSize() == m_sent)
+        return;
+    m_sent = m_pending;
+    m_awaitingAck = true;
+    m_ackTimer.start();
+    emit configure(m_sent.width(), m_sent.height());
+}
+
+void ResizeController::onTargetResized()
+{
+    if (!m_awaitingAck)
+        return;
+    m_awaitingAck = false;
+    m_ackTimer.stop();
+    if (m_hasPending)
+        scheduleFrame();
+}
+
+void ResizeController::onAckTimeout()
+{
+    m_awaitingAck = false;
+    if (m_hasPending)
+        scheduleFrame();
+}
+
+void ResizeController::onWindowChanged(QQuickWindow *window)
+{
+    if (m_window == window)
+        return;
+    disconnect(m_frameConnection);
+    m_window = window;
+    m_awaitingFrame = false;
+    if (m_hasPending && !m_awaitingAck)
+        scheduleFrame();
+}
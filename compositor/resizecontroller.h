@@ -0,0 +1,62 @@
+#ifndef RESIZECONTROLLER_H
+#define RESIZECONTROLLER_H
+
+#include <QPointer>
+#include <QQuickItem>
+#include <QSize>
+#include <QTimer>
+
+/*!
+    Paces the configure events sent to a client during an interactive resize.
+
+    requestSize() may be called on every mouse motion event; configure() is
+    emitted at most once per frame of the target's window, and not again
+    until the client has committed a buffer of a new size (seen as a change
+    of the target item's size) or ackTimeout ms have passed, in case the
+    client won't or can't resize.  The last requested size is always sent
+    eventually.
+*/
+class ResizeController : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem *target READ target WRITE setTarget NOTIFY targetChanged)
+    Q_PROPERTY(int ackTimeout READ ackTimeout WRITE setAckTimeout NOTIFY ackTimeoutChanged)
+
+public:
+    explicit ResizeController(QObject *parent = 0);
+
+    QQuickItem *target() const { return m_target; }
+    void setTarget(QQuickItem *target);
+
+    int ackTimeout() const { return m_ackTimer.interval(); }
+    void setAckTimeout(int ms);
+
+    Q_INVOKABLE void requestSize(int width, int height);
+
+signals:
+    void targetChanged();
+    void ackTimeoutChanged();
+    void configure(int width, int height);
+
+protected slots:
+    void onFrameSwapped();
+    void onTargetResized();
+    void onAckTimeout();
+    void onWindowChanged(QQuickWindow *window);
+
+protected:
+    void scheduleFrame();
+
+protected:
+    QPointer<QQuickItem> m_target;
+    QPointer<QQuickWindow> m_window;
+    QMetaObject::Connection m_frameConnection;
+    QTimer m_ackTimer;
+    QSize m_pending;
+    QSize m_sent;
+    bool m_hasPending = false;
+    bool m_awaitingAck = false;
+    bool m_awaitingFrame = false;
+};
+
+#endif // RESIZECONTROLLER_H
@@ -0,0 +1,180 @@
+#include "sessionstore.h"
+#include "launchservice.h"
+#include "windowstack.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QQuickItem>
+#include <QSaveFile>
+#include <QWaylandClient>
+#include <QWaylandSurface>
+
+#include <signal.h>
+
+static const int SaveInterval = 2000;
+// stop waiting for the windows of relaunched applications after this long
+static const int RestoreTimeout = 60000;
+
+static qint64 clientPid(QObject *window)
+{
+    QWaylandSurface *surface = qobject_cast<QWaylandSurface *>(qvariant_cast<QObject *>(window->property("surface")));
+    return surface && surface->client() ? surface->client()->processId() : 0;
+}
+
+static QQuickItem *primaryView(QObject *window)
+{
+    const QVariantList views = WindowStack::instance()->views(window);
+    for (const QVariant &v : views) {
+        QQuickItem *view = qobject_cast<QQuickItem *>(v.value<QObject *>());
+        if (view && view->property("primaryView").toBool())
+            return view;
+    }
+    return views.isEmpty() ? 0 : qobject_cast<QQuickItem *>(views.first().value<QObject *>());
+}
+
+SessionStore *SessionStore::instance()
+{
+    static SessionStore *ret = new SessionStore;
+    return ret;
+}
+
+SessionStore::SessionStore()
+{
+    m_saveTimer.setInterval(SaveInterval);
+    connect(&m_saveTimer, &QTimer::timeout, this, &SessionStore::save);
+    connect(WindowStack::instance(), &WindowStack::windowAdded, this, &SessionStore::onWindowAdded);
+}
+
+void SessionStore::setFilePath(const QString &path)
+{
+    m_filePath = path;
+    if (path.isEmpty())
+        m_saveTimer.stop();
+    else
+        m_saveTimer.start();
+}
+
+QByteArray SessionStore::snapshot() const
+{
+    QVariantList apps;
+    QVariantList windows;
+    QSet<qint64> launched;
+    for (QObject *window : WindowStack::instance()->stackingOrder()) {
+        // popups and transients come back with their parents
+        if (qvariant_cast<QObject *>(window->property("parentSurface")))
+            continue;
+        const QVariantMap app = LaunchService::instance()->launchedApp(clientPid(window));
+        QQuickItem *view = primaryView(window);
+        QQuickItem *moveItem = view ? qobject_cast<QQuickItem *>(qvariant_cast<QObject *>(view->property("moveItem"))) : 0;
+        if (app.isEmpty() || !moveItem)
+            continue;
+        const qint64 pid = app.value(QStringLiteral("pid")).toLongLong();
+        if (!launched.contains(pid)) {
+            launched.insert(pid);
+            apps << app;
+        }
+        QVariantMap w;
+        w.insert(QStringLiteral("app"), pid);
+        w.insert(QStringLiteral("title"), window->property("title"));
+        w.insert(QStringLiteral("x"), moveItem->x());
+        w.insert(QStringLiteral("y"), moveItem->y());
+        w.insert(QStringLiteral("width"), view->width());
+        w.insert(QStringLiteral("height"), view->height());
+        windows << w;
+    }
+    QVariantMap ret;
+    ret.insert(QStringLiteral("apps"), apps);
+    ret.insert(QStringLiteral("windows"), windows);
+    return QJsonDocument::fromVariant(ret).toJson(QJsonDocument::Compact);
+}
+
+void SessionStore::save()
+{
+    const QByteArray data = snapshot();
+    if (data == m_saved)
+        return;
+    QSaveFile f(m_filePath);
+    if (!f.open(QIODevice::WriteOnly) || f.write(data) < 0 || !f.commit()) {
+        qWarning() << "failed to save the session to" << m_filePath << f.errorString();
+        return;
+    }
+    m_saved = data;
+}
+
+void SessionStore::restore()
+{
+    QFile f(m_filePath);
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+    const QVariantMap session = QJsonDocument::fromJson(f.readAll()).toVariant().toMap();
+    QHash<qint64, QList<QVariantMap>> windowsByApp;
+    int position = 0;
+    for (const QVariant &v : session.value(QStringLiteral("windows")).toList()) {
+        QVariantMap w = v.toMap();
+        w.insert(QStringLiteral("position"), position++);
+        windowsByApp[w.value(QStringLiteral("app")).toLongLong()] << w;
+    }
+    for (const QVariant &v : session.value(QStringLiteral("apps")).toList()) {
+        const QVariantMap app = v.toMap();
+        const qint64 oldPid = app.value(QStringLiteral("pid")).toLongLong();
+        const QStringList command = app.value(QStringLiteral("command")).toStringList();
+        if (command.isEmpty())
+            continue;
+        // it lost its connection with the old compositor; make sure this really is it before ending it
+        QFile cmdline(QStringLiteral("/proc/%1/cmdline").arg(oldPid));
+        if (oldPid > 0 && cmdline.open(QIODevice::ReadOnly) &&
+                QString::fromLocal8Bit(cmdline.readAll().split('\0').first()) == command.first())
+            kill(pid_t(oldPid), SIGTERM);
+        const int pid = LaunchService::instance()->launchCommand(command, app.value(QStringLiteral("name")).toString());
+        if (pid > 0)
+            m_pending.insert(pid, windowsByApp.value(oldPid));
+    }
+    qDebug() << "restoring" << m_pending.count() << "applications from" << m_filePath;
+    m_sinceRestore.start();
+}
+
+void SessionStore::onWindowAdded(QObject *window)
+{
+    if (m_pending.isEmpty())
+        return;
+    if (m_sinceRestore.elapsed() > RestoreTimeout) {
+        m_pending.clear();
+        m_restored.clear();
+        return;
+    }
+    // the view which announced the window is not in it yet
+    QPointer<QObject> guard(window);
+    QTimer::singleShot(0, this, [this, guard]() {
+        if (guard)
+            place(guard);
+    });
+}
+
+void SessionStore::place(QObject *window)
+{
+    if (qvariant_cast<QObject *>(window->property("parentSurface")))
+        return;
+    const QVariantMap app = LaunchService::instance()->launchedApp(clientPid(window));
+    auto it = m_pending.find(app.value(QStringLiteral("pid")).toLongLong());
+    QQuickItem *view = primaryView(window);
+    QQuickItem *moveItem = view ? qobject_cast<QQuickItem *>(qvariant_cast<QObject *>(view->property("moveItem"))) : 0;
+    if (it == m_pending.end() || it->isEmpty() || !moveItem)
+        return;
+    const QVariantMap w = it->takeFirst();
+    if (it->isEmpty())
+        m_pending.erase(it);
+    moveItem->setPosition(QPointF(w.value(QStringLiteral("x")).toReal(), w.value(QStringLiteral("y")).toReal()));
+    const QVariant width = w.value(QStringLiteral("width"));
+    const QVariant height = w.value(QStringLiteral("height"));
+    if (!qFuzzyCompare(width.toReal(), view->width()) || !qFuzzyCompare(height.toReal(), view->height()))
+        QMetaObject::invokeMethod(view, "requestSize", Q_ARG(QVariant, width), Q_ARG(QVariant, height));
+
+    // restack everything restored so far in the old order
+    m_restored.insert(w.value(QStringLiteral("position")).toInt(), window);
+    for (const QPointer<QObject> &restored : m_restored)
+        if (restored)
+            WindowStack::instance()->raise(restored);
+    if (m_pending.isEmpty())
+        m_restored.clear();
+}
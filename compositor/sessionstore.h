@@ -0,0 +1,59 @@
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QVariantMap>
+
+/*!
+    Keeps a snapshot of the session on disk, and restores it after a crash.
+
+    The snapshot lists the applications which were launched through the
+    LaunchService, and the geometry of their top-level windows in stacking
+    order.  It is written as JSON to a file in the runtime directory (see
+    Supervisor::sessionFilePath()), but only when it has changed since the
+    last check, every SaveInterval ms.
+
+    restore() launches the applications again (ending any leftovers of the
+    previous session first).  As their windows appear, they are moved and
+    resized to where the old ones were, and restacked in the old order.
+    Windows of applications which were not started by grefsen can't be
+    brought back.
+*/
+class SessionStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static SessionStore *instance();
+
+    QString filePath() const { return m_filePath; }
+    void setFilePath(const QString &path);
+
+    void restore();
+
+protected slots:
+    void save();
+    void onWindowAdded(QObject *window);
+
+protected:
+    SessionStore();
+
+    QByteArray snapshot() const;
+    void place(QObject *window);
+
+protected:
+    QString m_filePath;
+    QByteArray m_saved;
+    QTimer m_saveTimer;
+    QHash<qint64, QList<QVariantMap>> m_pending; // PID of relaunched app -> its windows, bottom first
+    QMap<int, QPointer<QObject>> m_restored; // by position in the old stacking order
+    QElapsedTimer m_sinceRestore;
+};
+
+#endif // SESSIONSTORE_H
@@ -0,0 +1,119 @@
+#include "shmsurfaceitem.h"
+#include "shmtexturecache.h"
+
+#include <QQuickWindow>
+#include <QSGSimpleTextureNode>
+#include <QWaylandQuickItem>
+#include <QWaylandSurface>
+
+ShmSurfaceItem::ShmSurfaceItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
+    ShmTextureCache *cache = ShmTextureCache::instance();
+    connect(cache, &ShmTextureCache::activeChanged, this, &ShmSurfaceItem::onActiveChanged);
+    connect(cache, &ShmTextureCache::frameReady, this, &ShmSurfaceItem::onFrameReady);
+}
+
+ShmSurfaceItem::~ShmSurfaceItem()
+{
+    if (!m_surface)
+        return;
+    if (m_window)
+        ShmTextureCache::instance()->unbind(m_window, m_surface);
+    ShmTextureCache::instance()->release(m_surface, m_itemView);
+}
+
+void ShmSurfaceItem::onParentSurfaceChanged()
+{
+    // QWaylandQuickItem emits surfaceChanged after giving the surface to its view
+    setSurface(m_surfaceItem && m_surfaceItem->view() ? m_surfaceItem->view()->surface() : 0);
+}
+
+void ShmSurfaceItem::setSurface(QWaylandSurface *surface)
+{
+    if (m_surface == surface)
+        return;
+    ShmTextureCache *cache = ShmTextureCache::instance();
+    if (m_surface) {
+        if (m_window)
+            cache->unbind(m_window, m_surface);
+        cache->release(m_surface, m_itemView);
+    }
+    m_surface = surface;
+    m_itemView = surface ? m_surfaceItem->view() : 0;
+    if (surface)
+        cache->acquire(surface, m_itemView);
+    emit surfaceChanged();
+    updateActive();
+}
+
+void ShmSurfaceItem::updateActive()
+{
+    const bool active = m_surface && ShmTextureCache::instance()->isActive(m_surface);
+    if (active != m_active) {
+        m_active = active;
+        emit activeChanged();
+    }
+    update();
+}
+
+void ShmSurfaceItem::onActiveChanged(QWaylandSurface *surface)
+{
+    if (surface == m_surface)
+        updateActive();
+}
+
+void ShmSurfaceItem::onFrameReady(QWaylandSurface *surface)
+{
+    if (surface != m_surface)
+        return;
+    ++m_frames;
+    emit framesChanged();
+    update();
+}
+
+void ShmSurfaceItem::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    if (change == ItemParentHasChanged) {
+        if (m_surfaceItem)
+            disconnect(m_surfaceItem, 0, this, 0);
+        m_surfaceItem = qobject_cast<QWaylandQuickItem *>(value.item);
+        if (m_surfaceItem)
+            connect(m_surfaceItem, &QWaylandQuickItem::surfaceChanged, this, &ShmSurfaceItem::onParentSurfaceChanged);
+        onParentSurfaceChanged();
+    }
+    if (change == ItemSceneChange) {
+        if (m_window && m_surface)
+            ShmTextureCache::instance()->unbind(m_window, m_surface);
+        m_window = value.window;
+        ShmTextureCache::instance()->addWindow(value.window);
+    }
+    QQuickItem::itemChange(change, value);
+}
+
+QSGNode *ShmSurfaceItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    ShmTextureCache::Frame frame;
+    if (m_surface)
+        frame = ShmTextureCache::instance()->frame(window(), m_surface);
+    if (!frame.texture) {
+        delete oldNode;
+        return 0;
+    }
+    QSGSimpleTextureNode *node = static_cast<QSGSimpleTextureNode *>(oldNode);
+    if (!node) {
+        node = new QSGSimpleTextureNode;
+        node->setOwnsTexture(true);
+        node->setFiltering(QSGTexture::Linear);
+    }
+    // the cache owns the GL texture, the node only the wrapper, which setTexture() deletes;
+    // a new wrapper whenever the front texture is another one
+    QSGTexture *texture = node->texture();
+    if (!texture || GLuint(texture->textureId()) != frame.texture || texture->textureSize() != frame.size) {
+        node->setTexture(window()->createTextureFromId(frame.texture, frame.size,
+                frame.hasAlpha ? QQuickWindow::TextureHasAlphaChannel : QQuickWindow::CreateTextureOptions()));
+    }
+    node->setRect(boundingRect());
+    return node;
+}
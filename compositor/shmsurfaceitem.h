@@ -0,0 +1,66 @@
+#ifndef SHMSURFACEITEM_H
+#define SHMSURFACEITEM_H
+
+#include <QPointer>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QWaylandView>
+
+class QWaylandQuickItem;
+class QWaylandSurface;
+
+/*!
+    Shows a surface from the textures which ShmTextureCache uploads.
+
+    It is meant to be a child of the surface's ShellSurfaceItem, filling it,
+    which has paintEnabled: !active so that QtWayland neither uploads nor
+    draws the same buffers.  surface is the parent's, and is only taken
+    once the parent's view has it, so that the cache's view of the surface
+    comes after it.  While the cache is unavailable or the
+    surface's buffer is not in shared memory, active is false and the
+    ShellSurfaceItem paints it as usual.  frames counts the textures shown,
+    so that DamageTracker sees that the content changed.
+*/
+class ShmSurfaceItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QWaylandSurface *surface READ surface NOTIFY surfaceChanged)
+    Q_PROPERTY(bool active READ isActive NOTIFY activeChanged)
+    Q_PROPERTY(int frames READ frames NOTIFY framesChanged)
+
+public:
+    explicit ShmSurfaceItem(QQuickItem *parent = 0);
+    ~ShmSurfaceItem();
+
+    QWaylandSurface *surface() const { return m_surface; }
+
+    bool isActive() const { return m_active; }
+    int frames() const { return m_frames; }
+
+signals:
+    void surfaceChanged();
+    void activeChanged();
+    void framesChanged();
+
+protected slots:
+    void onParentSurfaceChanged();
+    void onActiveChanged(QWaylandSurface *surface);
+    void onFrameReady(QWaylandSurface *surface);
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) Q_DECL_OVERRIDE;
+    void itemChange(ItemChange change, const ItemChangeData &value) Q_DECL_OVERRIDE;
+
+    void setSurface(QWaylandSurface *surface);
+    void updateActive();
+
+protected:
+    QPointer<QWaylandQuickItem> m_surfaceItem;
+    QPointer<QWaylandView> m_itemView; // the one the surface was acquired with
+    QPointer<QWaylandSurface> m_surface;
+    QPointer<QQuickWindow> m_window;
+    int m_frames = 0;
+    bool m_active = false;
+};
+
+#endif // SHMSURFACEITEM_H
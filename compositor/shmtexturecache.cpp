@@ -0,0 +1,632 @@
+#include "shmtexturecache.h"
+#include "instrumentation.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QQuickWindow>
+#include <QThread>
+#include <QWaylandSurface>
+
+#include <string.h>
+#include <wayland-server.h>
+
+// the ES 3 and GL 3 names, which the headers of an ES 2 build of Qt don't have
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_RGBA8
+#define GL_RGBA8 0x8058
+#endif
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_IGNORED
+#define GL_TIMEOUT_IGNORED 0xFFFFFFFFFFFFFFFFull
+#endif
+
+// the front texture, one being written, and one which a slow output still shows
+static const int MaxTextures = 3;
+// beyond this many rectangles, the bounding rectangle is uploaded instead
+static const int MaxUploadRects = 16;
+// how long to wait for an upload to finish before showing it anyway
+static const quint64 UploadTimeoutNs = 1000000000;
+
+static bool enabled = true;
+
+class UploadThread : public QThread
+{
+public:
+    explicit UploadThread(ShmTextureCache *cache) : m_cache(cache) { setObjectName(QStringLiteral("shm upload")); }
+
+protected:
+    void run() Q_DECL_OVERRIDE { m_cache->run(); }
+
+    ShmTextureCache *m_cache;
+};
+
+ShmTextureCache *ShmTextureCache::instance()
+{
+    static ShmTextureCache *ret = new ShmTextureCache;
+    return ret;
+}
+
+ShmTextureCache::ShmTextureCache()
+{
+    qRegisterMetaType<quint64>("quint64");
+    connect(this, &ShmTextureCache::uploaded, this, &ShmTextureCache::onUploaded, Qt::QueuedConnection);
+    connect(this, &ShmTextureCache::texturesDestroyed, this, &ShmTextureCache::onTexturesDestroyed, Qt::QueuedConnection);
+}
+
+ShmTextureCache::~ShmTextureCache()
+{
+}
+
+void ShmTextureCache::setEnabled(bool e)
+{
+    enabled = e;
+}
+
+bool ShmTextureCache::isAvailable()
+{
+    if (m_started)
+        return m_available;
+    m_started = true;
+    if (!enabled)
+        return false;
+    QOpenGLContext *share = QOpenGLContext::globalShareContext();
+    if (!share) {
+        qWarning("uploading shm buffers on the render threads: no context to share textures with");
+        return false;
+    }
+    m_offscreen = new QOffscreenSurface;
+    m_offscreen->setFormat(share->format());
+    m_offscreen->create();
+    m_context = new QOpenGLContext;
+    m_context->setFormat(share->format());
+    m_context->setShareContext(share);
+    bool usable = m_context->create() && m_context->makeCurrent(m_offscreen);
+    if (usable) {
+        // sync objects, glMapBufferRange and pixel buffer objects
+        const QPair<int, int> version = m_context->format().version();
+        if (m_context->isOpenGLES())
+            usable = version >= qMakePair(3, 0);
+        else
+            usable = version >= qMakePair(3, 2) || (m_context->hasExtension("GL_ARB_sync") &&
+                                                    m_context->hasExtension("GL_ARB_map_buffer_range"));
+        m_bgra = !m_context->isOpenGLES();
+        m_context->doneCurrent();
+    }
+    if (!usable) {
+        qWarning("uploading shm buffers on the render threads: the upload thread needs OpenGL ES 3.0 or OpenGL 3.2");
+        delete m_context;
+        m_context = 0;
+        delete m_offscreen;
+        m_offscreen = 0;
+        return false;
+    }
+    m_thread = new UploadThread(this);
+    m_context->moveToThread(m_thread);
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_quit = true;
+            m_wake.wakeAll();
+        }
+        m_thread->wait();
+    });
+    m_thread->start();
+    m_available = true;
+    return true;
+}
+
+void ShmTextureCache::acquire(QWaylandSurface *surface, QWaylandView *itemView)
+{
+    if (!surface || !itemView || !isAvailable())
+        return;
+    Entry *entry = m_entries.value(surface);
+    if (!entry) {
+        entry = new Entry;
+        entry->id = m_nextId++;
+        entry->textures = new Textures;
+        entry->view.setSurface(surface);
+        {
+            QMutexLocker lock(&m_mutex);
+            m_entries.insert(surface, entry);
+        }
+        connect(surface, &QWaylandSurface::damaged, this, [this, surface](const QRegion &region) {
+            Entry *entry = m_entries.value(surface);
+            if (!entry)
+                return;
+            const int scale = surface->bufferScale();
+            if (scale == 1) {
+                entry->damage += region;
+            } else {
+                for (const QRect &r : region.rects())
+                    entry->damage += QRect(r.topLeft() * scale, r.size() * scale);
+            }
+        });
+        connect(surface, &QWaylandSurface::redraw, this, [this, surface]() { onRedraw(surface); });
+        connect(surface, &QObject::destroyed, this, [this, surface]() { removeEntry(surface); });
+        // the buffer which was committed before
+        onRedraw(surface);
+    }
+    ++entry->refs;
+    entry->itemViews << itemView;
+    keepItemViewPrimary(entry);
+}
+
+void ShmTextureCache::release(QWaylandSurface *surface, QWaylandView *itemView)
+{
+    Entry *entry = m_entries.value(surface);
+    if (!entry)
+        return;
+    // itemView may have been deleted already, with its QWaylandQuickItem
+    entry->itemViews.removeAll(QPointer<QWaylandView>());
+    for (int i = entry->itemViews.count() - 1; i >= 0; --i) {
+        if (entry->itemViews.at(i).data() == itemView)
+            entry->itemViews.removeAt(i);
+    }
+    if (--entry->refs <= 0)
+        removeEntry(surface);
+    else
+        keepItemViewPrimary(entry);
+}
+
+void ShmTextureCache::keepItemViewPrimary(Entry *entry)
+{
+    // QtWayland makes the first view primary; the cache's view is added after the item's, but
+    // becomes the first when the items which were there before it are deleted
+    if (!entry->view.isPrimary())
+        return;
+    for (const QPointer<QWaylandView> &view : entry->itemViews) {
+        if (view && view->surface() == entry->view.surface()) {
+            view->setPrimary();
+            return;
+        }
+    }
+}
+
+bool ShmTextureCache::isActive(QWaylandSurface *surface) const
+{
+    Entry *entry = m_entries.value(surface);
+    return entry && entry->active;
+}
+
+void ShmTextureCache::addWindow(QQuickWindow *window)
+{
+    if (!window || m_windows.contains(window))
+        return;
+    m_windows.insert(window);
+    // the GL commands of the frame are only complete after it
+    connect(window, &QQuickWindow::afterRendering, this, [this, window]() { onAfterRendering(window); }, Qt::DirectConnection);
+    connect(window, &QObject::destroyed, this, [this, window]() {
+        m_windows.remove(window);
+        QMutexLocker lock(&m_mutex);
+        m_released.remove(window);
+    });
+}
+
+ShmTextureCache::Texture *ShmTextureCache::bind(Textures *textures, QQuickWindow *window, Texture *texture)
+{
+    Texture *bound = textures->bound.value(window);
+    if (bound == texture)
+        return texture;
+    if (bound) {
+        bound->users.remove(window);
+        ++bound->pendingFences;
+        m_released[window] << bound;
+    }
+    if (texture) {
+        texture->users.insert(window);
+        textures->bound.insert(window, texture);
+    } else {
+        textures->bound.remove(window);
+    }
+    return texture;
+}
+
+void ShmTextureCache::unbind(QQuickWindow *window, QWaylandSurface *surface)
+{
+    QMutexLocker lock(&m_mutex);
+    if (Entry *entry = m_entries.value(surface))
+        bind(entry->textures, window, 0);
+}
+
+ShmTextureCache::Frame ShmTextureCache::frame(QQuickWindow *window, QWaylandSurface *surface)
+{
+    Frame ret;
+    QMutexLocker lock(&m_mutex);
+    Entry *entry = m_entries.value(surface);
+    if (!entry)
+        return ret;
+    Textures *textures = entry->textures;
+    if (Texture *texture = bind(textures, window, entry->active ? textures->front : 0)) {
+        ret.texture = texture->id;
+        ret.size = texture->size;
+        ret.hasAlpha = textures->hasAlpha;
+    }
+    return ret;
+}
+
+void ShmTextureCache::onAfterRendering(QQuickWindow *window)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_released.find(window);
+    if (it == m_released.end() || it->isEmpty())
+        return;
+    QOpenGLExtraFunctions *gl = QOpenGLContext::currentContext()->extraFunctions();
+    for (Texture *texture : *it) {
+        texture->fences << gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        --texture->pendingFences;
+    }
+    // the upload context can only wait for fences which have been flushed
+    gl->glFlush();
+    it->clear();
+    m_texturesReleased = true;
+    m_wake.wakeAll();
+}
+
+void ShmTextureCache::setActive(QWaylandSurface *surface, Entry *entry, bool active)
+{
+    if (entry->active == active)
+        return;
+    entry->active = active;
+    emit activeChanged(surface);
+}
+
+void ShmTextureCache::releaseBuffers(Entry *entry)
+{
+    if (entry->uploadingPool)
+        wl_shm_pool_unref(entry->uploadingPool);
+    entry->uploadingPool = 0;
+    entry->uploading = QWaylandBufferRef();
+    if (entry->pendingPool)
+        wl_shm_pool_unref(entry->pendingPool);
+    entry->pendingPool = 0;
+    entry->pending = QWaylandBufferRef();
+    entry->pendingImage = QImage();
+}
+
+void ShmTextureCache::onRedraw(QWaylandSurface *surface)
+{
+    Entry *entry = m_entries.value(surface);
+    if (!entry)
+        return;
+    entry->view.advance();
+    const QWaylandBufferRef buffer = entry->view.currentBuffer();
+    QImage image;
+    wl_shm_buffer *shmBuffer = 0;
+    if (buffer.hasBuffer() && buffer.isSharedMemory()) {
+        shmBuffer = wl_shm_buffer_get(buffer.wl_buffer());
+        image = buffer.image();
+    }
+    const QImage::Format format = image.format();
+    entry->shm = shmBuffer && (format == QImage::Format_ARGB32_Premultiplied || format == QImage::Format_RGB32);
+    if (!entry->shm) {
+        // EGL, dmabuf or unusual formats are QtWayland's; and when unmapped, there is nothing to show
+        entry->damage = QRegion();
+        if (entry->pending.hasBuffer()) {
+            wl_shm_pool_unref(entry->pendingPool);
+            entry->pendingPool = 0;
+            entry->pending = QWaylandBufferRef();
+            entry->pendingImage = QImage();
+        }
+        setActive(surface, entry, false);
+        return;
+    }
+
+    // the textures don't have what was committed while QWaylandQuickItem showed the surface
+    const QRegion damage = entry->active ? entry->damage : QRegion(image.rect());
+    entry->damage = QRegion();
+    {
+        QMutexLocker lock(&m_mutex);
+        for (Texture *texture : entry->textures->textures)
+            texture->stale += damage;
+    }
+    wl_shm_pool *pool = wl_shm_buffer_ref_pool(shmBuffer);
+    if (entry->uploading.hasBuffer()) {
+        // a newer buffer replaces one which is still waiting
+        if (entry->pendingPool)
+            wl_shm_pool_unref(entry->pendingPool);
+        entry->pending = buffer;
+        entry->pendingPool = pool;
+        entry->pendingImage = image;
+        return;
+    }
+    startUpload(entry, buffer, pool, image);
+}
+
+void ShmTextureCache::startUpload(Entry *entry, const QWaylandBufferRef &buffer, wl_shm_pool *pool, const QImage &image)
+{
+    entry->uploading = buffer;
+    entry->uploadingPool = pool;
+    Job job;
+    job.id = entry->id;
+    job.textures = entry->textures;
+    job.image = image;
+    QMutexLocker lock(&m_mutex);
+    m_jobs.enqueue(job);
+    m_wake.wakeAll();
+}
+
+void ShmTextureCache::onUploaded(quint64 id, qint64 textureBytes)
+{
+    QWaylandSurface *surface = 0;
+    Entry *entry = 0;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        if (it.value()->id == id) {
+            surface = it.key();
+            entry = it.value();
+            break;
+        }
+    }
+    // removed meanwhile; its buffers are released with the textures
+    if (!entry)
+        return;
+    if (entry->uploadingPool)
+        wl_shm_pool_unref(entry->uploadingPool);
+    entry->uploadingPool = 0;
+    entry->uploading = QWaylandBufferRef();
+    Instrumentation::instance()->setTextureBytes(surface, textureBytes);
+    // unless a buffer which isn't in shared memory came meanwhile
+    setActive(surface, entry, entry->shm);
+    emit frameReady(surface);
+    if (entry->pending.hasBuffer()) {
+        const QWaylandBufferRef buffer = entry->pending;
+        wl_shm_pool *pool = entry->pendingPool;
+        const QImage image = entry->pendingImage;
+        entry->pending = QWaylandBufferRef();
+        entry->pendingPool = 0;
+        entry->pendingImage = QImage();
+        startUpload(entry, buffer, pool, image);
+    }
+}
+
+void ShmTextureCache::removeEntry(QWaylandSurface *surface)
+{
+    Entry *entry = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        entry = m_entries.take(surface);
+    }
+    if (!entry)
+        return;
+    disconnect(surface, 0, this, 0);
+    entry->view.setSurface(0);
+    Instrumentation::instance()->setTextureBytes(surface, -1);
+    if (entry->active)
+        emit activeChanged(surface);
+    // an upload may still be reading its buffer
+    m_removed.insert(entry->id, entry);
+    Job job;
+    job.id = entry->id;
+    job.textures = entry->textures;
+    job.destroy = true;
+    QMutexLocker lock(&m_mutex);
+    m_jobs.enqueue(job);
+    m_wake.wakeAll();
+}
+
+void ShmTextureCache::onTexturesDestroyed(quint64 id)
+{
+    Entry *entry = m_removed.take(id);
+    if (!entry)
+        return;
+    releaseBuffers(entry);
+    delete entry;
+}
+
+void ShmTextureCache::run()
+{
+    m_context->makeCurrent(m_offscreen);
+    QOpenGLExtraFunctions *gl = m_context->extraFunctions();
+    gl->glGenBuffers(1, &m_pbo);
+    QVector<Job> stalled;
+    QMutexLocker lock(&m_mutex);
+    for (;;) {
+        while (!m_quit && m_jobs.isEmpty() && !(m_texturesReleased && !stalled.isEmpty()))
+            m_wake.wait(&m_mutex);
+        if (m_quit)
+            break;
+        m_texturesReleased = false;
+        // the stalled uploads first; there is only one upload at a time for each surface
+        QVector<Job> jobs = stalled;
+        stalled.clear();
+        while (!m_jobs.isEmpty())
+            jobs << m_jobs.dequeue();
+        lock.unlock();
+        for (const Job &job : jobs) {
+            if (job.destroy) {
+                for (int i = stalled.count() - 1; i >= 0; --i) {
+                    if (stalled.at(i).id == job.id)
+                        stalled.remove(i);
+                }
+                destroy(job.textures);
+                emit texturesDestroyed(job.id);
+            } else if (!upload(job)) {
+                // every texture is still shown somewhere; try again after the next frame
+                stalled << job;
+            }
+        }
+        lock.relock();
+    }
+    lock.unlock();
+    gl->glDeleteBuffers(1, &m_pbo);
+    m_context->doneCurrent();
+}
+
+bool ShmTextureCache::upload(const Job &job)
+{
+    QOpenGLExtraFunctions *gl = m_context->extraFunctions();
+    const QSize size = job.image.size();
+    Texture *target = 0;
+    QRegion region;
+    QVector<GLsync> fences;
+    {
+        QMutexLocker lock(&m_mutex);
+        Textures *textures = job.textures;
+        for (Texture *texture : textures->textures) {
+            if (texture == textures->front || !texture->users.isEmpty() || texture->pendingFences > 0)
+                continue;
+            // one of the same size needs only the damage
+            if (!target || (texture->size == size && target->size != size))
+                target = texture;
+        }
+        if (!target) {
+            if (textures->textures.count() >= MaxTextures)
+                return false;
+            target = new Texture;
+            textures->textures << target;
+        }
+        // what is damaged from now on goes into the next upload
+        region = target->stale;
+        target->stale = QRegion();
+        fences = target->fences;
+        target->fences.clear();
+    }
+    // the GPU finishes the frames which showed it first; this thread doesn't wait
+    for (GLsync fence : fences) {
+        gl->glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        gl->glDeleteSync(fence);
+    }
+
+    const GLenum format = m_bgra ? GL_BGRA : GL_RGBA;
+    if (!target->id) {
+        gl->glGenTextures(1, &target->id);
+        gl->glBindTexture(GL_TEXTURE_2D, target->id);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    } else {
+        gl->glBindTexture(GL_TEXTURE_2D, target->id);
+    }
+    if (target->size != size) {
+        gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.width(), size.height(), 0, format, GL_UNSIGNED_BYTE, 0);
+        target->size = size;
+        region = QRect(QPoint(), size);
+    }
+    region &= QRect(QPoint(), size);
+    if (region.rectCount() > MaxUploadRects)
+        region = region.boundingRect();
+    uploadRegion(job.image, region);
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+
+    // the windows get it complete, or not at all
+    GLsync done = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl->glClientWaitSync(done, GL_SYNC_FLUSH_COMMANDS_BIT, UploadTimeoutNs);
+    gl->glDeleteSync(done);
+
+    qint64 bytes = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        job.textures->front = target;
+        job.textures->hasAlpha = job.image.hasAlphaChannel();
+        for (const Texture *texture : job.textures->textures)
+            bytes += qint64(texture->size.width()) * texture->size.height() * 4;
+    }
+    emit uploaded(job.id, bytes);
+    return true;
+}
+
+void ShmTextureCache::uploadRegion(const QImage &image, const QRegion &region)
+{
+    QOpenGLExtraFunctions *gl = m_context->extraFunctions();
+    const QVector<QRect> rects = region.rects();
+    qint64 total = 0;
+    for (const QRect &r : rects)
+        total += qint64(r.width()) * r.height() * 4;
+    if (!total)
+        return;
+
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+    // orphaning: the GPU may still be reading the storage of the last upload
+    gl->glBufferData(GL_PIXEL_UNPACK_BUFFER, total, 0, GL_STREAM_DRAW);
+    uchar *dst = static_cast<uchar *>(gl->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total,
+                                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!dst) {
+        qWarning("glMapBufferRange failed: 0x%x", gl->glGetError());
+        gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+    const bool opaque = !image.hasAlphaChannel();
+    for (const QRect &r : rects) {
+        for (int y = r.top(); y <= r.bottom(); ++y) {
+            const quint32 *src = reinterpret_cast<const quint32 *>(image.constScanLine(y)) + r.x();
+            quint32 *row = reinterpret_cast<quint32 *>(dst);
+            if (m_bgra && !opaque) {
+                memcpy(row, src, r.width() * 4);
+            } else {
+                for (int x = 0; x < r.width(); ++x) {
+                    // the alpha of RGB32 is undefined
+                    quint32 p = opaque ? (src[x] | 0xff000000) : src[x];
+                    // 0xAARRGGBB to bytes R, G, B, A
+                    if (!m_bgra) {
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+                        p = (p << 8) | (p >> 24);
+#else
+                        p = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+#endif
+                    }
+                    row[x] = p;
+                }
+            }
+            dst += r.width() * 4;
+        }
+    }
+    gl->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // each rectangle is packed in the buffer, so the default row length is right
+    const GLenum format = m_bgra ? GL_BGRA : GL_RGBA;
+    gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    qint64 offset = 0;
+    for (const QRect &r : rects) {
+        gl->glTexSubImage2D(GL_TEXTURE_2D, 0, r.x(), r.y(), r.width(), r.height(), format, GL_UNSIGNED_BYTE,
+                            reinterpret_cast<const void *>(offset));
+        offset += qint64(r.width()) * r.height() * 4;
+    }
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void ShmTextureCache::destroy(Textures *textures)
+{
+    QVector<GLuint> ids;
+    QVector<GLsync> fences;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (auto it = m_released.begin(); it != m_released.end(); ++it) {
+            for (Texture *texture : textures->textures)
+                it->removeAll(texture);
+        }
+        for (Texture *texture : textures->textures) {
+            if (texture->id)
+                ids << texture->id;
+            fences += texture->fences;
+            delete texture;
+        }
+        delete textures;
+    }
+    QOpenGLExtraFunctions *gl = m_context->extraFunctions();
+    for (GLsync fence : fences)
+        gl->glDeleteSync(fence);
+    if (!ids.isEmpty())
+        gl->glDeleteTextures(ids.count(), ids.constData());
+}
@@ -0,0 +1,180 @@
+#ifndef SHMTEXTURECACHE_H
+#define SHMTEXTURECACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QRegion>
+#include <QSet>
+#include <QSize>
+#include <QVector>
+#include <QWaitCondition>
+#include <QWaylandBufferRef>
+#include <QWaylandView>
+#include <qopengl.h>
+
+struct wl_shm_pool;
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QQuickWindow;
+class QThread;
+class QWaylandSurface;
+
+/*!
+    Uploads the shared memory buffers of client surfaces to textures on a
+    thread of its own, one texture for all the outputs.
+
+    Without it, QWaylandQuickItem uploads each new buffer on the render
+    thread of every output the surface is shown on, inside the frame, and
+    all of it however little the client has damaged.  Here the buffer is
+    copied into a pixel buffer object and from there into a texture in an
+    OpenGL context of the upload thread, which shares its textures with
+    those of the windows (Qt::AA_ShareOpenGLContexts); only the damaged
+    rectangles, which each texture accumulates since it was last written.
+    A surface has up to MaxTextures textures: the front one, which the
+    windows are given by frame(), and older ones which are written once no
+    window shows them any longer and the fences after their last frames have
+    passed.  The front texture is replaced only after its upload has finished.
+
+    The buffers are read through a QWaylandView of the cache's own, because
+    the views of the surface items only advance during their windows'
+    synchronization.  That view is only created once a surface item's view
+    has the surface, and whenever it would become the surface's primary view
+    (the one QtWayland sends frame callbacks and output events through), one
+    of the item views passed to acquire() is made primary instead.
+
+    ShmSurfaceItem shows the textures; a surface is active while its
+    buffers are uploaded this way.  Buffers which are not in shared memory,
+    such as EGL and dmabuf ones, or in formats other than 32-bit RGB, are
+    left to QtWayland, which imports those without copying.  The cache is
+    unavailable without OpenGL (ES) 3 sync objects and pixel buffer objects,
+    or if setEnabled(false) was called (--sync-shm-upload).  The memory of
+    the textures is reported to Instrumentation.
+*/
+class ShmTextureCache : public QObject
+{
+    Q_OBJECT
+    friend class UploadThread;
+
+public:
+    struct Frame {
+        GLuint texture = 0;
+        QSize size;
+        bool hasAlpha = false;
+    };
+
+    static ShmTextureCache *instance();
+    static void setEnabled(bool enabled);
+
+    bool isAvailable();
+
+    // on the GUI thread; itemView is the view of the QWaylandQuickItem which shows surface
+    void acquire(QWaylandSurface *surface, QWaylandView *itemView);
+    void release(QWaylandSurface *surface, QWaylandView *itemView);
+    bool isActive(QWaylandSurface *surface) const;
+    void addWindow(QQuickWindow *window);
+    void unbind(QQuickWindow *window, QWaylandSurface *surface);
+
+    // on the render thread of window, while the GUI thread is blocked; binds the front texture to it
+    Frame frame(QQuickWindow *window, QWaylandSurface *surface);
+
+signals:
+    void activeChanged(QWaylandSurface *surface);
+    void frameReady(QWaylandSurface *surface);
+    // from the upload thread
+    void uploaded(quint64 id, qint64 textureBytes);
+    void texturesDestroyed(quint64 id);
+
+protected slots:
+    void onUploaded(quint64 id, qint64 textureBytes);
+    void onTexturesDestroyed(quint64 id);
+
+protected:
+    ShmTextureCache();
+    ~ShmTextureCache();
+
+    struct Texture {
+        GLuint id = 0;
+        QSize size;
+        QRegion stale; // damaged since it was written
+        QSet<QQuickWindow *> users; // windows whose scene graph shows it
+        QVector<GLsync> fences; // after the last frames which showed it
+        int pendingFences = 0; // windows which stopped showing it, but haven't fenced it yet
+    };
+
+    // guarded by m_mutex; the GL objects belong to the upload thread, except for the fences
+    struct Textures {
+        QVector<Texture *> textures;
+        Texture *front = 0;
+        bool hasAlpha = false;
+        QHash<QQuickWindow *, Texture *> bound;
+    };
+
+    // GUI thread only
+    struct Entry {
+        // identifies it in the signals of the upload thread; unlike the address of textures, never reused
+        quint64 id = 0;
+        QWaylandView view; // of the surface, to get at its buffers; never the primary one
+        QList<QPointer<QWaylandView> > itemViews;
+        Textures *textures = 0;
+        QRegion damage; // since the last commit, in buffer pixels
+        // the pools stay mapped while the upload thread reads them, even if the client destroys them
+        QWaylandBufferRef uploading;
+        wl_shm_pool *uploadingPool = 0;
+        QWaylandBufferRef pending;
+        wl_shm_pool *pendingPool = 0;
+        QImage pendingImage;
+        int refs = 0;
+        bool shm = false; // the current buffer can be uploaded
+        bool active = false;
+    };
+
+    struct Job {
+        quint64 id = 0; // of the entry
+        Textures *textures = 0;
+        QImage image;
+        bool destroy = false;
+    };
+
+    void onRedraw(QWaylandSurface *surface);
+    void removeEntry(QWaylandSurface *surface);
+    static void keepItemViewPrimary(Entry *entry);
+    void setActive(QWaylandSurface *surface, Entry *entry, bool active);
+    void startUpload(Entry *entry, const QWaylandBufferRef &buffer, wl_shm_pool *pool, const QImage &image);
+    static void releaseBuffers(Entry *entry);
+    Texture *bind(Textures *textures, QQuickWindow *window, Texture *texture);
+    void onAfterRendering(QQuickWindow *window);
+
+    // on the upload thread
+    void run();
+    bool upload(const Job &job);
+    void uploadRegion(const QImage &image, const QRegion &region);
+    void destroy(Textures *textures);
+
+protected:
+    QHash<QWaylandSurface *, Entry *> m_entries;
+    QHash<quint64, Entry *> m_removed; // until the upload thread has deleted their textures
+    quint64 m_nextId = 1;
+    QSet<QQuickWindow *> m_windows;
+    bool m_started = false;
+    bool m_available = false;
+    bool m_bgra = false; // whether the context takes GL_BGRA, or the pixels have to be swizzled
+
+    QOpenGLContext *m_context = 0;
+    QOffscreenSurface *m_offscreen = 0;
+    QThread *m_thread = 0;
+    GLuint m_pbo = 0;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QQueue<Job> m_jobs;
+    QHash<QQuickWindow *, QVector<Texture *> > m_released; // to be fenced after the window's next frame
+    bool m_texturesReleased = false;
+    bool m_quit = false;
+};
+
+#endif // SHMTEXTURECACHE_H
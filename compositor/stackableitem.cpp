@@ -1,25 +1,175 @@
 #include "stackableitem.h"
 
+#include <QWaylandBufferRef>
+#include <QWaylandQuickItem>
+#include <QWaylandSurface>
+#include <QWaylandView>
+#include <QtMath>
+
+// rounded inwards, so that no partly covered pixel is counted as opaque
+static QRect innerRect(const QRectF &r)
+{
+    if (r.isEmpty())
+        return QRect();
+    return QRect(QPoint(qCeil(r.left()), qCeil(r.top())), QPoint(qFloor(r.right()) - 1, qFloor(r.bottom()) - 1));
+}
+
 StackableItem::StackableItem()
 {
 
 }
 
+StackableItem::~StackableItem()
+{
+    if (m_stackKey)
+        WindowStack::instance()->removeView(m_stackKey, this);
+}
+
+void StackableItem::setStackKey(QObject *key)
+{
+    if (m_stackKey == key)
+        return;
+    if (m_stackKey)
+        WindowStack::instance()->removeView(m_stackKey, this);
+    m_stackKey = key;
+    if (key) {
+        WindowStack::instance()->setLayer(key, m_stackLayer);
+        WindowStack::instance()->addView(key, this);
+    }
+    emit stackKeyChanged();
+}
+
+void StackableItem::setStackLayer(WindowStack::Layer layer)
+{
+    if (m_stackLayer == layer)
+        return;
+    m_stackLayer = layer;
+    if (m_stackKey)
+        WindowStack::instance()->setLayer(m_stackKey, layer);
+    emit stackLayerChanged();
+}
+
+void StackableItem::setOpaqueRect(const QRectF &rect)
+{
+    if (m_opaqueRect == rect)
+        return;
+    m_opaqueRect = rect;
+    emit opaqueRectChanged();
+    emit opaqueRegionChanged();
+}
+
+void StackableItem::setWaylandItem(QWaylandQuickItem *item)
+{
+    if (m_waylandItem == item)
+        return;
+    if (m_waylandItem) {
+        disconnect(m_waylandItem, 0, this, 0);
+        if (m_waylandItem->surface())
+            disconnect(m_waylandItem->surface(), 0, this, 0);
+    }
+    m_waylandItem = item;
+    if (item) {
+        connect(item, &QWaylandQuickItem::surfaceChanged, this, &StackableItem::onSurfaceChanged);
+        connect(item, &QQuickItem::xChanged, this, &StackableItem::opaqueRegionChanged);
+        connect(item, &QQuickItem::yChanged, this, &StackableItem::opaqueRegionChanged);
+        connect(item, &QQuickItem::widthChanged, this, &StackableItem::opaqueRegionChanged);
+        connect(item, &QQuickItem::heightChanged, this, &StackableItem::opaqueRegionChanged);
+        connect(item, &QQuickItem::opacityChanged, this, &StackableItem::opaqueRegionChanged);
+        connect(item, &QQuickItem::visibleChanged, this, &StackableItem::opaqueRegionChanged);
+    }
+    onSurfaceChanged();
+    emit waylandItemChanged();
+}
+
+void StackableItem::setPrimaryView(bool primary)
+{
+    if (m_primaryView == primary)
+        return;
+    m_primaryView = primary;
+    emit primaryViewChanged();
+}
+
+void StackableItem::onSurfaceChanged()
+{
+    if (m_waylandItem && m_waylandItem->surface())
+        connect(m_waylandItem->surface(), &QWaylandSurface::redraw,
+                this, &StackableItem::onSurfaceRedraw, Qt::UniqueConnection);
+    onSurfaceRedraw();
+}
+
+void StackableItem::onSurfaceRedraw()
+{
+    // QtWayland doesn't expose the surface's opaque region, so go by the buffer format
+    bool opaque = false;
+    if (m_waylandItem && m_waylandItem->view()) {
+        QWaylandBufferRef buffer = m_waylandItem->view()->currentBuffer();
+        if (buffer.hasBuffer()) {
+            if (buffer.isSharedMemory()) {
+                opaque = !buffer.image().hasAlphaChannel();
+            } else {
+                switch (buffer.bufferFormatEgl()) {
+                case QWaylandBufferRef::BufferFormatEgl_RGB:
+                case QWaylandBufferRef::BufferFormatEgl_Y_U_V:
+                case QWaylandBufferRef::BufferFormatEgl_Y_UV:
+                case QWaylandBufferRef::BufferFormatEgl_Y_XUXV:
+                    opaque = true;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+    if (m_surfaceOpaque == opaque)
+        return;
+    m_surfaceOpaque = opaque;
+    emit opaqueRegionChanged();
+}
+
+QRegion StackableItem::opaqueRegion() const
+{
+    QRegion ret(innerRect(m_opaqueRect));
+    if (m_surfaceOpaque && m_waylandItem && m_waylandItem->isVisible() && m_waylandItem->opacity() >= 1)
+        ret += innerRect(m_waylandItem->mapRectToItem(this, m_waylandItem->boundingRect()));
+    return ret;
+}
+
+void StackableItem::setOccluded(bool occluded)
+{
+    if (m_occluded == occluded)
+        return;
+    m_occluded = occluded;
+    emit occludedChanged();
+}
 
 void StackableItem::lower()
 {
+    if (m_stackKey) {
+        WindowStack::instance()->lower(m_stackKey);
+        emit stackingChanged();
+        return;
+    }
     QQuickItem *parent = parentItem();
     Q_ASSERT(parent);
     QQuickItem *bottom = parent->childItems().first();
-    if (this != bottom)
+    if (this != bottom) {
         stackBefore(bottom);
+        emit stackingChanged();
+    }
 }
 
 void StackableItem::raise()
 {
+    if (m_stackKey) {
+        WindowStack::instance()->raise(m_stackKey);
+        emit stackingChanged();
+        return;
+    }
     QQuickItem *parent = parentItem();
     Q_ASSERT(parent);
     QQuickItem *top = parent->childItems().last();
-    if (this != top)
+    if (this != top) {
         stackAfter(top);
+        emit stackingChanged();
+    }
 }
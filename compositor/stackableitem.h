@@ -1,17 +1,80 @@
 #ifndef STACKABLEITEM_H
 #define STACKABLEITEM_H
 
+#include <QPointer>
 #include <QQuickItem>
+#include <QRegion>
+
+#include "windowstack.h"
+
+class QWaylandQuickItem;
 
 class StackableItem : public QQuickItem
 {
     Q_OBJECT
+    Q_PROPERTY(QRectF opaqueRect READ opaqueRect WRITE setOpaqueRect NOTIFY opaqueRectChanged)
+    Q_PROPERTY(QWaylandQuickItem *waylandItem READ waylandItem WRITE setWaylandItem NOTIFY waylandItemChanged)
+    Q_PROPERTY(bool primaryView READ isPrimaryView WRITE setPrimaryView NOTIFY primaryViewChanged)
+    Q_PROPERTY(bool occluded READ isOccluded NOTIFY occludedChanged)
+    Q_PROPERTY(QObject *stackKey READ stackKey WRITE setStackKey NOTIFY stackKeyChanged)
+    Q_PROPERTY(WindowStack::Layer stackLayer READ stackLayer WRITE setStackLayer NOTIFY stackLayerChanged)
 public:
     StackableItem();
+    ~StackableItem();
+
+    // the window this is a view of, in WindowStack; all its views are stacked together
+    QObject *stackKey() const { return m_stackKey; }
+    void setStackKey(QObject *key);
+
+    // not "layer", which would hide QQuickItem's layer.enabled, layer.effect etc.
+    WindowStack::Layer stackLayer() const { return m_stackLayer; }
+    void setStackLayer(WindowStack::Layer layer);
+
+    // a part of the item which is known to be fully opaque, in item coordinates
+    QRectF opaqueRect() const { return m_opaqueRect; }
+    void setOpaqueRect(const QRectF &rect);
+
+    // the surface item inside, which is opaque if its buffer has no alpha channel
+    QWaylandQuickItem *waylandItem() const { return m_waylandItem; }
+    void setWaylandItem(QWaylandQuickItem *item);
+
+    // the view on the output which shows most of the window; it paces the client's frames
+    bool isPrimaryView() const { return m_primaryView; }
+    void setPrimaryView(bool primary);
+
+    // set by OcclusionCuller when the item is hidden by items above it
+    bool isOccluded() const { return m_occluded; }
+    void setOccluded(bool occluded);
+
+    // opaqueRect and the surface item if it's opaque, in item coordinates
+    QRegion opaqueRegion() const;
 
 public Q_SLOTS:
     void raise();
     void lower();
+
+Q_SIGNALS:
+    void stackingChanged();
+    void opaqueRectChanged();
+    void waylandItemChanged();
+    void primaryViewChanged();
+    void occludedChanged();
+    void opaqueRegionChanged();
+    void stackKeyChanged();
+    void stackLayerChanged();
+
+protected Q_SLOTS:
+    void onSurfaceChanged();
+    void onSurfaceRedraw();
+
+protected:
+    QRectF m_opaqueRect;
+    QPointer<QWaylandQuickItem> m_waylandItem;
+    bool m_surfaceOpaque = false;
+    bool m_primaryView = true;
+    bool m_occluded = false;
+    QPointer<QObject> m_stackKey;
+    WindowStack::Layer m_stackLayer = WindowStack::Normal;
 };
 
 #endif // STACKABLEITEM_H
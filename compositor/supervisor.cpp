@@ -0,0 +1,197 @@
+#include "supervisor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// give up if it keeps crashing: more than this many restarts within RestartWindow seconds
+static const int MaxRestarts = 5;
+static const int RestartWindow = 60;
+
+QByteArray Supervisor::s_runtimeDir;
+QByteArray Supervisor::s_socketName;
+int Supervisor::s_socketFd = -1;
+int Supervisor::s_lockFd = -1;
+int Supervisor::s_restarts = 0;
+
+static volatile pid_t compositorPid = 0;
+static volatile sig_atomic_t stopping = 0;
+
+extern "C" void supervisorSignalHandler(int signal)
+{
+    // stop for good once the compositor has exited
+    stopping = 1;
+    if (compositorPid > 0)
+        kill(compositorPid, signal);
+}
+
+void Supervisor::start(int argc, char *argv[])
+{
+    bool supervise = false;
+    QByteArray name;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--supervise"))
+            supervise = true;
+        else if (!strcmp(argv[i], "--wayland-socket-name") && i + 1 < argc)
+            name = argv[i + 1];
+    }
+    if (!supervise)
+        return;
+    s_runtimeDir = qgetenv("XDG_RUNTIME_DIR");
+    if (s_runtimeDir.isEmpty()) {
+        fprintf(stderr, "supervisor: XDG_RUNTIME_DIR is not set; running unsupervised\n");
+        return;
+    }
+    bool bound = false;
+    if (!name.isEmpty()) {
+        bound = bindSocket(name);
+    } else {
+        // like wl_display_add_socket_auto()
+        for (int i = 0; i < 32 && !bound; ++i)
+            bound = bindSocket("wayland-" + QByteArray::number(i));
+    }
+    if (!bound) {
+        fprintf(stderr, "supervisor: failed to bind a Wayland socket; running unsupervised\n");
+        return;
+    }
+    supervise();
+}
+
+bool Supervisor::bindSocket(const QByteArray &name)
+{
+    const QByteArray path = s_runtimeDir + '/' + name;
+    const QByteArray lockPath = path + ".lock";
+    sockaddr_un addr;
+    if (size_t(path.size()) >= sizeof(addr.sun_path))
+        return false;
+    // the same locking protocol as libwayland, so that other compositors keep off
+    int lockFd = open(lockPath.constData(), O_CREAT | O_CLOEXEC | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (lockFd < 0)
+        return false;
+    if (flock(lockFd, LOCK_EX | LOCK_NB) < 0) {
+        close(lockFd);
+        return false;
+    }
+    unlink(path.constData()); // stale, since nobody holds the lock
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.constData());
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        fprintf(stderr, "supervisor: failed to listen on %s: %s\n", path.constData(), strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        unlink(lockPath.constData());
+        close(lockFd);
+        return false;
+    }
+    s_socketName = name;
+    s_socketFd = fd;
+    s_lockFd = lockFd;
+    return true;
+}
+
+int Supervisor::takeSocket()
+{
+    // the display owns what it's given; the supervisor keeps its own descriptor
+    return s_socketFd < 0 ? -1 : fcntl(s_socketFd, F_DUPFD_CLOEXEC, 0);
+}
+
+QByteArray Supervisor::sessionFilePath()
+{
+    if (!isSupervised())
+        return QByteArray();
+    return s_runtimeDir + "/grefsen-" + s_socketName + ".session";
+}
+
+void Supervisor::supervise()
+{
+    prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = &supervisorSignalHandler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, 0);
+    sigaction(SIGHUP, &sa, 0);
+    sigaction(SIGINT, &sa, 0);
+
+    time_t restartTimes[MaxRestarts] = { 0 };
+    int exitCode = EXIT_SUCCESS;
+    for (;;) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "supervisor: fork failed: %s\n", strerror(errno));
+            exitCode = EXIT_FAILURE;
+            break;
+        }
+        if (pid == 0) {
+            // the compositor
+            close(s_lockFd);
+            prctl(PR_SET_CHILD_SUBREAPER, 0, 0, 0, 0);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGHUP, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            return;
+        }
+        compositorPid = pid;
+
+        // reap orphaned clients along the way, until the compositor is done
+        int status = 0;
+        for (;;) {
+            int s = 0;
+            const pid_t ret = waitpid(-1, &s, 0);
+            if (ret == pid) {
+                status = s;
+                break;
+            }
+            if (ret < 0 && errno != EINTR) {
+                status = 0;
+                break;
+            }
+        }
+        compositorPid = 0;
+        cleanUp(s_socketName + '-' + QByteArray::number(pid));
+
+        if (stopping || (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)) {
+            exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+            break;
+        }
+        const time_t now = time(0);
+        if (restartTimes[s_restarts % MaxRestarts] && now - restartTimes[s_restarts % MaxRestarts] < RestartWindow) {
+            fprintf(stderr, "supervisor: the compositor crashed %d times within %d seconds; giving up\n",
+                    MaxRestarts, RestartWindow);
+            exitCode = EXIT_FAILURE;
+            break;
+        }
+        restartTimes[s_restarts % MaxRestarts] = now;
+        ++s_restarts;
+        if (WIFSIGNALED(status))
+            fprintf(stderr, "supervisor: the compositor (PID %d) died from signal %d: restart %d\n", pid, WTERMSIG(status), s_restarts);
+        else
+            fprintf(stderr, "supervisor: the compositor (PID %d) exited with status %d: restart %d\n", pid, WEXITSTATUS(status), s_restarts);
+    }
+
+    close(s_socketFd);
+    cleanUp(s_socketName);
+    unlink(sessionFilePath().constData());
+    close(s_lockFd);
+    exit(exitCode);
+}
+
+void Supervisor::cleanUp(const QByteArray &name)
+{
+    const QByteArray path = s_runtimeDir + '/' + name;
+    unlink(path.constData());
+    unlink((path + ".lock").constData());
+}
@@ -0,0 +1,52 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <QByteArray>
+
+/*!
+    Crash recovery for --supervise.
+
+    start() must be called first thing in main(), while the process is
+    still single-threaded.  With --supervise among the arguments, it binds
+    the listening Wayland socket (the --wayland-socket-name, or else the
+    first free wayland-N) and then forks: the parent stays in start() for
+    good, as the supervisor, and each child returns from it to run the
+    compositor.  When a child crashes, the next is forked right away.  It
+    adopts the same listening socket, so the socket never disappears, and
+    clients which connect meanwhile just wait in the backlog.  When a child
+    exits normally, the supervisor removes the socket and exits too.
+
+    The supervisor is also the subreaper of the session, so that clients
+    orphaned by a crash don't end up with init.  The compositor writes the
+    session (see SessionStore) to the runtime directory, which outlives it,
+    and a restarted compositor restores it.  Forking rather than exec'ing
+    means that Qt and the other libraries are already loaded and relocated;
+    the menu, icon, wallpaper, QML and shader caches are on disk anyway.
+*/
+class Supervisor
+{
+public:
+    static void start(int argc, char *argv[]);
+
+    static bool isSupervised() { return s_socketFd >= 0; }
+    // the listening socket, to be given to wl_display_add_socket_fd()
+    static int takeSocket();
+    // the name clients connect to
+    static QByteArray socketName() { return s_socketName; }
+    // how many times the compositor has been respawned; nonzero means restore the session
+    static int restarts() { return s_restarts; }
+    static QByteArray sessionFilePath();
+
+private:
+    static bool bindSocket(const QByteArray &name);
+    static void supervise();
+    static void cleanUp(const QByteArray &name);
+
+    static QByteArray s_runtimeDir;
+    static QByteArray s_socketName;
+    static int s_socketFd;
+    static int s_lockFd;
+    static int s_restarts;
+};
+
+#endif // SUPERVISOR_H
@@ -0,0 +1,145 @@
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStringList>
+
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *TraceCategory = "grefsen.trace";
+static QtMessageHandler previousHandler = 0;
+
+static qint64 currentThread()
+{
+    return syscall(SYS_gettid);
+}
+
+Tracer *Tracer::instance()
+{
+    static Tracer *ret = new Tracer;
+    return ret;
+}
+
+Tracer::Tracer()
+    : m_mainThread(currentThread())
+{
+}
+
+qint64 Tracer::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void Tracer::setFilePath(const QString &path)
+{
+    if (path.isEmpty() || isEnabled())
+        return;
+    m_filePath = path;
+    m_events.reserve(1024);
+    QLoggingCategory::setFilterRules(QString::fromLatin1(TraceCategory) + QLatin1String(".debug=true"));
+    previousHandler = qInstallMessageHandler(messageHandler);
+    record('i', "tracing started", now());
+}
+
+void Tracer::complete(const QByteArray &name, qint64 start, qint64 duration)
+{
+    record('X', name, start, duration);
+}
+
+void Tracer::begin(const QString &name)
+{
+    if (isEnabled())
+        record('B', name.toUtf8(), now());
+}
+
+void Tracer::end(const QString &name)
+{
+    if (isEnabled())
+        record('E', name.toUtf8(), now());
+}
+
+void Tracer::instant(const QString &name)
+{
+    if (isEnabled())
+        record('i', name.toUtf8(), now());
+}
+
+void Tracer::record(char phase, const QByteArray &name, qint64 timestamp, qint64 duration)
+{
+    Event e;
+    e.name = name;
+    e.phase = phase;
+    e.timestamp = timestamp;
+    e.duration = duration;
+    e.thread = currentThread();
+    QMutexLocker lock(&m_mutex);
+    m_events << e;
+}
+
+bool Tracer::write() const
+{
+    if (!isEnabled())
+        return false;
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    QJsonObject threadName;
+    threadName.insert(QStringLiteral("name"), QStringLiteral("thread_name"));
+    threadName.insert(QStringLiteral("ph"), QStringLiteral("M"));
+    threadName.insert(QStringLiteral("pid"), pid);
+    threadName.insert(QStringLiteral("tid"), m_mainThread);
+    threadName.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), QStringLiteral("main")}});
+    events << threadName;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (const Event &e : m_events) {
+            QJsonObject o;
+            o.insert(QStringLiteral("name"), QString::fromUtf8(e.name));
+            o.insert(QStringLiteral("cat"), QStringLiteral("grefsen"));
+            o.insert(QStringLiteral("ph"), QString(QLatin1Char(e.phase)));
+            o.insert(QStringLiteral("ts"), e.timestamp);
+            if (e.phase == 'X')
+                o.insert(QStringLiteral("dur"), e.duration);
+            else if (e.phase == 'i')
+                o.insert(QStringLiteral("s"), QStringLiteral("p"));
+            o.insert(QStringLiteral("pid"), pid);
+            o.insert(QStringLiteral("tid"), e.thread);
+            events << o;
+        }
+    }
+    QJsonObject doc;
+    doc.insert(QStringLiteral("traceEvents"), events);
+    doc.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+    QSaveFile f(m_filePath);
+    if (!f.open(QIODevice::WriteOnly) || f.write(QJsonDocument(doc).toJson(QJsonDocument::Compact)) < 0 || !f.commit()) {
+        qWarning() << "failed to write trace to" << m_filePath << f.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Tracer::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    if (type == QtDebugMsg && context.category && !strcmp(context.category, TraceCategory)) {
+        // "<start> <duration> <name>"
+        const QStringList parts = msg.split(QLatin1Char(' '));
+        if (parts.count() >= 3) {
+            const QByteArray name = msg.section(QLatin1Char(' '), 2).toUtf8();
+            instance()->complete(name, parts.at(0).toLongLong(), parts.at(1).toLongLong());
+            return;
+        }
+    }
+    if (previousHandler)
+        previousHandler(type, context, msg);
+    else
+        fprintf(stderr, "%s\n", qPrintable(qFormatLogMessage(type, context, msg)));
+}
@@ -0,0 +1,77 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+/*!
+    Records startup phases and other timed events, and writes them as a
+    Chrome trace (JSON object format), which chrome://tracing and Perfetto
+    can show on a timeline.
+
+    Events come from three places: Tracer::Scope around code in the
+    compositor; begin(), end() and instant() from QML; and debug messages in
+    the "grefsen.trace" logging category, which is how the Grefsen plugin
+    reports its own scopes without linking to the compositor.  Such a
+    message reads "<start µs> <duration µs> <name>", with times on the
+    monotonic clock.  The category is only enabled while tracing, so that
+    otherwise a scope costs no more than the category check.
+
+    Events are kept in memory and written by write(), at exit.
+*/
+class Tracer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static Tracer *instance();
+
+    // microseconds on the monotonic clock, the same as the plugin's TraceScope
+    static qint64 now();
+
+    bool isEnabled() const { return !m_filePath.isEmpty(); }
+    QString filePath() const { return m_filePath; }
+    void setFilePath(const QString &path);
+
+    void complete(const QByteArray &name, qint64 start, qint64 duration);
+    Q_INVOKABLE void begin(const QString &name);
+    Q_INVOKABLE void end(const QString &name);
+    Q_INVOKABLE void instant(const QString &name);
+    bool write() const;
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name)
+            : m_name(name), m_start(Tracer::instance()->isEnabled() ? Tracer::now() : 0) { }
+        ~Scope() { if (m_start) Tracer::instance()->complete(m_name, m_start, Tracer::now() - m_start); }
+    private:
+        const char *m_name;
+        qint64 m_start;
+    };
+
+protected:
+    Tracer();
+
+    struct Event {
+        QByteArray name;
+        char phase; // as in the trace format: X complete, B begin, E end, i instant
+        qint64 timestamp;
+        qint64 duration;
+        qint64 thread;
+    };
+
+    void record(char phase, const QByteArray &name, qint64 timestamp, qint64 duration = 0);
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg);
+
+protected:
+    QString m_filePath;
+    qint64 m_mainThread;
+    mutable QMutex m_mutex; // guards m_events, which any thread may add to
+    QVector<Event> m_events;
+};
+
+#endif // TRACER_H
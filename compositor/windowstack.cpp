@@ -0,0 +1,277 @@
+#include "windowstack.h"
+#include "stackableitem.h"
+
+// z values of different layers never meet
+static const qreal LayerSpacing = 1e12;
+
+WindowStackModel::WindowStackModel(WindowStack *stack)
+    : m_stack(stack)
+{
+}
+
+int WindowStackModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_stack->m_count;
+}
+
+QVariant WindowStackModel::data(const QModelIndex &index, int role) const
+{
+    const WindowStack::Window *w = m_stack->mruAt(index.row());
+    if (!w || !w->key)
+        return QVariant();
+    switch (role) {
+    case WindowRole:
+        return QVariant::fromValue(w->key.data());
+    case TitleRole:
+    case Qt::DisplayRole:
+        return w->key->property("title");
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> WindowStackModel::roleNames() const
+{
+    QHash<int, QByteArray> ret;
+    ret.insert(WindowRole, "window");
+    ret.insert(TitleRole, "title");
+    return ret;
+}
+
+WindowStack *WindowStack::instance()
+{
+    static WindowStack *ret = new WindowStack;
+    return ret;
+}
+
+WindowStack::WindowStack()
+    : m_model(this)
+{
+    for (int i = 0; i < LayerCount; ++i) {
+        m_bottom[i] = m_top[i] = 0;
+        m_topOrder[i] = m_bottomOrder[i] = 0;
+    }
+}
+
+WindowStack::Window *WindowStack::window(QObject *key, bool create)
+{
+    Window *w = m_windows.value(key);
+    if (w || !create)
+        return w;
+    w = new Window;
+    w->key = key;
+    m_windows.insert(key, w);
+    // the window state outlives its views, which come and go with outputs
+    connect(key, &QObject::destroyed, this, [this, key]() { destroyWindow(key); });
+    linkTop(w);
+    m_model.beginInsertRows(QModelIndex(), 0, 0);
+    linkMruFront(w);
+    ++m_count;
+    m_model.endInsertRows();
+    emit windowAdded(key);
+    emit activeWindowChanged();
+    return w;
+}
+
+void WindowStack::destroyWindow(QObject *key)
+{
+    Window *w = m_windows.take(key);
+    if (!w)
+        return;
+    const bool wasActive = w == m_mruHead;
+    const int row = mruRow(w);
+    unlinkLayer(w);
+    m_model.beginRemoveRows(QModelIndex(), row, row);
+    unlinkMru(w);
+    --m_count;
+    m_model.endRemoveRows();
+    if (m_cycleIndex >= m_count) {
+        m_cycleIndex = m_count - 1;
+        emit cycleIndexChanged();
+    }
+    delete w;
+    if (wasActive)
+        emit activeWindowChanged();
+}
+
+void WindowStack::addView(QObject *key, StackableItem *view)
+{
+    if (!key)
+        return;
+    Window *w = window(key, true);
+    if (!w->views.contains(view))
+        w->views << view;
+    applyZ(w);
+}
+
+void WindowStack::removeView(QObject *key, StackableItem *view)
+{
+    if (Window *w = window(key))
+        w->views.removeOne(view);
+}
+
+void WindowStack::setLayer(QObject *key, Layer layer)
+{
+    Window *w = window(key, true);
+    if (w->layer == layer)
+        return;
+    unlinkLayer(w);
+    w->layer = layer;
+    linkTop(w);
+    applyZ(w);
+}
+
+void WindowStack::unlinkLayer(Window *w)
+{
+    (w->below ? w->below->above : m_bottom[w->layer]) = w->above;
+    (w->above ? w->above->below : m_top[w->layer]) = w->below;
+    w->below = w->above = 0;
+}
+
+void WindowStack::linkTop(Window *w)
+{
+    w->below = m_top[w->layer];
+    w->above = 0;
+    (w->below ? w->below->above : m_bottom[w->layer]) = w;
+    m_top[w->layer] = w;
+    w->order = ++m_topOrder[w->layer];
+}
+
+void WindowStack::linkBottom(Window *w)
+{
+    w->above = m_bottom[w->layer];
+    w->below = 0;
+    (w->above ? w->above->below : m_top[w->layer]) = w;
+    m_bottom[w->layer] = w;
+    w->order = --m_bottomOrder[w->layer];
+}
+
+void WindowStack::unlinkMru(Window *w)
+{
+    (w->mruPrev ? w->mruPrev->mruNext : m_mruHead) = w->mruNext;
+    (w->mruNext ? w->mruNext->mruPrev : m_mruTail) = w->mruPrev;
+    w->mruPrev = w->mruNext = 0;
+}
+
+void WindowStack::linkMruFront(Window *w)
+{
+    w->mruPrev = 0;
+    w->mruNext = m_mruHead;
+    (m_mruHead ? m_mruHead->mruPrev : m_mruTail) = w;
+    m_mruHead = w;
+}
+
+int WindowStack::mruRow(const Window *w) const
+{
+    int row = 0;
+    for (const Window *i = m_mruHead; i && i != w; i = i->mruNext)
+        ++row;
+    return row;
+}
+
+WindowStack::Window *WindowStack::mruAt(int row) const
+{
+    Window *w = m_mruHead;
+    for (int i = 0; w && i < row; ++i)
+        w = w->mruNext;
+    return w;
+}
+
+void WindowStack::applyZ(Window *w)
+{
+    const qreal z = w->layer * LayerSpacing + w->order;
+    for (StackableItem *view : w->views)
+        view->setZ(z);
+}
+
+void WindowStack::moveToMruFront(Window *w)
+{
+    if (w == m_mruHead)
+        return;
+    // only the model needs the row; relinking itself is constant time
+    const int row = mruRow(w);
+    m_model.beginMoveRows(QModelIndex(), row, row, QModelIndex(), 0);
+    unlinkMru(w);
+    linkMruFront(w);
+    m_model.endMoveRows();
+    emit activeWindowChanged();
+}
+
+void WindowStack::raise(QObject *key)
+{
+    Window *w = window(key);
+    if (!w)
+        return;
+    if (w != m_top[w->layer]) {
+        unlinkLayer(w);
+        linkTop(w);
+        applyZ(w);
+    }
+    moveToMruFront(w);
+}
+
+void WindowStack::lower(QObject *key)
+{
+    Window *w = window(key);
+    if (!w || w == m_bottom[w->layer])
+        return;
+    unlinkLayer(w);
+    linkBottom(w);
+    applyZ(w);
+}
+
+void WindowStack::activate(QObject *key)
+{
+    Window *w = window(key);
+    if (!w)
+        return;
+    raise(key);
+    emit activated(key);
+}
+
+QObject *WindowStack::cycle(int step)
+{
+    if (!m_count)
+        return 0;
+    // starting from the active window, so that a single alt-tab goes to the previous one
+    const int start = m_cycleIndex < 0 ? 0 : m_cycleIndex;
+    m_cycleIndex = ((start + step) % m_count + m_count) % m_count;
+    emit cycleIndexChanged();
+    Window *w = mruAt(m_cycleIndex);
+    return w ? w->key.data() : 0;
+}
+
+void WindowStack::commitCycle()
+{
+    Window *w = m_cycleIndex < 0 ? 0 : mruAt(m_cycleIndex);
+    m_cycleIndex = -1;
+    emit cycleIndexChanged();
+    if (w)
+        activate(w->key);
+}
+
+void WindowStack::cancelCycle()
+{
+    if (m_cycleIndex < 0)
+        return;
+    m_cycleIndex = -1;
+    emit cycleIndexChanged();
+}
+
+QVariantList WindowStack::views(QObject *key)
+{
+    QVariantList ret;
+    if (Window *w = window(key))
+        for (StackableItem *view : w->views)
+            ret << QVariant::fromValue<QObject *>(view);
+    return ret;
+}
+
+QList<QObject *> WindowStack::stackingOrder() const
+{
+    QList<QObject *> ret;
+    for (int layer = 0; layer < LayerCount; ++layer)
+        for (Window *w = m_bottom[layer]; w; w = w->above)
+            if (w->key)
+                ret << w->key.data();
+    return ret;
+}
@@ -0,0 +1,128 @@
+#ifndef WINDOWSTACK_H
+#define WINDOWSTACK_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPointer>
+#include <QVariantList>
+#include <QVector>
+
+class StackableItem;
+class WindowStack;
+
+/*!
+    The windows in most recently used order, for an alt-tab switcher.
+*/
+class WindowStackModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles { WindowRole = Qt::UserRole + 1, TitleRole };
+
+    explicit WindowStackModel(WindowStack *stack);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+protected:
+    friend class WindowStack;
+    WindowStack *m_stack;
+};
+
+/*!
+    Keeps the stacking and focus order of all windows.
+
+    A window is identified by a key, the shell surface, and may have a view
+    (a StackableItem, i.e. a Chrome) on each output.  Windows are kept in
+    intrusive linked lists: one per layer in stacking order, and one in most
+    recently used order.  raise(), lower() and activate() are constant time:
+    they relink the window and give its views a z value above (or below)
+    everything else in its layer, so that no child item lists need to be
+    copied or reordered.  The layers are stacked in the order of the Layer
+    enum.
+
+    cycle() walks through the MRU list for alt-tab; commitCycle() activates
+    the chosen window.  altTabModel presents the MRU list, and since moving
+    a window to the front is a single row move, it stays sorted for free.
+*/
+class WindowStack : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QAbstractItemModel *altTabModel READ altTabModel CONSTANT)
+    Q_PROPERTY(int cycleIndex READ cycleIndex NOTIFY cycleIndexChanged)
+    Q_PROPERTY(QObject *activeWindow READ activeWindow NOTIFY activeWindowChanged)
+
+public:
+    enum Layer { Normal, Popup, Fullscreen, LayerCount };
+    Q_ENUM(Layer)
+
+    static WindowStack *instance();
+
+    QAbstractItemModel *altTabModel() { return &m_model; }
+    int cycleIndex() const { return m_cycleIndex; }
+    QObject *activeWindow() const { return m_mruHead ? m_mruHead->key.data() : 0; }
+
+    void addView(QObject *key, StackableItem *view);
+    void removeView(QObject *key, StackableItem *view);
+    void setLayer(QObject *key, Layer layer);
+
+    Q_INVOKABLE void raise(QObject *key);
+    Q_INVOKABLE void lower(QObject *key);
+    Q_INVOKABLE void activate(QObject *key);
+    Q_INVOKABLE QObject *cycle(int step = 1);
+    Q_INVOKABLE void commitCycle();
+    Q_INVOKABLE void cancelCycle();
+    // the StackableItems showing the window, one per output it is on
+    Q_INVOKABLE QVariantList views(QObject *key);
+    // all windows, bottom first
+    QList<QObject *> stackingOrder() const;
+
+signals:
+    void windowAdded(QObject *window);
+    void cycleIndexChanged();
+    void activeWindowChanged();
+    // the window should get keyboard focus
+    void activated(QObject *window);
+
+protected:
+    WindowStack();
+
+    struct Window {
+        QPointer<QObject> key;
+        QVector<StackableItem *> views;
+        Layer layer = Normal;
+        qint64 order = 0; // z within the layer
+        Window *below = 0;
+        Window *above = 0;
+        Window *mruPrev = 0;
+        Window *mruNext = 0;
+    };
+
+    Window *window(QObject *key, bool create = false);
+    void destroyWindow(QObject *key);
+    void unlinkLayer(Window *w);
+    void linkTop(Window *w);
+    void linkBottom(Window *w);
+    void unlinkMru(Window *w);
+    void linkMruFront(Window *w);
+    int mruRow(const Window *w) const;
+    Window *mruAt(int row) const;
+    void applyZ(Window *w);
+    void moveToMruFront(Window *w);
+
+protected:
+    friend class WindowStackModel;
+    QHash<QObject *, Window *> m_windows;
+    Window *m_bottom[LayerCount];
+    Window *m_top[LayerCount];
+    qint64 m_topOrder[LayerCount];
+    qint64 m_bottomOrder[LayerCount];
+    Window *m_mruHead = 0;
+    Window *m_mruTail = 0;
+    int m_count = 0;
+    int m_cycleIndex = -1;
+    WindowStackModel m_model;
+};
+
+#endif // WINDOWSTACK_H
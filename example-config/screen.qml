@@ -1,13 +1,21 @@
 import QtQuick 2.6
 import Grefsen 1.0
+import com.theqtcompany.wlcompositor 1.0
 
-Image {
-    fillMode: Image.PreserveAspectCrop
+Wallpaper {
     // download from https://commons.wikimedia.org/wiki/File:Oslo_mot_Grefsentoppen_fra_Ekeberg.jpg
-    source: Env.grefsenconfig + "Oslo_mot_Grefsentoppen_fra_Ekeberg.jpg"
+    path: Env.grefsenconfig + "Oslo_mot_Grefsentoppen_fra_Ekeberg.jpg"
 
     // TODO set the icon theme
 
+    // How often clients may draw when their windows are covered by others
+    // (occludedMode) or not shown at all (hiddenMode): FrameCallbackPolicy.EveryFrame,
+    // .Throttled (once per throttledInterval ms) or .Suspended
+    Component.onCompleted: {
+        FrameCallbackPolicy.occludedMode = FrameCallbackPolicy.Throttled
+        FrameCallbackPolicy.throttledInterval = 1000
+    }
+
     LeftSlidePanel {
         id: leftPanel
 
@@ -35,7 +43,7 @@ Image {
         }
 
         /*
-        // depends on https://git.merproject.org/mer-core/libconnman-qt
+        // needs connman running on the system bus
         PopoverTrayIcon {
             popover: ConnmanPopover { }
             icon: "preferences-system-network"
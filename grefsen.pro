@@ -1,3 +1,5 @@
 TEMPLATE = subdirs
 
-SUBDIRS += compositor imports example-config
+SUBDIRS += compositor imports example-config benchmark
+
+benchmark.depends = compositor
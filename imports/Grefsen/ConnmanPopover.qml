@@ -1,28 +1,11 @@
 import QtQuick 2.6
 import QtQuick.Controls 2.0
-import MeeGo.Connman 0.2
+import Grefsen 1.0
 
 Popover {
     width: 320
     height: 480
 
-    NetworkManager {
-        id: manager
-        function checkTechnologies() {
-            var tl = manager.technologiesList()
-            if (tl.length > 0)
-                techList.model = tl
-            console.log("state " + state + " available? " + available + " enabled svcs " + servicesEnabled + " techs " + technologiesEnabled)
-            console.log("   list " + tl)
-        }
-
-        onAvailabilityChanged: checkTechnologies()
-        onStateChanged: checkTechnologies()
-        onOfflineModeChanged: checkTechnologies()
-        onTechnologiesChanged: checkTechnologies()
-        onTechnologiesEnabledChanged: checkTechnologies()
-    }
-
     SwipeView {
         id: swipeView
 
@@ -32,53 +15,51 @@ Popover {
         ListView {
             id: techList
             spacing: 2
+            model: ConnmanTechnologyModel { }
             delegate: Rectangle {
                 width: parent.width
                 height: 40
                 color: "#222"
-                property NetworkTechnology tech: manager.getTechnology(modelData)
                 Text {
-                    text: tech.name
+                    text: model.name
                     color: "white"
                     anchors.verticalCenter: parent.verticalCenter
                     x: 6
                 }
                 MouseArea {
                     anchors.fill: parent
-                    enabled: modelData === "wifi" && techEnableSwitch.checked
-                    onClicked: swipeView.currentIndex = 1
+                    enabled: model.type === "wifi" && model.powered
+                    onClicked: {
+                        wifiModel.scan()
+                        swipeView.currentIndex = 1
+                    }
                 }
                 Switch {
-                    id: techEnableSwitch
-                    checked: tech.powered
+                    checked: model.powered
                     anchors {
                         right: parent.right
                         margins: 6
                         verticalCenter: parent.verticalCenter
                     }
-                    onReleased: {
-                        console.log("setting " + modelData + " " + !checked)
-                        tech.powered = !checked
-                    }
+                    // the model follows when connman reports the change
+                    onReleased: techList.model.setPowered(model.path, !model.powered)
                 }
             }
         }
         ListView {
             id: wifiList
             spacing: 2
-            model: TechnologyModel {
-                id: techModel
-                name: "wifi"
-                onAvailabilityChanged: {
-                    console.log(name + " powered? " + powered + " available? " + available)
-                }
+            model: ConnmanServiceModel {
+                id: wifiModel
+                type: "wifi"
             }
             delegate: Rectangle {
+                readonly property bool connected: model.state === "ready" || model.state === "online"
                 width: parent.width
                 height: 40
                 color: "#222"
                 Text {
-                    text: networkService.name
+                    text: model.name
                     color: "white"
                     anchors.verticalCenter: parent.verticalCenter
                     x: 6
@@ -91,15 +72,12 @@ Popover {
                     }
                     color: "white"
                     font.pixelSize: 30
-                    text: networkService.connected ? "✔" : ""
+                    text: connected ? "✔" : ""
                 }
                 MouseArea {
                     anchors.fill: parent
-                    enabled: !networkService.connected
-                    onClicked: {
-                        console.log("trying to connect to " + networkService.name)
-                        networkService.requestConnect()
-                    }
+                    enabled: !connected
+                    onClicked: wifiModel.connectService(model.path)
                 }
             }
         }
@@ -1,20 +1,58 @@
 TEMPLATE = lib
 TARGET  = grefsenplugin
 TARGETPATH = Grefsen
-QT += qml quick xml
+QT += concurrent dbus qml quick xml
 CONFIG += link_pkgconfig
 QMAKE_CXXFLAGS += -std=c++11
 PKGCONFIG += glib-2.0 Qt5Xdg
 
 SOURCES += \
     plugin.cpp \
+    connmanmodel.cpp \
+    glyphprovider.cpp \
     hoverarea.cpp \
+    iconcache.cpp \
     iconprovider.cpp \
-    launchermodel.cpp
+    launcherlistmodel.cpp \
+    launchermenuloader.cpp \
+    launchermenumodel.cpp \
+    launchermodel.cpp \
+    launchersearchindex.cpp \
+    pixmapindex.cpp \
+    popoverregistry.cpp \
+    wallclock.cpp \
+    wallpaperprovider.cpp
 
 HEADERS += \
+    connmanmodel.h \
+    glyphprovider.h \
     hoverarea.h \
+    iconcache.h \
     iconprovider.h \
-    launchermodel.h
+    launcherlistmodel.h \
+    launchermenuloader.h \
+    launchermenumodel.h \
+    launchermodel.h \
+    launchersearchindex.h \
+    pixmapindex.h \
+    popoverregistry.h \
+    tracescope.h \
+    wallclock.h \
+    wallpaperprovider.h
 
 OTHER_FILES += *.qml
+
+# Compile the QML files ahead of time into .qmlc files beside them, where
+# the engine looks first.  If one is out of date, it is recompiled at runtime.
+qtPrepareTool(QML_CACHEGEN, qmlcachegen)
+exists($$[QT_HOST_BINS]/qmlcachegen*) {
+    QML_FILES = $$files($$PWD/*.qml)
+    qmlcachegen.input = QML_FILES
+    qmlcachegen.output = ${QMAKE_FILE_IN}c
+    lessThan(QT_MINOR_VERSION, 11): QML_CACHEGEN += --target-architecture=$$QT_ARCH
+    qmlcachegen.commands = $$QML_CACHEGEN ${QMAKE_FILE_IN} -o ${QMAKE_FILE_OUT}
+    qmlcachegen.name = qmlcachegen ${QMAKE_FILE_IN}
+    qmlcachegen.CONFIG = no_link target_predeps
+    QMAKE_EXTRA_COMPILERS += qmlcachegen
+    QMAKE_CLEAN += $$PWD/*.qmlc
+}
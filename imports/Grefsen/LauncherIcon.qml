@@ -5,10 +5,6 @@ MouseArea {
     width: parent.width
     height: width
 
-    ProcessLauncher {
-        id: launcher
-    }
-
     property string path: ""
     property string icon: ""
     Image {
@@ -17,5 +13,5 @@ MouseArea {
         sourceSize.height: 64
         anchors.centerIn: parent
     }
-    onClicked: if (path) launcher.launch(path); else console.log("nothing to launch")
+    onClicked: if (path) LaunchService.launch(path); else console.log("nothing to launch")
 }
@@ -1,6 +1,7 @@
 import QtQuick 2.5
 import QtQuick.Controls 2.0
 import Grefsen 1.0
+import com.theqtcompany.wlprocesslauncher 1.0
 
 HoverArea {
     id: root
@@ -33,11 +34,10 @@ HoverArea {
                 LauncherModel.reset()
                 searchField.text = ""
             }
-            Text {
+            Image {
                 anchors.centerIn: parent
-                font.family: "FontAwesome"
-                text: "\uf05c"  // TODO more specific clear-text-field icon
-                font.pointSize: searchField.font.pointSize * 1.25
+                source: "image://glyph/f05c"  // TODO more specific clear-text-field icon
+                sourceSize.height: Math.round(searchField.height * 0.6)
             }
         }
 
@@ -53,7 +53,11 @@ HoverArea {
         delegate: MouseArea {
             width: parent.width
             height: 32
-            onClicked: LauncherModel.select(modelData)
+            onClicked: {
+                var entry = LauncherModel.select(index)
+                if (entry.command)
+                    LaunchService.launchEntry(entry, model.title)
+            }
 
             Rectangle {
                 radius: 2
@@ -62,7 +66,7 @@ HoverArea {
                 opacity: 0.35
             }
             Image {
-                source: "image://icon/" + modelData.icon
+                source: "image://icon/" + model.icon
                 sourceSize.width: 22
                 sourceSize.height: 22
                 anchors.verticalCenter: parent.verticalCenter
@@ -72,10 +76,15 @@ HoverArea {
                 anchors.verticalCenter: parent.verticalCenter
                 x: 30
                 elide: Text.ElideRight
-                text: modelData.title
-//                Component.onCompleted: console.log(" "+ JSON.stringify(modelData))
+                text: model.title
                 width: parent.width - x - 4
             }
         }
     }
+    Text {
+        anchors.centerIn: list
+        visible: LauncherModel.loading
+        text: qsTr("Loading…")
+        color: "beige"
+    }
 }
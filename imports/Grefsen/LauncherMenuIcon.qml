@@ -5,17 +5,28 @@ MouseArea {
     id: root
     width: parent.width
     height: width
+    hoverEnabled: true
     property bool checked: false
 
+    function prewarm() {
+        loader.prewarm()
+    }
+
     Image {
         source: "qrc:///images/grefsen-logo-on-silhouette.png"
         anchors.centerIn: parent
     }
+    onEntered: prewarm()
     onClicked: root.checked = !checked
 
-    LauncherMenu {
+    PopoverLoader {
+        id: loader
         anchors.left: parent.right
-        visible: root.checked
-        onClose: root.checked = false
+        open: root.checked
+        sourceComponent: Component {
+            LauncherMenu {
+                onClose: root.checked = false
+            }
+        }
     }
 }
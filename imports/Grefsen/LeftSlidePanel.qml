@@ -31,6 +31,15 @@ Flickable {
         contentX = width
     }
 
+    // start creating the popovers of the items in the panel, which are likely to be opened soon
+    function prewarm() {
+        for (var i = 0; i < contentContainer.children.length; ++i) {
+            var child = contentContainer.children[i]
+            if (typeof child.prewarm === "function")
+                child.prewarm()
+        }
+    }
+
     function toggle() {
         if (contentX < width / 2)
             contentX = width
@@ -40,6 +49,15 @@ Flickable {
 
     Component.onCompleted: close()
 
+    // while any of it is on screen, the screen must be composited normally
+    readonly property bool showing: contentX < width
+    property bool __counted: false
+    onShowingChanged: if (showing !== __counted) {
+        glassPane.activeOverlays += showing ? 1 : -1
+        __counted = showing
+    }
+    Component.onDestruction: if (__counted) --glassPane.activeOverlays
+
     default property alias __content: contentContainer.data
     onDraggingChanged: if (!dragging) {
        if (horizontalVelocity > 0)
@@ -85,7 +103,10 @@ Flickable {
         HoverArea {
             anchors.fill: parent
             anchors.rightMargin: -10
-            onEntered: root.open()
+            onEntered: {
+                root.open()
+                root.prewarm()
+            }
             onExited: root.close()
         }
     }
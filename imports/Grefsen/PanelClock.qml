@@ -1,6 +1,7 @@
 import QtQuick 2.5
 import QtQuick.Controls 1.4
 import QtQuick.Controls.Styles 1.4
+import Grefsen 1.0
 
 PopoverPanelItem {
 
@@ -13,6 +14,7 @@ PopoverPanelItem {
             font.family: "Manzanita"
             font.pixelSize: 46
             color: "lightgreen"
+            text: WallClock.timeText
         }
         Text {
             x: 48
@@ -21,15 +23,7 @@ PopoverPanelItem {
             font.pixelSize: 30
             color: "lightgreen"
             anchors.baseline: time.baseline
-        }
-        function update() {
-            var now = new Date();
-            time.text = ("0" + now.getUTCHours()).slice(-2) + ":"
-                    + ("0" + now.getUTCMinutes()).slice(-2)
-            seconds.text = ":" + ("0" + now.getUTCSeconds()).slice(-2);
-            date.text = now.getFullYear() + "." +
-                    ("0" + (now.getMonth() + 1)).slice(-2) + "." +
-                    ("0" + now.getDate()).slice(-2)
+            text: ":" + WallClock.secondText
         }
     }
     Text {
@@ -39,12 +33,10 @@ PopoverPanelItem {
         anchors.horizontalCenter: parent.horizontalCenter
         anchors.horizontalCenterOffset: 2
         color: "beige"
+        text: WallClock.dateText
     }
-    Timer {
-        interval: 1000; running: true; repeat: true
-        onTriggered: clock.update()
-    }
-    Component.onCompleted: clock.update()
+    // keeps the seconds going, but only while the panel is open
+    ClockTimer { interval: 1 }
 
     popover: Popover {
         width: 480
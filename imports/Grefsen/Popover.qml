@@ -1,4 +1,6 @@
 import QtQuick 2.6
+import QtQuick.Window 2.2
+import Grefsen 1.0
 
 Item {
     id: wrapper
@@ -10,11 +12,30 @@ Item {
     height: 100
 
     default property alias __content: contentContainer.data
-    property var __popoverPos: mapToItem(glassPane, x, y)
-    Component.onCompleted: popover.parent = glassPane
+    // the glassPane of the output this is on
+    property Item __glassPane: PopoverRegistry.glassPane(Window.window) || glassPane
+    property var __popoverPos: mapToItem(__glassPane, x, y)
+
+    // a prewarmed popover is hidden, and doesn't stop culling
+    property Item __counted: null
+    onVisibleChanged: __count()
+    Component.onCompleted: __count()
+    function __count() {
+        var target = visible ? __glassPane : null
+        if (__counted === target)
+            return
+        if (__counted)
+            --__counted.activeOverlays
+        __counted = target
+        if (__counted)
+            ++__counted.activeOverlays
+    }
+    Component.onDestruction: if (__counted) --__counted.activeOverlays
 
     Item {
         id: popover
+        parent: wrapper.__glassPane
+        visible: wrapper.visible
         x: __popoverPos.x
         y: __popoverPos.y
         width: wrapper.width
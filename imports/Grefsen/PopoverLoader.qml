@@ -0,0 +1,46 @@
+import QtQuick 2.6
+import Grefsen 1.0
+
+/*!
+    Creates a popover only when it is needed, and lets it go again.
+
+    prewarm() starts incubating sourceComponent asynchronously, without
+    showing it; opening it finishes the incubation right away if it is
+    still going on.  The item is released after it has been closed for
+    PopoverRegistry.idleTimeout ms.
+*/
+Loader {
+    id: loader
+    property bool open: false
+
+    active: false
+    asynchronous: !open
+    visible: open && status === Loader.Ready
+    focus: open
+
+    function prewarm() {
+        active = true
+        if (!open)
+            releaseTimer.restart()
+    }
+
+    onOpenChanged: {
+        if (open) {
+            active = true
+            releaseTimer.stop()
+        } else {
+            releaseTimer.restart()
+        }
+    }
+
+    Timer {
+        id: releaseTimer
+        interval: PopoverRegistry.idleTimeout
+        onTriggered: if (!loader.open) loader.active = false
+    }
+
+    Connections {
+        target: PopoverRegistry
+        onReleaseRequested: if (!loader.open) loader.active = false
+    }
+}
@@ -4,20 +4,22 @@ MouseArea {
     id: root
     width: parent.width
     height: width
+    hoverEnabled: true
 
     property Component popover: null
 
-    Loader {
+    function prewarm() {
+        loader.prewarm()
+    }
+
+    PopoverLoader {
         id: loader
         anchors.left: root.right
         anchors.top: root.top
+        sourceComponent: root.popover
         onItemChanged: if (item) item.pointLeftToY = root.height / 2
     }
 
-    onClicked: {
-        if (loader.sourceComponent == undefined)
-            loader.sourceComponent = popover
-        else
-            loader.sourceComponent = undefined
-    }
+    onEntered: prewarm()
+    onClicked: loader.open = !loader.open
 }
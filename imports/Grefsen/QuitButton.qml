@@ -10,18 +10,16 @@ MouseArea {
         color: "red"
         radius: width
         width: height
-        height: closeIcon.font.pixelSize * 1.1
+        height: closeIcon.sourceSize.height * 1.1
         anchors.centerIn: parent
     }
 
-    Text {
+    Image {
         id: closeIcon
         anchors.centerIn: parent
         anchors.verticalCenterOffset: -1
-        font.pixelSize: 36
-        font.family: "FontAwesome"
-        text: "\uf00d"
-        color: "white"
+        source: "image://glyph/f00d/white" // prerendered at this size: see GlyphProvider::prewarm()
+        sourceSize.height: 36
     }
 
     onClicked: Qt.quit()
@@ -0,0 +1,17 @@
+import QtQuick 2.6
+import QtQuick.Window 2.2
+
+/*!
+    A wallpaper which is decoded in the background at the size of the item
+    in device pixels, and cropped to fill it.  Outputs of the same size share
+    the decoded image.
+*/
+Image {
+    property string path
+
+    fillMode: Image.PreserveAspectCrop
+    asynchronous: true
+    // layout first, so that the image is never decoded at full size
+    sourceSize: Qt.size(width * Screen.devicePixelRatio, height * Screen.devicePixelRatio)
+    source: path && width > 0 && height > 0 ? "image://wallpaper/" + path : ""
+}
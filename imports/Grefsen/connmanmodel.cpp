@@ -0,0 +1,354 @@
+#include "connmanmodel.h"
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusVariant>
+#include <QDebug>
+#include <QSet>
+
+static const QString Service = QStringLiteral("net.connman");
+static const QString ManagerInterface = QStringLiteral("net.connman.Manager");
+static const QString TechnologyInterface = QStringLiteral("net.connman.Technology");
+static const QString ServiceInterface = QStringLiteral("net.connman.Service");
+// while roaming, connman sends bursts of property changes; wait for them to settle
+static const int SyncDelay = 100;
+
+QDBusArgument &operator<<(QDBusArgument &argument, const ConnmanObject &object)
+{
+    argument.beginStructure();
+    argument << object.path << object.properties;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, ConnmanObject &object)
+{
+    argument.beginStructure();
+    argument >> object.path >> object.properties;
+    argument.endStructure();
+    return argument;
+}
+
+static QByteArray roleName(const QString &key)
+{
+    return (key.left(1).toLower() + key.mid(1)).toLatin1();
+}
+
+ConnmanListModel::ConnmanListModel(const QStringList &keys, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_keys(keys)
+    , m_watcher(Service, bus(), QDBusServiceWatcher::WatchForRegistration | QDBusServiceWatcher::WatchForUnregistration)
+{
+    qDBusRegisterMetaType<ConnmanObject>();
+    qDBusRegisterMetaType<ConnmanObjectList>();
+    m_syncTimer.setSingleShot(true);
+    m_syncTimer.setInterval(SyncDelay);
+    connect(&m_syncTimer, &QTimer::timeout, this, &ConnmanListModel::sync);
+    connect(&m_watcher, &QDBusServiceWatcher::serviceRegistered, this, &ConnmanListModel::onServiceRegistered);
+    connect(&m_watcher, &QDBusServiceWatcher::serviceUnregistered, this, &ConnmanListModel::onServiceUnregistered);
+    // the subclass isn't constructed yet, so fetch() has to wait
+    QTimer::singleShot(0, this, [this]() {
+        QDBusPendingCallWatcher *w = new QDBusPendingCallWatcher(bus().interface()->asyncCall(
+                QStringLiteral("NameHasOwner"), Service), this);
+        connect(w, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *watcher) {
+            QDBusPendingReply<bool> reply = *watcher;
+            if (reply.isValid() && reply.value())
+                onServiceRegistered();
+            else
+                qDebug() << "connman is not running";
+            watcher->deleteLater();
+        });
+    });
+}
+
+QDBusConnection ConnmanListModel::bus()
+{
+    return QDBusConnection::systemBus();
+}
+
+void ConnmanListModel::onServiceRegistered()
+{
+    if (!m_available) {
+        m_available = true;
+        emit availableChanged();
+    }
+    fetch();
+}
+
+void ConnmanListModel::onServiceUnregistered()
+{
+    m_order.clear();
+    m_target.clear();
+    sync();
+    if (m_available) {
+        m_available = false;
+        emit availableChanged();
+    }
+}
+
+void ConnmanListModel::connectPropertyChanged(const QString &interface)
+{
+    // any path: one match rule for all the objects
+    bus().connect(Service, QString(), interface, QStringLiteral("PropertyChanged"), this,
+                  SLOT(onPropertyChanged(QString,QDBusVariant,QDBusMessage)));
+}
+
+void ConnmanListModel::call(const QString &path, const QString &interface, const QString &method, const QVariantList &args)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(Service, path, interface, method);
+    message.setArguments(args);
+    QDBusPendingCallWatcher *w = new QDBusPendingCallWatcher(bus().asyncCall(message), this);
+    connect(w, &QDBusPendingCallWatcher::finished, this, [path, method](QDBusPendingCallWatcher *watcher) {
+        if (watcher->isError())
+            qWarning() << "connman:" << method << path << "failed:" << watcher->error().message();
+        watcher->deleteLater();
+    });
+}
+
+void ConnmanListModel::onObjectListReply(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<ConnmanObjectList> reply = *watcher;
+    watcher->deleteLater();
+    if (reply.isError()) {
+        qWarning() << "connman:" << reply.error().message();
+        return;
+    }
+    setObjects(reply.value());
+}
+
+void ConnmanListModel::setObjects(const ConnmanObjectList &objects)
+{
+    QStringList order;
+    for (const ConnmanObject &o : objects) {
+        const QString path = o.path.path();
+        order << path;
+        QVariantMap &properties = m_target[path];
+        for (auto it = o.properties.constBegin(); it != o.properties.constEnd(); ++it)
+            properties.insert(it.key(), it.value());
+    }
+    const QSet<QString> kept = order.toSet();
+    for (const QString &path : qAsConst(m_order))
+        if (!kept.contains(path))
+            m_target.remove(path);
+    m_order = order;
+    scheduleSync();
+}
+
+void ConnmanListModel::updateObject(const QString &path, const QVariantMap &properties)
+{
+    if (!m_target.contains(path))
+        m_order << path;
+    QVariantMap &target = m_target[path];
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it)
+        target.insert(it.key(), it.value());
+    scheduleSync();
+}
+
+void ConnmanListModel::removeObject(const QString &path)
+{
+    if (m_target.remove(path)) {
+        m_order.removeOne(path);
+        scheduleSync();
+    }
+}
+
+void ConnmanListModel::onPropertyChanged(const QString &name, const QDBusVariant &value, const QDBusMessage &message)
+{
+    // only for objects which are listed already; others come with their own properties
+    auto it = m_target.find(message.path());
+    if (it == m_target.end() || !m_keys.contains(name))
+        return;
+    it->insert(name, value.variant());
+    scheduleSync();
+}
+
+void ConnmanListModel::sync()
+{
+    m_syncTimer.stop();
+    const int oldCount = m_rows.count();
+    QStringList order;
+    for (const QString &path : qAsConst(m_order))
+        if (accepts(m_target.value(path)))
+            order << path;
+    const QSet<QString> wanted = order.toSet();
+
+    // the same steps as LauncherListModel::setRows(): remove runs from the end,
+    // then move what remains into order and insert the rest
+    for (int i = m_rows.count() - 1; i >= 0; --i) {
+        if (wanted.contains(m_rows.at(i).path))
+            continue;
+        const int last = i;
+        while (i > 0 && !wanted.contains(m_rows.at(i - 1).path))
+            --i;
+        beginRemoveRows(QModelIndex(), i, last);
+        m_rows.remove(i, last - i + 1);
+        endRemoveRows();
+    }
+    QSet<QString> present;
+    for (const Row &row : qAsConst(m_rows))
+        present.insert(row.path);
+    for (int i = 0; i < order.count(); ++i) {
+        const QString &path = order.at(i);
+        if (i < m_rows.count() && m_rows.at(i).path == path)
+            continue;
+        if (present.contains(path)) {
+            int from = i + 1;
+            while (m_rows.at(from).path != path)
+                ++from;
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+            m_rows.move(from, i);
+            endMoveRows();
+        } else {
+            int end = i + 1;
+            while (end < order.count() && !present.contains(order.at(end)))
+                ++end;
+            beginInsertRows(QModelIndex(), i, end - 1);
+            for (int j = i; j < end; ++j) {
+                Row row;
+                row.path = order.at(j);
+                row.properties = m_target.value(row.path);
+                m_rows.insert(j, row);
+            }
+            endInsertRows();
+            i = end - 1;
+        }
+    }
+
+    // and finally the properties of the rows which were there already
+    for (int i = 0; i < m_rows.count(); ++i) {
+        Row &row = m_rows[i];
+        const QVariantMap &target = m_target.value(row.path);
+        QVector<int> roles;
+        for (int k = 0; k < m_keys.count(); ++k) {
+            const QString &key = m_keys.at(k);
+            if (row.properties.value(key) != target.value(key))
+                roles << FirstPropertyRole + k;
+        }
+        if (roles.isEmpty())
+            continue;
+        row.properties = target;
+        emit dataChanged(index(i), index(i), roles);
+    }
+    if (m_rows.count() != oldCount)
+        emit countChanged();
+}
+
+int ConnmanListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+QVariant ConnmanListModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_rows.count())
+        return QVariant();
+    const Row &row = m_rows.at(index.row());
+    if (role == PathRole)
+        return row.path;
+    const int key = role == Qt::DisplayRole ? m_keys.indexOf(QStringLiteral("Name")) : role - FirstPropertyRole;
+    if (key < 0 || key >= m_keys.count())
+        return QVariant();
+    return row.properties.value(m_keys.at(key));
+}
+
+QHash<int, QByteArray> ConnmanListModel::roleNames() const
+{
+    QHash<int, QByteArray> ret;
+    ret.insert(PathRole, "path");
+    for (int k = 0; k < m_keys.count(); ++k)
+        ret.insert(FirstPropertyRole + k, roleName(m_keys.at(k)));
+    return ret;
+}
+
+ConnmanTechnologyModel::ConnmanTechnologyModel(QObject *parent)
+    : ConnmanListModel(QStringList() << QStringLiteral("Name") << QStringLiteral("Type")
+                       << QStringLiteral("Powered") << QStringLiteral("Connected"), parent)
+{
+    connectPropertyChanged(TechnologyInterface);
+    bus().connect(Service, QStringLiteral("/"), ManagerInterface, QStringLiteral("TechnologyAdded"),
+                  this, SLOT(onTechnologyAdded(QDBusObjectPath,QVariantMap)));
+    bus().connect(Service, QStringLiteral("/"), ManagerInterface, QStringLiteral("TechnologyRemoved"),
+                  this, SLOT(onTechnologyRemoved(QDBusObjectPath)));
+}
+
+void ConnmanTechnologyModel::fetch()
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(Service, QStringLiteral("/"), ManagerInterface,
+                                                          QStringLiteral("GetTechnologies"));
+    QDBusPendingCallWatcher *w = new QDBusPendingCallWatcher(bus().asyncCall(message), this);
+    connect(w, &QDBusPendingCallWatcher::finished, this, &ConnmanTechnologyModel::onObjectListReply);
+}
+
+void ConnmanTechnologyModel::onTechnologyAdded(const QDBusObjectPath &path, const QVariantMap &properties)
+{
+    updateObject(path.path(), properties);
+}
+
+void ConnmanTechnologyModel::onTechnologyRemoved(const QDBusObjectPath &path)
+{
+    removeObject(path.path());
+}
+
+void ConnmanTechnologyModel::setPowered(const QString &path, bool powered)
+{
+    call(path, TechnologyInterface, QStringLiteral("SetProperty"),
+         QVariantList() << QStringLiteral("Powered") << QVariant::fromValue(QDBusVariant(powered)));
+}
+
+ConnmanServiceModel::ConnmanServiceModel(QObject *parent)
+    : ConnmanListModel(QStringList() << QStringLiteral("Name") << QStringLiteral("Type") << QStringLiteral("State")
+                       << QStringLiteral("Strength") << QStringLiteral("Security") << QStringLiteral("Favorite"), parent)
+{
+    connectPropertyChanged(ServiceInterface);
+    bus().connect(Service, QStringLiteral("/"), ManagerInterface, QStringLiteral("ServicesChanged"),
+                  this, SLOT(onServicesChanged(ConnmanObjectList,QList<QDBusObjectPath>)));
+}
+
+void ConnmanServiceModel::setType(const QString &type)
+{
+    if (m_type == type)
+        return;
+    m_type = type;
+    emit typeChanged();
+    sync();
+}
+
+void ConnmanServiceModel::fetch()
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(Service, QStringLiteral("/"), ManagerInterface,
+                                                          QStringLiteral("GetServices"));
+    QDBusPendingCallWatcher *w = new QDBusPendingCallWatcher(bus().asyncCall(message), this);
+    connect(w, &QDBusPendingCallWatcher::finished, this, &ConnmanServiceModel::onObjectListReply);
+}
+
+bool ConnmanServiceModel::accepts(const QVariantMap &properties) const
+{
+    return m_type.isEmpty() || properties.value(QStringLiteral("Type")).toString() == m_type;
+}
+
+void ConnmanServiceModel::onServicesChanged(const ConnmanObjectList &changed, const QList<QDBusObjectPath> &removed)
+{
+    // "changed" is the complete new order, with properties only for new and changed services
+    for (const QDBusObjectPath &path : removed)
+        m_target.remove(path.path());
+    setObjects(changed);
+}
+
+void ConnmanServiceModel::connectService(const QString &path)
+{
+    call(path, ServiceInterface, QStringLiteral("Connect"));
+}
+
+void ConnmanServiceModel::disconnectService(const QString &path)
+{
+    call(path, ServiceInterface, QStringLiteral("Disconnect"));
+}
+
+void ConnmanServiceModel::scan()
+{
+    if (!m_type.isEmpty())
+        call(QStringLiteral("/net/connman/technology/") + m_type, TechnologyInterface, QStringLiteral("Scan"));
+}
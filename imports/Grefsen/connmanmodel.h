@@ -0,0 +1,155 @@
+#ifndef CONNMANMODEL_H
+#define CONNMANMODEL_H
+
+#include <QAbstractListModel>
+#include <QDBusArgument>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QDBusServiceWatcher>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+class QDBusPendingCallWatcher;
+
+// an element of connman's a(oa{sv}) lists
+struct ConnmanObject
+{
+    QDBusObjectPath path;
+    QVariantMap properties;
+};
+Q_DECLARE_METATYPE(ConnmanObject)
+typedef QList<ConnmanObject> ConnmanObjectList;
+Q_DECLARE_METATYPE(ConnmanObjectList)
+
+QDBusArgument &operator<<(QDBusArgument &argument, const ConnmanObject &object);
+const QDBusArgument &operator>>(const QDBusArgument &argument, ConnmanObject &object);
+
+/*!
+    Base for list models of connman objects (technologies or services) on
+    the system bus.
+
+    All D-Bus calls are asynchronous.  Signals from connman only update the
+    target state: the order of the objects and their properties.  After a
+    burst of them has been quiet for SyncDelay ms, sync() brings the rows in
+    line with it using row-level remove, move and insert signals, and
+    dataChanged only for the roles which actually changed; so delegates are
+    neither rebuilt nor re-evaluated for nothing.
+
+    The roles are the connman property names with a lowercase initial
+    (name, powered, state...), plus path.
+*/
+class ConnmanListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool available READ available NOTIFY availableChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    ConnmanListModel(const QStringList &keys, QObject *parent = 0);
+
+    bool available() const { return m_available; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+signals:
+    void availableChanged();
+    void countChanged();
+
+protected slots:
+    void onServiceRegistered();
+    void onServiceUnregistered();
+    void onPropertyChanged(const QString &name, const QDBusVariant &value, const QDBusMessage &message);
+    void onObjectListReply(QDBusPendingCallWatcher *watcher);
+    void sync();
+
+protected:
+    enum { PathRole = Qt::UserRole + 1, FirstPropertyRole };
+
+    struct Row {
+        QString path;
+        QVariantMap properties;
+    };
+
+    // subclasses ask for their objects here, and connect to the signals which change the list
+    virtual void fetch() = 0;
+    virtual bool accepts(const QVariantMap &properties) const { Q_UNUSED(properties); return true; }
+
+    void connectPropertyChanged(const QString &interface);
+    void call(const QString &path, const QString &interface, const QString &method,
+              const QVariantList &args = QVariantList());
+    void setObjects(const ConnmanObjectList &objects);
+    void updateObject(const QString &path, const QVariantMap &properties);
+    void removeObject(const QString &path);
+    void scheduleSync() { m_syncTimer.start(); } // restarted: waits for the burst to end
+
+    static QDBusConnection bus();
+
+protected:
+    QStringList m_keys; // connman property names, in role order
+    QVector<Row> m_rows; // as presented
+    QStringList m_order; // the target state, as of the latest signals
+    QHash<QString, QVariantMap> m_target;
+    QDBusServiceWatcher m_watcher;
+    QTimer m_syncTimer;
+    bool m_available = false;
+};
+
+/*!
+    The network technologies (ethernet, wifi, bluetooth...) which connman
+    knows about.
+*/
+class ConnmanTechnologyModel : public ConnmanListModel
+{
+    Q_OBJECT
+public:
+    explicit ConnmanTechnologyModel(QObject *parent = 0);
+
+    Q_INVOKABLE void setPowered(const QString &path, bool powered);
+
+protected slots:
+    void onTechnologyAdded(const QDBusObjectPath &path, const QVariantMap &properties);
+    void onTechnologyRemoved(const QDBusObjectPath &path);
+
+protected:
+    void fetch() Q_DECL_OVERRIDE;
+};
+
+/*!
+    The services (networks) of one technology type, such as "wifi", in
+    connman's order: connected first, then by preference and strength.
+*/
+class ConnmanServiceModel : public ConnmanListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString type READ type WRITE setType NOTIFY typeChanged)
+
+public:
+    explicit ConnmanServiceModel(QObject *parent = 0);
+
+    QString type() const { return m_type; }
+    void setType(const QString &type);
+
+    Q_INVOKABLE void connectService(const QString &path);
+    Q_INVOKABLE void disconnectService(const QString &path);
+    Q_INVOKABLE void scan();
+
+signals:
+    void typeChanged();
+
+protected slots:
+    void onServicesChanged(const ConnmanObjectList &changed, const QList<QDBusObjectPath> &removed);
+
+protected:
+    void fetch() Q_DECL_OVERRIDE;
+    bool accepts(const QVariantMap &properties) const Q_DECL_OVERRIDE;
+
+protected:
+    QString m_type;
+};
+
+#endif // CONNMANMODEL_H
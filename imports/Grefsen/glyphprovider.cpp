@@ -0,0 +1,95 @@
+#include "glyphprovider.h"
+
+#include <QColor>
+#include <QDebug>
+#include <QFont>
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QPainter>
+#include <QRunnable>
+#include <QThreadPool>
+
+static const int DefaultPixelSize = 32;
+
+class GlyphJob : public QRunnable
+{
+public:
+    GlyphJob(GlyphProvider *provider, const QString &id, int pixelSize)
+      : m_provider(provider)
+      , m_id(id)
+      , m_pixelSize(pixelSize)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        m_provider->image(m_id, m_pixelSize);
+    }
+
+protected:
+    GlyphProvider *m_provider;
+    QString m_id;
+    int m_pixelSize;
+};
+
+GlyphProvider::GlyphProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image)
+{
+}
+
+QImage GlyphProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    const QImage ret = image(id, requestedSize.height() > 0 ? requestedSize.height() : DefaultPixelSize);
+    if (size)
+        *size = ret.size();
+    return ret;
+}
+
+void GlyphProvider::prewarm(const QString &id, int pixelSize)
+{
+    // otherwise fonts may only be used on the GUI thread
+    if (!QFontDatabase::supportsThreadedFontRendering())
+        return;
+    // the provider is owned by the engine, which outlives startup
+    QThreadPool::globalInstance()->start(new GlyphJob(this, id, pixelSize));
+}
+
+QImage GlyphProvider::image(const QString &id, int pixelSize)
+{
+    const QString key = id + QLatin1Char('@') + QString::number(pixelSize);
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_cache.constFind(key);
+        if (it != m_cache.constEnd())
+            return *it;
+    }
+    // rendering twice in a race is harmless, and cheaper than holding the lock meanwhile
+    const QImage ret = render(id, pixelSize);
+    QMutexLocker lock(&m_mutex);
+    m_cache.insert(key, ret);
+    return ret;
+}
+
+QImage GlyphProvider::render(const QString &id, int pixelSize)
+{
+    const int slash = id.indexOf(QLatin1Char('/'));
+    bool ok = false;
+    const uint code = id.left(slash).toUInt(&ok, 16);
+    if (!ok) {
+        qWarning() << "bad glyph id" << id;
+        return QImage();
+    }
+    const QColor color = slash < 0 ? QColor(Qt::black) : QColor(id.mid(slash + 1));
+    const QString text = QString::fromUcs4(&code, 1);
+
+    QFont font(QStringLiteral("FontAwesome"));
+    font.setPixelSize(pixelSize);
+    const QFontMetrics metrics(font);
+    QImage ret(qMax(1, metrics.width(text)), qMax(1, metrics.height()), QImage::Format_ARGB32_Premultiplied);
+    ret.fill(Qt::transparent);
+    QPainter painter(&ret);
+    painter.setFont(font);
+    painter.setPen(color);
+    painter.drawText(ret.rect(), Qt::AlignCenter, text);
+    return ret;
+}
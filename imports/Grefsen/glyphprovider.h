@@ -0,0 +1,49 @@
+#ifndef GLYPHPROVIDER_H
+#define GLYPHPROVIDER_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QQuickImageProvider>
+
+/*!
+    Icons from the bundled FontAwesome font, as images.
+
+    The id is the hexadecimal code point, optionally followed by a slash and
+    a color: "image://glyph/f00d/white".  The requested height is the pixel
+    size of the font (32 if none is given).  Images are cached, and
+    prewarm() renders glyphs on a pool thread during startup, so that the
+    first frame needs no glyph rasterization for them; and since Images
+    from a provider are shared through the pixmap cache, all outputs use the
+    same rendering.
+
+    The first font lookup in the process, whichever font it is for, makes
+    Qt populate its font database, and with fontconfig that lists every
+    installed font.  That can't be avoided, but when the first lookup is a
+    prewarm, the listing happens on the pool thread while the QML is loaded.
+
+    The Grefsen plugin registers one unless the application already has a
+    "glyph" provider; the compositor registers its own before loading its
+    QML, because Chrome uses it without importing the plugin.
+*/
+class GlyphProvider : public QQuickImageProvider
+{
+public:
+    GlyphProvider();
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) Q_DECL_OVERRIDE;
+
+    void prewarm(const QString &id, int pixelSize);
+
+protected:
+    friend class GlyphJob;
+
+    QImage image(const QString &id, int pixelSize);
+    static QImage render(const QString &id, int pixelSize);
+
+protected:
+    QMutex m_mutex; // guards m_cache
+    QHash<QString, QImage> m_cache;
+};
+
+#endif // GLYPHPROVIDER_H
@@ -0,0 +1,201 @@
+#include "iconcache.h"
+#include <qt5xdg/XdgIcon>
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QIcon>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static const int MemoryCacheKiB = 16 * 1024;
+static const int ThemeCheckInterval = 2000; // ms
+
+// QIcon::fromTheme goes through a global icon loader which is not thread-safe
+static QMutex themeMutex;
+
+static QImage scaledToFit(const QImage &image, const QSize &requestedSize)
+{
+    if (requestedSize.isValid() &&
+            (image.width() > requestedSize.width() || image.height() > requestedSize.height()))
+        return image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+IconCache::IconCache()
+  : m_memory(MemoryCacheKiB)
+  , m_diskDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+              QLatin1String("/grefsen/icons/"))
+  , m_usrSharePixmaps(QStringLiteral("/usr/share/pixmaps"))
+{
+    if (!QDir().mkpath(m_diskDir)) {
+        qWarning() << "failed to create icon cache directory" << m_diskDir;
+        m_diskDir.clear();
+    }
+}
+
+QImage IconCache::image(const QString &id, const QSize &requestedSize)
+{
+    const QString stamp = themeStamp();
+    const QString key = cacheKey(id, requestedSize, stamp);
+    {
+        QMutexLocker lock(&m_mutex);
+        if (QImage *cached = m_memory.object(key))
+            return *cached;
+    }
+
+    QString path = diskPath(key, stamp);
+    if (!path.isEmpty()) {
+        QImage ret(path);
+        if (!ret.isNull()) {
+            QMutexLocker lock(&m_mutex);
+            m_memory.insert(key, new QImage(ret), qMax(1, ret.byteCount() / 1024));
+            return ret;
+        }
+    }
+
+    // the default icon is not cached, so that newly installed icons are found;
+    // the miss is remembered by m_usrSharePixmaps instead
+    bool isDefault = false;
+    QImage ret = load(id, requestedSize, &isDefault);
+    if (!ret.isNull() && !isDefault)
+        insert(key, stamp, ret);
+    return ret;
+}
+
+static qint64 modified(const QString &path)
+{
+    const QFileInfo fi(path);
+    return fi.exists() ? fi.lastModified().toMSecsSinceEpoch() : 0;
+}
+
+/*!
+    Returns the name of the icon theme and the newest modification time of
+    its directories, and of hicolor's, which every theme falls back to.
+    Installing icons changes that, because gtk-update-icon-cache replaces
+    icon-theme.cache in the theme directory.  It is checked at most every
+    ThemeCheckInterval ms; when it changes, the remembered misses are
+    forgotten, since those icons might be found now.
+*/
+QString IconCache::themeStamp()
+{
+    QMutexLocker lock(&themeMutex);
+    if (m_themeChecked.isValid() && !m_themeChecked.hasExpired(ThemeCheckInterval))
+        return m_themeStamp;
+    m_themeChecked.start();
+    const QString theme = QIcon::themeName();
+    qint64 newest = 0;
+    for (const QString &dir : QIcon::themeSearchPaths()) {
+        newest = qMax(newest, modified(dir + QLatin1Char('/') + theme));
+        newest = qMax(newest, modified(dir + QLatin1String("/hicolor")));
+    }
+    const QString stamp = theme + QLatin1Char('@') + QString::number(newest);
+    if (stamp != m_themeStamp) {
+        if (!m_themeStamp.isEmpty())
+            m_usrSharePixmaps.clearMisses();
+        m_themeStamp = stamp;
+        pruneDiskCache(stamp);
+    }
+    return m_themeStamp;
+}
+
+QString IconCache::cacheKey(const QString &id, const QSize &requestedSize, const QString &stamp)
+{
+    QString ret = stamp + QLatin1Char('/') + QString::number(requestedSize.width()) +
+            QLatin1Char('x') + QString::number(requestedSize.height()) + QLatin1Char('/') + id;
+    // an absolute path can change under the same id, so the file's age is part of the key
+    if (id.startsWith('/'))
+        ret += QLatin1Char('@') + QString::number(QFileInfo(id).lastModified().toMSecsSinceEpoch());
+    return ret;
+}
+
+QString IconCache::stampDir(const QString &stamp) const
+{
+    if (m_diskDir.isEmpty())
+        return QString();
+    return m_diskDir + QString::fromLatin1(QCryptographicHash::hash(stamp.toUtf8(),
+            QCryptographicHash::Sha1).toHex().left(16)) + QLatin1Char('/');
+}
+
+QString IconCache::diskPath(const QString &key, const QString &stamp) const
+{
+    const QString dir = stampDir(stamp);
+    if (dir.isEmpty())
+        return QString();
+    return dir + QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(),
+            QCryptographicHash::Sha1).toHex()) + QLatin1String(".png");
+}
+
+/*!
+    Removes the cached images of other theme stamps, which would never be
+    used again, and the files which older versions wrote directly into the
+    cache directory.
+*/
+void IconCache::pruneDiskCache(const QString &stamp)
+{
+    const QString current = stampDir(stamp);
+    if (current.isEmpty())
+        return;
+    QDir dir(m_diskDir);
+    const QFileInfoList entries = dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    for (const QFileInfo &fi : entries) {
+        if (fi.isDir() && fi.absoluteFilePath() + QLatin1Char('/') == current)
+            continue;
+        const bool removed = fi.isDir() ? QDir(fi.absoluteFilePath()).removeRecursively() : dir.remove(fi.fileName());
+        if (!removed)
+            qWarning() << "failed to remove stale icon cache entry" << fi.absoluteFilePath();
+    }
+    if (!QDir().mkpath(current))
+        qWarning() << "failed to create icon cache directory" << current;
+}
+
+QImage IconCache::load(const QString &id, const QSize &requestedSize, bool *isDefault)
+{
+//qDebug() << id << requestedSize;
+    // absolute path: just load the image
+    if (id.startsWith('/'))
+        return scaledToFit(QImage(id), requestedSize);
+
+    QMutexLocker lock(&themeMutex);
+    const QString missKey = QIcon::themeName() + QLatin1Char('/') + id;
+    QIcon icon;
+    if (!m_usrSharePixmaps.isKnownMiss(missKey)) {
+        // main strategy: QIcon usually knows how to find it
+        icon = QIcon::fromTheme(id);
+//        icon = XdgIcon::fromTheme(id, XdgIcon::defaultApplicationIcon()); // often not working well
+        // fall back to /usr/share/pixmaps if nothing found yet
+        if (icon.isNull()) {
+            QString path = m_usrSharePixmaps.find(id);
+            if (!path.isEmpty())
+                return scaledToFit(QImage(path), requestedSize);
+            qWarning() << "failed to find icon" << id;
+            m_usrSharePixmaps.addMiss(missKey);
+        }
+    }
+    // default app icon if all else fails
+    if (icon.isNull()) {
+        icon = QIcon::fromTheme(XdgIcon::defaultApplicationIconName());
+        *isDefault = true;
+    }
+    QSize size = requestedSize;
+    if (!size.isValid()) {
+        const QList<QSize> available = icon.availableSizes();
+        size = available.isEmpty() ? QSize(64, 64) : available.last();
+    }
+    return icon.pixmap(size).toImage();
+}
+
+void IconCache::insert(const QString &key, const QString &stamp, const QImage &image)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_memory.insert(key, new QImage(image), qMax(1, image.byteCount() / 1024));
+    }
+    QString path = diskPath(key, stamp);
+    if (path.isEmpty())
+        return;
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || !image.save(&f, "PNG") || !f.commit())
+        qWarning() << "failed to write icon cache file" << path;
+}
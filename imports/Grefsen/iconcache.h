@@ -0,0 +1,54 @@
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+
+#include "pixmapindex.h"
+
+/*!
+    Thread-safe cache of icon images keyed on (icon id, theme, requested size).
+
+    Lookups are answered from memory if possible, then from the on-disk cache
+    in ~/.cache/grefsen/icons, and only then by going to the icon theme.
+    The theme is identified by its stamp, so that the images of a theme
+    which has been updated or replaced are not used; the disk cache keeps
+    only the directory of the current stamp, and the others are removed.
+    Results of theme lookups are written back to both.  Ids which are not
+    found anywhere are remembered, so that they don't cost a theme lookup
+    every time either; until the theme changes (see themeStamp()).
+
+    Must be constructed on the GUI thread, because of the file watching
+    done by PixmapIndex; image() may then be called from any thread.
+*/
+class IconCache
+{
+public:
+    IconCache();
+
+    QImage image(const QString &id, const QSize &requestedSize);
+
+protected:
+    QString themeStamp();
+    static QString cacheKey(const QString &id, const QSize &requestedSize, const QString &stamp);
+    QString stampDir(const QString &stamp) const;
+    QString diskPath(const QString &key, const QString &stamp) const;
+    void pruneDiskCache(const QString &stamp);
+    QImage load(const QString &id, const QSize &requestedSize, bool *isDefault);
+    void insert(const QString &key, const QString &stamp, const QImage &image);
+
+protected:
+    QMutex m_mutex; // guards m_memory
+    QCache<QString, QImage> m_memory;
+    QString m_diskDir;
+    PixmapIndex m_usrSharePixmaps;
+    // guarded by themeMutex
+    QString m_themeStamp;
+    QElapsedTimer m_themeChecked;
+};
+
+#endif // ICONCACHE_H
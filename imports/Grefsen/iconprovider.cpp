@@ -2,53 +2,50 @@
 #include <qt5xdg/XdgIcon>
 
 #include <QDebug>
-#include <QDir>
-#include <QDirIterator>
+#include <QRunnable>
+#include <QThread>
 
-static QDir UsrSharePixmaps("/usr/share/pixmaps");
+class IconResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    IconResponse(const QString &id, const QSize &requestedSize, IconCache *cache)
+      : m_id(id)
+      , m_requestedSize(requestedSize)
+      , m_cache(cache)
+    {
+        setAutoDelete(false);
+    }
+
+    QQuickTextureFactory *textureFactory() const Q_DECL_OVERRIDE
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        m_image = m_cache->image(m_id, m_requestedSize);
+        emit finished();
+    }
+
+protected:
+    QString m_id;
+    QSize m_requestedSize;
+    IconCache *m_cache;
+    QImage m_image;
+};
 
 IconProvider::IconProvider()
-  : QQuickImageProvider(QQuickImageProvider::Pixmap)
 {
     XdgIcon::setThemeName(QStringLiteral("oxygen")); // TODO make configurable
     qDebug() << "theme is" << QIcon::themeName() << "paths" << QIcon::themeSearchPaths()
              << "default icon" << XdgIcon::defaultApplicationIconName();
+    // theme lookups are serialized anyway; a few threads are enough to overlap the file I/O
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
 }
 
-QPixmap IconProvider::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
+QQuickImageResponse *IconProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
 {
-//qDebug() << id << requestedSize;
-    // absolute path: just load the image
-    if (id.startsWith('/')) {
-        QPixmap ret(id);
-        if (ret.width() > requestedSize.width() || ret.height() > requestedSize.height())
-            ret = ret.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        if (size)
-            *size = ret.size();
-        return ret;
-    }
-    // main strategy: QIcon usually knows how to find it
-    QIcon icon = QIcon::fromTheme(id);
-//    QIcon icon = XdgIcon::fromTheme(id, XdgIcon::defaultApplicationIcon()); // often not working well
-    // fall back to /usr/share/pixmaps if nothing found yet
-    if (icon.isNull()) {
-        QStringList p = UsrSharePixmaps.entryList({id + "*"}, QDir::Files);
-        if (!p.isEmpty()) {
-            QPixmap ret(UsrSharePixmaps.filePath(p.first()));
-            if (ret.width() > requestedSize.width() || ret.height() > requestedSize.height())
-                ret = ret.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-            if (size)
-                *size = ret.size();
-            return ret;
-        }
-    }
-    // default app icon if all else fails
-    if (icon.isNull()) {
-        qWarning() << "failed to find icon" << id;
-        icon = QIcon::fromTheme(XdgIcon::defaultApplicationIconName());
-    }
-    QPixmap ret = icon.pixmap(requestedSize);
-    if (size)
-        *size = ret.size();
-    return ret;
+    IconResponse *response = new IconResponse(id, requestedSize, &m_cache);
+    m_pool.start(response);
+    return response;
 }
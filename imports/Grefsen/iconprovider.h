@@ -1,17 +1,21 @@
 #ifndef ICONPROVIDER_H
 #define ICONPROVIDER_H
 
-#include <QQuickImageProvider>
-#include <QDir>
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
 
-class IconProvider : public QQuickImageProvider
+#include "iconcache.h"
+
+class IconProvider : public QQuickAsyncImageProvider
 {
 public:
     IconProvider();
 
-    QPixmap requestPixmap(const QString &id, QSize *size, const QSize &requestedSize) Q_DECL_OVERRIDE;
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) Q_DECL_OVERRIDE;
+
 protected:
-//    QDir m_usrSharePixmaps = QDir("/usr/share/pixmaps");
+    IconCache m_cache;
+    QThreadPool m_pool; // declared last so that it finishes pending work before m_cache goes away
 };
 
 #endif // ICONPROVIDER_H
@@ -0,0 +1,92 @@
+#include "launcherlistmodel.h"
+#include "launchermenumodel.h"
+
+#include <QSet>
+
+LauncherListModel::LauncherListModel(LauncherMenuModel *source, QObject *parent)
+  : QAbstractListModel(parent)
+  , m_source(source)
+{
+    connect(source, &QAbstractItemModel::dataChanged, this, &LauncherListModel::onSourceDataChanged);
+}
+
+void LauncherListModel::setRows(const QVector<int> &ids)
+{
+    QSet<int> wanted;
+    wanted.reserve(ids.count());
+    for (int id : ids)
+        wanted.insert(id);
+
+    // remove what is no longer wanted, in contiguous runs, from the end
+    for (int i = m_rows.count() - 1; i >= 0; --i) {
+        if (wanted.contains(m_rows.at(i)))
+            continue;
+        const int last = i;
+        while (i > 0 && !wanted.contains(m_rows.at(i - 1)))
+            --i;
+        beginRemoveRows(QModelIndex(), i, last);
+        m_rows.remove(i, last - i + 1);
+        endRemoveRows();
+    }
+
+    // what remains is a subset of ids: move it into order and insert the rest
+    QSet<int> present;
+    present.reserve(m_rows.count());
+    for (int id : qAsConst(m_rows))
+        present.insert(id);
+    for (int i = 0; i < ids.count(); ++i) {
+        const int id = ids.at(i);
+        if (i < m_rows.count() && m_rows.at(i) == id)
+            continue;
+        if (present.contains(id)) {
+            const int from = m_rows.indexOf(id, i + 1);
+            Q_ASSERT(from > i);
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+            m_rows.move(from, i);
+            endMoveRows();
+        } else {
+            int end = i + 1;
+            while (end < ids.count() && !present.contains(ids.at(end)))
+                ++end;
+            beginInsertRows(QModelIndex(), i, end - 1);
+            for (int j = i; j < end; ++j)
+                m_rows.insert(j, ids.at(j));
+            endInsertRows();
+            i = end - 1;
+        }
+    }
+    Q_ASSERT(m_rows == ids);
+
+    m_rowOf.clear();
+    m_rowOf.reserve(m_rows.count());
+    for (int row = 0; row < m_rows.count(); ++row)
+        m_rowOf.insert(m_rows.at(row), row);
+}
+
+void LauncherListModel::onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    const QModelIndex parent = topLeft.parent();
+    for (int sourceRow = topLeft.row(); sourceRow <= bottomRight.row(); ++sourceRow) {
+        const int row = m_rowOf.value(int(m_source->index(sourceRow, 0, parent).internalId()), -1);
+        if (row >= 0)
+            emit dataChanged(index(row), index(row));
+    }
+}
+
+int LauncherListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+QVariant LauncherListModel::data(const QModelIndex &index, int role) const
+{
+    const int id = idAt(index.row());
+    if (id < 0)
+        return QVariant();
+    return LauncherMenuModel::entryData(m_source->entry(id), role);
+}
+
+QHash<int, QByteArray> LauncherListModel::roleNames() const
+{
+    return LauncherMenuModel::entryRoleNames();
+}
@@ -0,0 +1,41 @@
+#ifndef LAUNCHERLISTMODEL_H
+#define LAUNCHERLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVector>
+
+class LauncherMenuModel;
+
+/*!
+    Flat view onto a list of entries of a LauncherMenuModel: the contents of
+    one submenu, or the results of a search.
+
+    setRows() compares the new list with the current one and emits
+    row-level remove, move and insert signals, rather than resetting, so
+    that a ListView keeps the delegates of the rows which stay.
+*/
+class LauncherListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit LauncherListModel(LauncherMenuModel *source, QObject *parent = 0);
+
+    void setRows(const QVector<int> &ids);
+    const QVector<int> &rows() const { return m_rows; }
+    int idAt(int row) const { return row >= 0 && row < m_rows.count() ? m_rows.at(row) : -1; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+protected slots:
+    void onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+protected:
+    LauncherMenuModel *m_source;
+    QVector<int> m_rows; // entry ids
+    QHash<int, int> m_rowOf; // entry id -> row in m_rows
+};
+
+#endif // LAUNCHERLISTMODEL_H
@@ -0,0 +1,306 @@
+#include "launchermenuloader.h"
+#include "tracescope.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <XmlHelper>
+#include <XdgDesktopFile>
+#include <XdgDirs>
+#include <XdgMenu>
+
+static const quint32 CacheMagic = 0x47524d43; // "GRMC"
+static const quint32 CacheVersion = 3;
+
+QDataStream &operator<<(QDataStream &out, const LauncherEntry &e)
+{
+    return out << e.title << e.icon << e.exec << e.desktopFile << e.genericName << e.keywords
+               << e.modified << e.placement << qint32(e.parent) << qint32(e.row) << e.isMenu << e.children;
+}
+
+QDataStream &operator>>(QDataStream &in, LauncherEntry &e)
+{
+    qint32 parent, row;
+    in >> e.title >> e.icon >> e.exec >> e.desktopFile >> e.genericName >> e.keywords
+       >> e.modified >> e.placement >> parent >> row >> e.isMenu >> e.children;
+    e.parent = parent;
+    e.row = row;
+    return in;
+}
+
+LauncherMenuLoader::LauncherMenuLoader(const QVector<LauncherEntry> &previous)
+{
+    for (const LauncherEntry &e : previous)
+        if (!e.isMenu && !e.desktopFile.isEmpty())
+            m_previous.insert(e.desktopFile, &e);
+}
+
+QVector<LauncherEntry> LauncherMenuLoader::load(const QVector<LauncherEntry> &previous)
+{
+    TraceScope trace("read XDG menu");
+    QElapsedTimer timer;
+    timer.start();
+    QString menuFile = XdgMenu::getMenuFileName();
+    QByteArray key = cacheKey(menuFile);
+    QVector<LauncherEntry> ret;
+    // a .desktop file can be modified in place without any directory changing,
+    // so the cache can't be trusted if we are reloading because of a change
+    if (previous.isEmpty() && readCache(key, ret)) {
+        bool changed = false;
+        if (refresh(ret, QSet<QString>(), &changed)) {
+            if (changed)
+                writeCache(key, ret);
+            qDebug() << "read menu cache:" << ret.count() << "entries in" << timer.elapsed() << "ms";
+            return ret;
+        }
+        ret.clear();
+    }
+    LauncherMenuLoader loader(previous);
+    ret = loader.parse(menuFile);
+    writeCache(key, ret);
+    qDebug() << "parsed menu:" << ret.count() << "entries in" << timer.elapsed() << "ms";
+    return ret;
+}
+
+QVector<LauncherEntry> LauncherMenuLoader::update(const QVector<LauncherEntry> &previous, const QSet<QString> &desktopFiles)
+{
+    TraceScope trace("update XDG menu");
+    QVector<LauncherEntry> ret = previous;
+    bool changed = false;
+    if (!refresh(ret, desktopFiles, &changed))
+        return load(previous);
+    if (changed)
+        writeCache(cacheKey(XdgMenu::getMenuFileName()), ret);
+    return ret;
+}
+
+/*!
+    Reads the .desktop files of the applications in \a entries again, if
+    they were modified since \a entries were read; all of them, or only
+    those in \a desktopFiles if that is not empty.  Returns false if one of
+    them has been removed, renamed or given other categories (or the like),
+    because then the whole menu has to be read to find where it goes now.
+*/
+bool LauncherMenuLoader::refresh(QVector<LauncherEntry> &entries, const QSet<QString> &desktopFiles, bool *changed)
+{
+    QHash<QString, qint64> modified; // an application may be in several menus
+    for (LauncherEntry &e : entries) {
+        if (e.isMenu || e.desktopFile.isEmpty())
+            continue;
+        if (!desktopFiles.isEmpty() && !desktopFiles.contains(e.desktopFile))
+            continue;
+        auto it = modified.find(e.desktopFile);
+        if (it == modified.end()) {
+            const QFileInfo fi(e.desktopFile);
+            it = modified.insert(e.desktopFile, fi.exists() ? fi.lastModified().toMSecsSinceEpoch() : -1);
+        }
+        if (it.value() == e.modified)
+            continue;
+        LauncherEntry updated = e;
+        // menus are sorted by title
+        if (it.value() < 0 || !readDesktopFile(updated, it.value()) ||
+                updated.title != e.title || updated.placement != e.placement)
+            return false;
+        e = updated;
+        *changed = true;
+    }
+    return true;
+}
+
+QVector<LauncherEntry> LauncherMenuLoader::parse(const QString &menuFile)
+{
+    XdgMenu xdgMenu;
+    xdgMenu.setEnvironments(QStringList() << "X-GREFSEN" << "Grefsen");  // TODO what's that for?
+//    xdgMenu.setEnvironments(QStringList() << "X-LXQT" << "LXQt");
+    bool res = xdgMenu.read(menuFile);
+    if (!res)
+        qWarning() << "Parse error" << xdgMenu.errorString();
+    QDomElement dom = xdgMenu.xml().documentElement();
+    qDebug() << "read XML:" << menuFile << xdgMenu.menuFileName() << dom.tagName();
+
+    m_entries.resize(1);
+    m_entries[LauncherMenuModel::RootId].isMenu = true;
+    build(LauncherMenuModel::RootId, dom);
+    return m_entries;
+}
+
+void LauncherMenuLoader::build(int menuId, const QDomElement &xml)
+{
+    DomElementIterator it(xml, QString());
+    while(it.hasNext())
+    {
+        QDomElement xml = it.next();
+
+        if (xml.tagName() == "Menu")
+            build(appendEntry(menuId, xml, true), xml);
+
+        else if (xml.tagName() == "AppLink")
+            appendEntry(menuId, xml, false);
+
+        else if (xml.tagName() == "Separator")
+            qDebug() << "separator";
+    }
+}
+
+int LauncherMenuLoader::appendEntry(int menuId, const QDomElement &xml, bool isMenu)
+{
+    LauncherEntry e;
+    e.title = xml.attribute(QStringLiteral("title"));
+    e.icon = xml.attribute(QStringLiteral("icon"));
+    e.isMenu = isMenu;
+    if (!isMenu) {
+        e.desktopFile = xml.attribute(QStringLiteral("desktopFile"));
+        e.modified = QFileInfo(e.desktopFile).lastModified().toMSecsSinceEpoch();
+        const LauncherEntry *prev = m_previous.value(e.desktopFile);
+        if (prev && prev->modified == e.modified) {
+            e = *prev;
+            e.children.clear();
+        } else if (!prev || !readDesktopFile(e, e.modified)) {
+            e.exec = xml.attribute(QStringLiteral("exec"));
+            e.genericName = xml.attribute(QStringLiteral("genericName"));
+            XdgDesktopFile* dtf = XdgDesktopFileCache::getFile(e.desktopFile);
+            if (dtf) {
+                e.keywords = dtf->localizedValue(QStringLiteral("Keywords")).toString().split(QLatin1Char(';'), QString::SkipEmptyParts);
+                e.placement = placementOf(*dtf);
+            }
+        }
+    }
+    e.parent = menuId;
+    e.row = m_entries.at(menuId).children.count();
+//    qDebug() << m_entries.at(menuId).title << ":" << e.title << e.icon << e.row;
+    const int id = m_entries.count();
+    m_entries.append(e);
+    m_entries[menuId].children.append(id);
+    return id;
+}
+
+/*!
+    Reads the details of \a e from its .desktop file directly, since
+    XdgDesktopFileCache (and thus the menu XML) keeps returning what the file
+    contained when it was first read.
+*/
+bool LauncherMenuLoader::readDesktopFile(LauncherEntry &e, qint64 modified)
+{
+    XdgDesktopFile dtf;
+    if (!dtf.load(e.desktopFile))
+        return false;
+    e.title = dtf.localizedValue(QStringLiteral("Name")).toString();
+    e.icon = dtf.value(QStringLiteral("Icon")).toString();
+    e.exec = dtf.value(QStringLiteral("Exec")).toString();
+    e.genericName = dtf.localizedValue(QStringLiteral("GenericName")).toString();
+    e.keywords = dtf.localizedValue(QStringLiteral("Keywords")).toString().split(QLatin1Char(';'), QString::SkipEmptyParts);
+    e.placement = placementOf(dtf);
+    e.modified = modified;
+    return true;
+}
+
+// the keys by which the menu's rules include an application, and where
+QByteArray LauncherMenuLoader::placementOf(const XdgDesktopFile &dtf)
+{
+    static const char *const keys[] = { "Categories", "NoDisplay", "Hidden", "OnlyShowIn", "NotShowIn", "TryExec" };
+    QByteArray ret;
+    for (const char *key : keys) {
+        ret += dtf.value(QLatin1String(key)).toString().toUtf8();
+        ret += '\n';
+    }
+    return ret;
+}
+
+/*!
+    Returns the existing files and directories whose changes can affect the
+    menu: the menu file, the menu fragment directories, and the directories
+    (and immediate subdirectories) containing .desktop files.
+*/
+QStringList LauncherMenuLoader::watchedPaths()
+{
+    QStringList dirs;
+    const QStringList dataDirs = QStringList() << XdgDirs::dataHome(false) << XdgDirs::dataDirs();
+    for (const QString &d : dataDirs)
+        dirs << d + QLatin1String("/applications");
+    const QStringList configDirs = QStringList() << XdgDirs::configHome(false) << XdgDirs::configDirs();
+    for (const QString &d : configDirs)
+        dirs << d + QLatin1String("/menus") << d + QLatin1String("/menus/applications-merged");
+
+    QStringList ret;
+    if (QFileInfo::exists(XdgMenu::getMenuFileName()))
+        ret << XdgMenu::getMenuFileName();
+    for (const QString &d : qAsConst(dirs)) {
+        QDir dir(d);
+        if (!dir.exists())
+            continue;
+        ret << d;
+        // some packages put their .desktop files in subdirectories such as applications/kde4
+        const QStringList subdirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QString &s : subdirs)
+            ret << dir.filePath(s);
+    }
+    return ret;
+}
+
+QString LauncherMenuLoader::cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+            QLatin1String("/grefsen/menu.cache");
+}
+
+QByteArray LauncherMenuLoader::cacheKey(const QString &menuFile)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QLocale::system().name().toUtf8()); // titles are localized
+    hash.addData(qgetenv("XDG_MENU_PREFIX"));
+    hash.addData(menuFile.toUtf8());
+    // adding or removing a .desktop file changes the mtime of its directory
+    const QStringList paths = watchedPaths();
+    for (const QString &path : paths) {
+        hash.addData(path.toUtf8());
+        hash.addData(QByteArray::number(QFileInfo(path).lastModified().toMSecsSinceEpoch()));
+    }
+    return hash.result();
+}
+
+bool LauncherMenuLoader::readCache(const QByteArray &key, QVector<LauncherEntry> &entries)
+{
+    QFile f(cachePath());
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    uchar *mapped = f.map(0, f.size());
+    if (!mapped)
+        return false;
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), int(f.size()));
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_6);
+    quint32 magic, version;
+    QByteArray storedKey;
+    in >> magic >> version >> storedKey;
+    if (magic != CacheMagic || version != CacheVersion || storedKey != key)
+        return false;
+    in >> entries;
+    if (in.status() != QDataStream::Ok || entries.isEmpty() || !entries.first().isMenu) {
+        qWarning() << "ignoring corrupt menu cache" << f.fileName();
+        entries.clear();
+        return false;
+    }
+    return true;
+}
+
+void LauncherMenuLoader::writeCache(const QByteArray &key, const QVector<LauncherEntry> &entries)
+{
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "failed to write menu cache" << path << f.errorString();
+        return;
+    }
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << CacheMagic << CacheVersion << key << entries;
+    if (!f.commit())
+        qWarning() << "failed to write menu cache" << path << f.errorString();
+}
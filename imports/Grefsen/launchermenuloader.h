@@ -0,0 +1,62 @@
+#ifndef LAUNCHERMENULOADER_H
+#define LAUNCHERMENULOADER_H
+
+#include <QDomElement>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include "launchermenumodel.h"
+
+class XdgDesktopFile;
+
+/*!
+    Reads the XDG application menu into the flat entry list which
+    LauncherMenuModel uses.  Intended to be run on a worker thread.
+
+    The resolved menu is saved in a compact binary cache file in
+    ~/.cache/grefsen, keyed on the modification times of the menu file and
+    of the directories containing .desktop files and menu fragments; as long
+    as none of those change, load() just maps the cache file, without
+    parsing any XML or .desktop files.
+
+    Editing a .desktop file in place changes no directory, so the
+    applications read from the cache are checked against the modification
+    times of their files, and those which changed are read again.
+
+    When a previous result is given (because something changed on disk),
+    the menu is always read again, but the details of each application are
+    taken over from the previous entry unless its .desktop file was modified
+    in the meantime.  update() is for when only .desktop files changed: it
+    reads just those, and reads the whole menu only if one of them has to
+    go elsewhere in it (or nowhere).
+*/
+class LauncherMenuLoader
+{
+public:
+    static QVector<LauncherEntry> load(const QVector<LauncherEntry> &previous);
+    static QVector<LauncherEntry> update(const QVector<LauncherEntry> &previous, const QSet<QString> &desktopFiles);
+    static QStringList watchedPaths();
+
+protected:
+    explicit LauncherMenuLoader(const QVector<LauncherEntry> &previous);
+
+    QVector<LauncherEntry> parse(const QString &menuFile);
+    void build(int menuId, const QDomElement &xml);
+    int appendEntry(int menuId, const QDomElement &xml, bool isMenu);
+    static bool readDesktopFile(LauncherEntry &e, qint64 modified);
+    static QByteArray placementOf(const XdgDesktopFile &dtf);
+    static bool refresh(QVector<LauncherEntry> &entries, const QSet<QString> &desktopFiles, bool *changed);
+
+    static QString cachePath();
+    static QByteArray cacheKey(const QString &menuFile);
+    static bool readCache(const QByteArray &key, QVector<LauncherEntry> &entries);
+    static void writeCache(const QByteArray &key, const QVector<LauncherEntry> &entries);
+
+protected:
+    QVector<LauncherEntry> m_entries;
+    QHash<QString, const LauncherEntry *> m_previous; // by desktop file path
+};
+
+#endif // LAUNCHERMENULOADER_H
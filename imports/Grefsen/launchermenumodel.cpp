@@ -0,0 +1,253 @@
+#include "launchermenumodel.h"
+
+#include <QSet>
+
+static QString entryKey(const LauncherEntry &e)
+{
+    return e.isMenu ? QLatin1String("m:") + e.title : QLatin1String("a:") + e.desktopFile;
+}
+
+static bool sameContent(const LauncherEntry &a, const LauncherEntry &b)
+{
+    return a.title == b.title && a.icon == b.icon && a.exec == b.exec &&
+            a.desktopFile == b.desktopFile && a.genericName == b.genericName &&
+            a.keywords == b.keywords && a.modified == b.modified;
+}
+
+static void copyContent(LauncherEntry &to, const LauncherEntry &from)
+{
+    to.title = from.title;
+    to.icon = from.icon;
+    to.exec = from.exec;
+    to.desktopFile = from.desktopFile;
+    to.genericName = from.genericName;
+    to.keywords = from.keywords;
+    to.modified = from.modified;
+    to.placement = from.placement;
+    to.isMenu = from.isMenu;
+}
+
+LauncherMenuModel::LauncherMenuModel(QObject *parent)
+  : QAbstractItemModel(parent)
+{
+    m_entries.resize(1); // the root
+    m_entries[RootId].isMenu = true;
+}
+
+void LauncherMenuModel::setEntries(const QVector<LauncherEntry> &entries)
+{
+    Q_ASSERT(!entries.isEmpty() && entries.first().isMenu);
+    beginResetModel();
+    m_entries = entries;
+    m_freeIds.clear();
+    m_pendingFreeIds.clear();
+    endResetModel();
+}
+
+LauncherMenuModel::Changes LauncherMenuModel::applyEntries(const QVector<LauncherEntry> &entries)
+{
+    Q_ASSERT(!entries.isEmpty() && entries.first().isMenu);
+    Changes ret;
+    m_freeIds += m_pendingFreeIds;
+    m_pendingFreeIds.clear();
+    syncMenu(RootId, entries, RootId, ret);
+    return ret;
+}
+
+void LauncherMenuModel::syncMenu(int id, const QVector<LauncherEntry> &fresh, int freshId, Changes &changes)
+{
+    const QModelIndex parentIndex = indexOf(id);
+    const QVector<int> freshChildren = fresh.at(freshId).children;
+    QSet<QString> wanted;
+    for (int f : freshChildren)
+        wanted.insert(entryKey(fresh.at(f)));
+
+    // remove what has disappeared, in contiguous runs, from the end
+    for (int i = m_entries.at(id).children.count() - 1; i >= 0; --i) {
+        if (wanted.contains(entryKey(m_entries.at(m_entries.at(id).children.at(i)))))
+            continue;
+        const int last = i;
+        while (i > 0 && !wanted.contains(entryKey(m_entries.at(m_entries.at(id).children.at(i - 1)))))
+            --i;
+        beginRemoveRows(parentIndex, i, last);
+        const QVector<int> removed = m_entries.at(id).children.mid(i, last - i + 1);
+        m_entries[id].children.remove(i, last - i + 1);
+        renumber(id, i);
+        endRemoveRows();
+        for (int r : removed)
+            releaseSubtree(r, changes);
+    }
+
+    // bring the remaining ones into the new order, update them, and insert new ones
+    for (int i = 0; i < freshChildren.count(); ++i) {
+        const LauncherEntry &f = fresh.at(freshChildren.at(i));
+        const QString key = entryKey(f);
+        int from = -1;
+        for (int j = i; j < m_entries.at(id).children.count() && from < 0; ++j)
+            if (entryKey(m_entries.at(m_entries.at(id).children.at(j))) == key)
+                from = j;
+        if (from < 0) {
+            beginInsertRows(parentIndex, i, i);
+            const int newId = copySubtree(fresh, freshChildren.at(i), id, i, changes);
+            m_entries[id].children.insert(i, newId);
+            renumber(id, i);
+            endInsertRows();
+            continue;
+        }
+        if (from != i) {
+            beginMoveRows(parentIndex, from, from, parentIndex, i);
+            m_entries[id].children.move(from, i);
+            renumber(id, i);
+            endMoveRows();
+        }
+        const int childId = m_entries.at(id).children.at(i);
+        if (!sameContent(m_entries.at(childId), f)) {
+            copyContent(m_entries[childId], f);
+            const QModelIndex idx = createIndex(i, 0, quintptr(childId));
+            emit dataChanged(idx, idx);
+            if (!f.isMenu)
+                changes.updated.append(childId);
+        }
+        if (f.isMenu)
+            syncMenu(childId, fresh, freshChildren.at(i), changes);
+    }
+
+    // duplicates which are left over at the end
+    const int extra = m_entries.at(id).children.count() - freshChildren.count();
+    if (extra > 0) {
+        beginRemoveRows(parentIndex, freshChildren.count(), freshChildren.count() + extra - 1);
+        const QVector<int> removed = m_entries.at(id).children.mid(freshChildren.count());
+        m_entries[id].children.resize(freshChildren.count());
+        endRemoveRows();
+        for (int r : removed)
+            releaseSubtree(r, changes);
+    }
+}
+
+int LauncherMenuModel::copySubtree(const QVector<LauncherEntry> &fresh, int freshId, int parentId, int row, Changes &changes)
+{
+    int id;
+    if (m_freeIds.isEmpty()) {
+        id = m_entries.count();
+        m_entries.append(LauncherEntry());
+    } else {
+        id = m_freeIds.takeLast();
+    }
+    const LauncherEntry &f = fresh.at(freshId);
+    copyContent(m_entries[id], f);
+    m_entries[id].parent = parentId;
+    m_entries[id].row = row;
+    if (f.isMenu) {
+        const QVector<int> freshChildren = f.children;
+        for (int i = 0; i < freshChildren.count(); ++i) {
+            const int childId = copySubtree(fresh, freshChildren.at(i), id, i, changes);
+            m_entries[id].children.append(childId);
+        }
+    } else {
+        changes.inserted.append(id);
+    }
+    return id;
+}
+
+/*!
+    Clears the given entry and its descendants and remembers the slots for
+    reuse.  Reuse only happens during the next applyEntries(): until then,
+    views which still refer to a removed id by mistake see an empty entry
+    rather than a different one.
+*/
+void LauncherMenuModel::releaseSubtree(int id, Changes &changes)
+{
+    const QVector<int> children = m_entries.at(id).children;
+    for (int c : children)
+        releaseSubtree(c, changes);
+    if (!m_entries.at(id).isMenu)
+        changes.removed.append(id);
+    m_entries[id] = LauncherEntry();
+    m_entries[id].parent = -2;
+    m_pendingFreeIds.append(id);
+}
+
+void LauncherMenuModel::renumber(int menuId, int from)
+{
+    const QVector<int> children = m_entries.at(menuId).children;
+    for (int i = from; i < children.count(); ++i)
+        m_entries[children.at(i)].row = i;
+}
+
+QModelIndex LauncherMenuModel::indexOf(int id) const
+{
+    if (id <= RootId || id >= m_entries.count())
+        return QModelIndex();
+    return createIndex(m_entries.at(id).row, 0, quintptr(id));
+}
+
+QVariant LauncherMenuModel::entryData(const LauncherEntry &entry, int role)
+{
+    switch (role) {
+    case Qt::DisplayRole:
+    case TitleRole:
+        return entry.title;
+    case IconRole:
+        return entry.icon;
+    case ExecRole:
+        return entry.exec;
+    case DesktopFileRole:
+        return entry.desktopFile;
+    case IsMenuRole:
+        return entry.isMenu;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> LauncherMenuModel::entryRoleNames()
+{
+    QHash<int, QByteArray> ret;
+    ret.insert(TitleRole, "title");
+    ret.insert(IconRole, "icon");
+    ret.insert(ExecRole, "exec");
+    ret.insert(DesktopFileRole, "desktopFile");
+    ret.insert(IsMenuRole, "isMenu");
+    return ret;
+}
+
+QModelIndex LauncherMenuModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column != 0 || row < 0)
+        return QModelIndex();
+    const LauncherEntry &p = m_entries.at(idOf(parent));
+    if (row >= p.children.count())
+        return QModelIndex();
+    return createIndex(row, 0, quintptr(p.children.at(row)));
+}
+
+QModelIndex LauncherMenuModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid())
+        return QModelIndex();
+    return indexOf(m_entries.at(idOf(child)).parent);
+}
+
+int LauncherMenuModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+    return m_entries.at(idOf(parent)).children.count();
+}
+
+int LauncherMenuModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 1;
+}
+
+QVariant LauncherMenuModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+    return entryData(m_entries.at(idOf(index)), role);
+}
+
+QHash<int, QByteArray> LauncherMenuModel::roleNames() const
+{
+    return entryRoleNames();
+}
@@ -0,0 +1,89 @@
+#ifndef LAUNCHERMENUMODEL_H
+#define LAUNCHERMENUMODEL_H
+
+#include <QAbstractItemModel>
+#include <QStringList>
+#include <QVector>
+
+struct LauncherEntry
+{
+    QString title;
+    QString icon;
+    QString exec;
+    QString desktopFile;
+    QString genericName;
+    QStringList keywords;
+    qint64 modified = 0;   // of the desktop file, in ms since the epoch
+    QByteArray placement;  // the desktop file keys which decide where in the menu it goes, if at all
+    int parent = -1;       // id of the containing menu; -1 only for the root
+    int row = 0;           // position within the parent's children
+    bool isMenu = false;
+    QVector<int> children; // ids of the entries in this menu
+};
+
+/*!
+    The XDG application menu as a tree model.
+
+    All entries are stored in one vector and referred to by their index in it
+    (the entry id); entry 0 is the invisible root menu.  The internal id of
+    each QModelIndex is the entry id, so that lookups don't need any
+    searching.
+
+    applyEntries() merges a freshly loaded menu into the existing one: menus
+    are matched by title and applications by desktop file, so that ids of
+    unchanged entries stay valid, and only the rows which were really
+    added, removed, moved or modified are signalled.
+*/
+class LauncherMenuModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        TitleRole = Qt::UserRole + 1,
+        IconRole,
+        ExecRole,
+        DesktopFileRole,
+        IsMenuRole
+    };
+    static const int RootId = 0;
+
+    explicit LauncherMenuModel(QObject *parent = 0);
+
+    struct Changes {
+        QVector<int> inserted; // ids of applications
+        QVector<int> removed;
+        QVector<int> updated;
+    };
+
+    void setEntries(const QVector<LauncherEntry> &entries);
+    Changes applyEntries(const QVector<LauncherEntry> &entries);
+    const QVector<LauncherEntry> &entries() const { return m_entries; }
+    const LauncherEntry &entry(int id) const { return m_entries.at(id); }
+    bool isValidId(int id) const { return id >= 0 && id < m_entries.count() && (id == RootId || m_entries.at(id).parent >= 0); }
+    int entryCount() const { return m_entries.count(); }
+    QModelIndex indexOf(int id) const;
+
+    static QVariant entryData(const LauncherEntry &entry, int role);
+    static QHash<int, QByteArray> entryRoleNames();
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QModelIndex parent(const QModelIndex &child) const Q_DECL_OVERRIDE;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+protected:
+    int idOf(const QModelIndex &index) const { return index.isValid() ? int(index.internalId()) : RootId; }
+    void syncMenu(int id, const QVector<LauncherEntry> &fresh, int freshId, Changes &changes);
+    int copySubtree(const QVector<LauncherEntry> &fresh, int freshId, int parentId, int row, Changes &changes);
+    void releaseSubtree(int id, Changes &changes);
+    void renumber(int menuId, int from);
+
+protected:
+    QVector<LauncherEntry> m_entries;
+    QVector<int> m_freeIds; // slots of removed entries
+    QVector<int> m_pendingFreeIds; // removed during the last applyEntries()
+};
+
+#endif // LAUNCHERMENUMODEL_H
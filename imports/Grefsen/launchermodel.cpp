@@ -1,29 +1,42 @@
 #include "launchermodel.h"
+#include "launchermenuloader.h"
 #include <QDebug>
-#include <QJSEngine>
-#include <XmlHelper>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QtConcurrent>
 #include <XdgDesktopFile>
-#include <XdgMenu>
 
-LauncherModel::LauncherModel(QJSEngine *engine, QObject *parent)
+// package managers touch many files in a row: wait for them to finish
+static const int ReloadDelay = 2000;
+
+// for Terminal=true: $TERMINAL, or the first of the usual ones; all of them take -e
+static QString terminalProgram()
+{
+    const QString terminal = QString::fromLocal8Bit(qgetenv("TERMINAL"));
+    if (!terminal.isEmpty())
+        return terminal;
+    static const char *const candidates[] = { "x-terminal-emulator", "foot", "qterminal", "konsole", "gnome-terminal", "xterm" };
+    for (const char *candidate : candidates) {
+        const QString path = QStandardPaths::findExecutable(QLatin1String(candidate));
+        if (!path.isEmpty())
+            return path;
+    }
+    return QString();
+}
+
+LauncherModel::LauncherModel(QObject *parent)
   : QObject(parent)
-  , m_engine(engine)
-  , m_root(engine->newObject())
-  , m_allApps(engine->newArray())
+  , m_listModel(&m_menuModel)
 {
-    QString menuFile = XdgMenu::getMenuFileName();
-    XdgMenu xdgMenu;
-    xdgMenu.setLogDir("/tmp");
-    xdgMenu.setEnvironments(QStringList() << "X-GREFSEN" << "Grefsen");  // TODO what's that for?
-//    xdgMenu.setEnvironments(QStringList() << "X-LXQT" << "LXQt");
-    bool res = xdgMenu.read(menuFile);
-    if (!res)
-        qWarning() << "Parse error" << xdgMenu.errorString();
-    m_dom = xdgMenu.xml().documentElement();
-    qDebug() << "read XML:" << menuFile << xdgMenu.menuFileName() << m_dom.tagName();
-
-    build(m_root, m_dom);
-    m_list = m_root;
+    // reading the menu and all the .desktop files takes a while: don't block the first frame
+    connect(&m_loadWatcher, &QFutureWatcherBase::finished, this, &LauncherModel::onMenuLoaded);
+    m_loadWatcher.setFuture(QtConcurrent::run(&LauncherMenuLoader::load, QVector<LauncherEntry>()));
+
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(ReloadDelay);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &LauncherModel::reload);
+    connect(&m_fileWatcher, &QFileSystemWatcher::directoryChanged, this, &LauncherModel::onDirectoryChanged);
+    connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged, this, &LauncherModel::onFileChanged);
 }
 
 void LauncherModel::setSubstringFilter(QString substringFilter)
@@ -38,117 +51,178 @@ void LauncherModel::setSubstringFilter(QString substringFilter)
         reset();
         return;
     }
-    m_list = m_engine->newObject();
-    m_list.setProperty(QStringLiteral("items"), findSubstring(QStringLiteral("title"), m_substringFilter));
-    emit applicationsChanged();
+    m_listModel.setRows(m_searchIndex.match(m_substringFilter));
 }
 
 void LauncherModel::reset()
 {
-    m_list = m_root;
-    emit applicationsChanged();
+    showMenu(LauncherMenuModel::RootId);
 }
 
-void LauncherModel::select(QJSValue sel)
+QVariantMap LauncherModel::select(int row)
 {
-    QString title = sel.property(QStringLiteral("title")).toString();
-    qDebug() << title;
-    if (sel.hasOwnProperty(QStringLiteral("exec"))) {
-//qDebug() << "exec" << sel.property(QStringLiteral("exec")).toString();
-        exec(sel.property(QStringLiteral("desktopFile")).toString());
-        reset();
-    } else {
-        openSubmenu(title);
+    const int id = m_listModel.idAt(row);
+    if (id < 0)
+        return QVariantMap();
+    const LauncherEntry &sel = m_menuModel.entry(id);
+    qDebug() << sel.title;
+    if (sel.isMenu) {
+        showMenu(id);
+        return QVariantMap();
     }
+//qDebug() << "exec" << sel.exec;
+    // copied, because showing the root menu may release the entry
+    const QString desktopFile = sel.desktopFile;
+    reset();
+    return command(desktopFile);
 }
 
-void LauncherModel::exec(QString desktopFilePath)
+QVariantMap LauncherModel::command(QString desktopFilePath)
 {
-    XdgDesktopFile* dtf = XdgDesktopFileCache::getFile(desktopFilePath);
-//qDebug() << desktopFilePath << dtf;
-    if (dtf) {
-        bool ok = dtf->startDetached();
-        if (Q_UNLIKELY(!ok))
-            emit execFailed(tr("failed to exec '%s'", dtf->value(QStringLiteral("exec")).toString().toLocal8Bit().constData()));
-    } else
-        emit execFailed(tr("failed to find desktop file '%s'", desktopFilePath.toLocal8Bit().constData()));
+    // not XdgDesktopFileCache: the menu loader thread may be using it
+    XdgDesktopFile dtf;
+//qDebug() << desktopFilePath << dtf.isValid();
+    if (!dtf.load(desktopFilePath)) {
+        emit execFailed(tr("failed to find desktop file '%1'").arg(desktopFilePath));
+        return QVariantMap();
+    }
+    // the rest of what XdgDesktopFile::startDetached() did
+    QStringList command = dtf.expandExecString();
+    if (Q_UNLIKELY(command.isEmpty())) {
+        emit execFailed(tr("failed to exec '%1'").arg(dtf.value(QStringLiteral("Exec")).toString()));
+        return QVariantMap();
+    }
+    if (dtf.value(QStringLiteral("Terminal")).toBool()) {
+        const QString terminal = terminalProgram();
+        if (terminal.isEmpty()) {
+            emit execFailed(tr("no terminal found to run '%1' in").arg(command.first()));
+            return QVariantMap();
+        }
+        command = QStringList() << terminal << QStringLiteral("-e") << command;
+    }
+    QVariantMap ret;
+    ret.insert(QStringLiteral("command"), command);
+    const QString workingDirectory = dtf.value(QStringLiteral("Path")).toString();
+    if (!workingDirectory.isEmpty())
+        ret.insert(QStringLiteral("workingDirectory"), workingDirectory);
+    // the desktop file's name is the application's well-known D-Bus name
+    if (dtf.value(QStringLiteral("DBusActivatable")).toBool())
+        ret.insert(QStringLiteral("dbusName"), QFileInfo(desktopFilePath).completeBaseName());
+    return ret;
 }
 
 void LauncherModel::openSubmenu(QString title)
 {
-    m_list = findFirst(QStringLiteral("title"), title, applicationMenu());
-    emit applicationsChanged();
+    for (int id : m_listModel.rows()) {
+        const LauncherEntry &e = m_menuModel.entry(id);
+        if (e.isMenu && e.title == title) {
+            showMenu(id);
+            return;
+        }
+    }
 }
 
-void LauncherModel::build(QJSValue in, const QDomElement &xml)
+void LauncherModel::showMenu(int menuId)
 {
-    QJSValue array = m_engine->newArray();
-    in.setProperty(QStringLiteral("items"), array);
-    DomElementIterator it(xml, QString());
-    while(it.hasNext())
-    {
-        QDomElement xml = it.next();
-
-        if (xml.tagName() == "Menu")
-            appendMenu(array, xml);
+    m_currentMenu = menuId;
+    m_listModel.setRows(m_menuModel.entry(menuId).children);
+}
 
-        else if (xml.tagName() == "AppLink")
-            appendApp(array, xml);
+void LauncherModel::onMenuLoaded()
+{
+    const QVector<LauncherEntry> entries = m_loadWatcher.result();
+    if (m_loading) {
+        m_searchIndex.clear();
+        for (int id = 0; id < entries.count(); ++id) {
+            const LauncherEntry &e = entries.at(id);
+            if (!e.isMenu)
+                m_searchIndex.add(id, e.title, e.genericName, e.keywords, e.exec);
+        }
+        // the list must not refer to entries which are about to disappear
+        m_listModel.setRows(QVector<int>());
+        m_menuModel.setEntries(entries);
+        m_loading = false;
+        emit loadingChanged();
+    } else {
+        const LauncherMenuModel::Changes changes = m_menuModel.applyEntries(entries);
+        for (int id : changes.removed)
+            m_searchIndex.remove(id);
+        for (int id : changes.updated)
+            m_searchIndex.remove(id);
+        for (int id : changes.inserted + changes.updated) {
+            const LauncherEntry &e = m_menuModel.entry(id);
+            m_searchIndex.add(id, e.title, e.genericName, e.keywords, e.exec);
+        }
+        qDebug() << "menu reloaded:" << changes.inserted.count() << "added"
+                 << changes.removed.count() << "removed" << changes.updated.count() << "changed";
+        if (!m_menuModel.isValidId(m_currentMenu))
+            m_currentMenu = LauncherMenuModel::RootId;
+    }
 
-        else if (xml.tagName() == "Separator")
-            qDebug() << "separator";
+    // the user might have started typing already
+    if (m_substringFilter.isEmpty())
+        showMenu(m_currentMenu);
+    else
+        m_listModel.setRows(m_searchIndex.match(m_substringFilter));
+
+    // directories might have come or gone
+    updateWatchedPaths();
+    if (m_reloadPending) {
+        m_reloadPending = false;
+        reload();
     }
 }
 
-void LauncherModel::appendMenu(QJSValue in, const QDomElement &xml)
+void LauncherModel::onDirectoryChanged()
 {
-    QString title = xml.attribute(QStringLiteral("title"));
-    QString icon = xml.attribute(QStringLiteral("icon"));
-    int idx = in.property(QStringLiteral("length")).toInt();
-//    qDebug() << in.property(QStringLiteral("title")).toString() << ":" << title << icon << idx;
-    QJSValue menu = m_engine->newObject();
-    menu.setProperty(QStringLiteral("title"), title);
-    menu.setProperty(QStringLiteral("icon"), icon);
-    in.setProperty(idx, menu);
-    build(menu, xml);
+    // files were added, removed or renamed, or a menu fragment changed
+    m_fullReload = true;
+    m_reloadTimer.start();
 }
 
-void LauncherModel::appendApp(QJSValue in, const QDomElement &xml)
+void LauncherModel::onFileChanged(const QString &path)
 {
-    QString title = xml.attribute(QStringLiteral("title"));
-    QString icon = xml.attribute(QStringLiteral("icon"));
-    int idx = in.property(QStringLiteral("length")).toInt();
-//    qDebug() << in.property(QStringLiteral("title")).toString() << ":" << title << icon << idx;
-    QJSValue item = m_engine->newObject();
-    item.setProperty(QStringLiteral("title"), title);
-    item.setProperty(QStringLiteral("icon"), icon);
-    item.setProperty(QStringLiteral("exec"), xml.attribute(QStringLiteral("exec")));
-    item.setProperty(QStringLiteral("desktopFile"), xml.attribute(QStringLiteral("desktopFile")));
-    in.setProperty(idx, item);
-    m_allApps.setProperty(m_allAppsCount++, item);
+    // .desktop files are watched because editing one in place changes no directory
+    if (path.endsWith(QLatin1String(".desktop")))
+        m_changedDesktopFiles.insert(path);
+    else
+        m_fullReload = true;
+    m_reloadTimer.start();
 }
 
-QJSValue LauncherModel::findFirst(QString key, QString value, QJSValue array)
+void LauncherModel::reload()
 {
-    int i = 0;
-    QJSValue next = array.property(i);
-    while (!next.isUndefined()) {
-        if (next.property(key).toString() == value)
-            return next;
-        next = array.property(++i);
+    if (m_loadWatcher.isRunning()) {
+        m_reloadPending = true;
+        return;
     }
-    return QJSValue();
+    // the copy is cheap and safe to read on the worker thread, since QVector is implicitly shared
+    if (m_fullReload || m_changedDesktopFiles.isEmpty())
+        m_loadWatcher.setFuture(QtConcurrent::run(&LauncherMenuLoader::load, m_menuModel.entries()));
+    else
+        m_loadWatcher.setFuture(QtConcurrent::run(&LauncherMenuLoader::update, m_menuModel.entries(), m_changedDesktopFiles));
+    m_fullReload = false;
+    m_changedDesktopFiles.clear();
 }
 
-QJSValue LauncherModel::findSubstring(QString key, QString substr)
+void LauncherModel::updateWatchedPaths()
 {
-    QJSValue ret = m_engine->newArray();
-    int i = 0, ri = 0;
-    QJSValue next = m_allApps.property(i);
-    while (!next.isUndefined()) {
-        if (next.property(key).toString().contains(substr, Qt::CaseInsensitive))
-            ret.setProperty(ri++, next);
-        next = m_allApps.property(++i);
-    }
-    return ret;
+    QSet<QString> wanted = LauncherMenuLoader::watchedPaths().toSet();
+    for (const LauncherEntry &e : m_menuModel.entries())
+        if (!e.isMenu && !e.desktopFile.isEmpty())
+            wanted.insert(e.desktopFile);
+    const QStringList watchedList = m_fileWatcher.files() + m_fileWatcher.directories();
+    const QSet<QString> watched = watchedList.toSet();
+    QStringList gone;
+    for (const QString &p : watchedList)
+        if (!wanted.contains(p))
+            gone << p;
+    if (!gone.isEmpty())
+        m_fileWatcher.removePaths(gone);
+    QStringList added;
+    for (const QString &p : qAsConst(wanted))
+        if (!watched.contains(p))
+            added << p;
+    if (!added.isEmpty())
+        m_fileWatcher.addPaths(added);
 }
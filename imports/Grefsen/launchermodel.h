@@ -1,56 +1,75 @@
 #ifndef LAUNCHERMODEL_H
 #define LAUNCHERMODEL_H
 
-#include <QDomElement>
-#include <QJSValue>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
 #include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QVariantMap>
+
+#include "launcherlistmodel.h"
+#include "launchermenumodel.h"
+#include "launchersearchindex.h"
 
 class XdgDesktopFile;
 
 class LauncherModel : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(QJSValue allApplications READ allApplications NOTIFY applicationsChanged)
-    Q_PROPERTY(QJSValue applicationMenu READ applicationMenu NOTIFY applicationsChanged)
+    Q_PROPERTY(QAbstractItemModel *menuTree READ menuTree CONSTANT)
+    Q_PROPERTY(QAbstractItemModel *applicationMenu READ applicationMenu CONSTANT)
     Q_PROPERTY(QString substringFilter READ substringFilter WRITE setSubstringFilter NOTIFY substringFilterChanged)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
 
 
 public:
-    explicit LauncherModel(QJSEngine *engine, QObject *parent = 0);
-    QJSValue allApplications() { return m_allApps; }
-    QJSValue applicationMenu() { return m_list.property(QStringLiteral("items")); }
+    explicit LauncherModel(QObject *parent = 0);
+    QAbstractItemModel *menuTree() { return &m_menuModel; }
+    QAbstractItemModel *applicationMenu() { return &m_listModel; }
 
     QString substringFilter() const { return m_substringFilter; }
     void setSubstringFilter(QString substringFilter);
 
+    bool isLoading() const { return m_loading; }
+
 signals:
-    void applicationsChanged();
     void substringFilterChanged();
+    void loadingChanged();
     void execFailed(QString error);
 
 public slots:
     void reset();
-    void select(QJSValue sel);
-    void exec(QString desktopFilePath);
+    // what LaunchService.launchEntry() needs: the command, and the working directory and
+    // D-Bus name if the desktop file has them; empty for a submenu or on errors
+    QVariantMap select(int row);
+    QVariantMap command(QString desktopFilePath);
     void openSubmenu(QString title);
 
 
+protected slots:
+    void onMenuLoaded();
+    void onDirectoryChanged();
+    void onFileChanged(const QString &path);
+    void reload();
+
 protected:
-    void build(QJSValue in, const QDomElement& xml);
-    void appendMenu(QJSValue in, const QDomElement& xml);
-    void appendApp(QJSValue in, const QDomElement &xml);
-    QJSValue findFirst(QString key, QString value, QJSValue array);
-    QJSValue findSubstring(QString key, QString substr);
+    void showMenu(int menuId);
+    void updateWatchedPaths();
 
 protected:
-//    static QList<XdgDesktopFile *> m_allFiles;
-    QJSEngine *m_engine;
-    QDomElement m_dom;
-    QJSValue m_root;
-    QJSValue m_list;
-    QJSValue m_allApps;
-    int m_allAppsCount = 0;
+    QFutureWatcher<QVector<LauncherEntry> > m_loadWatcher;
+    QFileSystemWatcher m_fileWatcher;
+    QTimer m_reloadTimer;
+    LauncherMenuModel m_menuModel;
+    LauncherListModel m_listModel;
+    int m_currentMenu = LauncherMenuModel::RootId;
+    LauncherSearchIndex m_searchIndex;
     QString m_substringFilter;
+    bool m_loading = true;
+    QSet<QString> m_changedDesktopFiles; // if nothing else changed
+    bool m_reloadPending = false;
+    bool m_fullReload = false;
 };
 
 #endif // LAUNCHERMODEL_H
@@ -0,0 +1,158 @@
+#include "launchersearchindex.h"
+
+#include <QFileInfo>
+#include <algorithm>
+
+static const QChar FieldSeparator('\n');
+
+static QString execName(const QString &exec)
+{
+    QString program = exec.section(QLatin1Char(' '), 0, 0, QString::SectionSkipEmpty);
+    return QFileInfo(program).fileName();
+}
+
+static inline bool isWordStart(const QStringRef &text, int pos)
+{
+    return pos == 0 || !text.at(pos - 1).isLetterOrNumber();
+}
+
+static bool containsWordStart(const QStringRef &text, const QString &query)
+{
+    int pos = text.indexOf(query);
+    while (pos >= 0) {
+        if (isWordStart(text, pos))
+            return true;
+        pos = text.indexOf(query, pos + 1);
+    }
+    return false;
+}
+
+static bool containsFuzzy(const QStringRef &text, const QString &query)
+{
+    int qi = 0;
+    const int qlen = query.length();
+    for (int i = 0, len = text.length(); i < len && qi < qlen; ++i)
+        if (text.at(i) == query.at(qi))
+            ++qi;
+    return qi == qlen;
+}
+
+void LauncherSearchIndex::clear()
+{
+    m_text.clear();
+    m_records.clear();
+    m_removedCount = 0;
+    forgetLastQuery();
+}
+
+void LauncherSearchIndex::add(int id, const QString &title, const QString &genericName,
+                              const QStringList &keywords, const QString &exec)
+{
+    Record r;
+    r.id = id;
+    r.offset = m_text.length();
+    m_text += title.toLower();
+    r.titleLength = m_text.length() - r.offset;
+    if (!genericName.isEmpty())
+        m_text += FieldSeparator + genericName.toLower();
+    for (const QString &k : keywords)
+        m_text += FieldSeparator + k.toLower();
+    QString name = execName(exec);
+    if (!name.isEmpty())
+        m_text += FieldSeparator + name.toLower();
+    r.length = m_text.length() - r.offset;
+    m_records.append(r);
+    forgetLastQuery();
+}
+
+void LauncherSearchIndex::remove(int id)
+{
+    for (Record &r : m_records) {
+        if (r.id == id) {
+            r.id = -1;
+            ++m_removedCount;
+        }
+    }
+    if (m_removedCount > m_records.count() / 2)
+        compact();
+    forgetLastQuery();
+}
+
+QVector<int> LauncherSearchIndex::match(const QString &query)
+{
+    const QString q = query.toLower();
+    QVector<int> candidates;
+    if (!m_lastQuery.isEmpty() && q.startsWith(m_lastQuery)) {
+        candidates = m_lastMatches;
+    } else {
+        candidates.reserve(m_records.count());
+        for (int i = 0; i < m_records.count(); ++i)
+            if (m_records.at(i).id >= 0)
+                candidates.append(i);
+    }
+
+    QVector<QPair<int, int> > ranked; // rank, record index
+    ranked.reserve(candidates.count());
+    for (int i : candidates) {
+        Rank rk = rank(m_records.at(i), q);
+        if (rk != NoMatch)
+            ranked.append(qMakePair(int(rk), i));
+    }
+    // stable, to keep menu order within each rank
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const QPair<int, int> &a, const QPair<int, int> &b) { return a.first < b.first; });
+
+    QVector<int> ret;
+    ret.reserve(ranked.count());
+    m_lastMatches.clear();
+    m_lastMatches.reserve(ranked.count());
+    for (const QPair<int, int> &p : ranked) {
+        ret.append(m_records.at(p.second).id);
+        m_lastMatches.append(p.second);
+    }
+    m_lastQuery = q;
+    return ret;
+}
+
+LauncherSearchIndex::Rank LauncherSearchIndex::rank(const Record &record, const QString &query) const
+{
+    const QStringRef title = m_text.midRef(record.offset, record.titleLength);
+    if (title.startsWith(query))
+        return TitlePrefix;
+    if (containsWordStart(title, query))
+        return TitleWordStart;
+    const QStringRef all = m_text.midRef(record.offset, record.length);
+    // a field separator counts as a word boundary too
+    if (containsWordStart(all, query))
+        return WordStart;
+    if (all.contains(query))
+        return Substring;
+    if (containsFuzzy(all, query))
+        return Fuzzy;
+    return NoMatch;
+}
+
+void LauncherSearchIndex::compact()
+{
+    QString text;
+    text.reserve(m_text.length());
+    QVector<Record> records;
+    records.reserve(m_records.count() - m_removedCount);
+    for (const Record &r : qAsConst(m_records)) {
+        if (r.id < 0)
+            continue;
+        Record c = r;
+        c.offset = text.length();
+        text += m_text.midRef(r.offset, r.length);
+        records.append(c);
+    }
+    m_text = text;
+    m_records = records;
+    m_removedCount = 0;
+}
+
+void LauncherSearchIndex::forgetLastQuery()
+{
+    m_lastQuery.clear();
+    m_lastMatches.clear();
+}
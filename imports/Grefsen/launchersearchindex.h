@@ -0,0 +1,63 @@
+#ifndef LAUNCHERSEARCHINDEX_H
+#define LAUNCHERSEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+    Search index over the launchable applications.
+
+    The lowercased searchable text of all entries (title, generic name,
+    keywords and the name of the executable) is kept in one flat string,
+    with a small fixed-size record per entry pointing into it.  match()
+    returns the ids of matching entries ranked by how well they match:
+    title prefix first, then the start of a word in the title, the start of a
+    word anywhere else, any substring, and finally a fuzzy match where the
+    query characters only appear in the same order.
+
+    When the query extends the previous one, only the previous matches are
+    checked again, since an entry which did not match a shorter query cannot
+    match a longer one.
+*/
+class LauncherSearchIndex
+{
+public:
+    void clear();
+    void add(int id, const QString &title, const QString &genericName,
+             const QStringList &keywords, const QString &exec);
+    void remove(int id);
+    int count() const { return m_records.count() - m_removedCount; }
+
+    QVector<int> match(const QString &query);
+
+protected:
+    struct Record {
+        int id;          // -1 if removed
+        int offset;      // into m_text
+        int titleLength;
+        int length;      // of all the fields, including separators
+    };
+
+    enum Rank {
+        TitlePrefix = 0,
+        TitleWordStart,
+        WordStart,
+        Substring,
+        Fuzzy,
+        NoMatch
+    };
+
+    Rank rank(const Record &record, const QString &query) const;
+    void compact();
+    void forgetLastQuery();
+
+protected:
+    QString m_text;
+    QVector<Record> m_records;
+    int m_removedCount = 0;
+    QString m_lastQuery;
+    QVector<int> m_lastMatches; // indices into m_records which matched m_lastQuery
+};
+
+#endif // LAUNCHERSEARCHINDEX_H
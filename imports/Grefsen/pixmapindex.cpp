@@ -0,0 +1,68 @@
+#include "pixmapindex.h"
+
+#include <algorithm>
+
+PixmapIndex::PixmapIndex(const QString &path, QObject *parent)
+  : QObject(parent)
+  , m_dir(path)
+  , m_dirty(1)
+{
+    if (m_dir.exists())
+        m_watcher.addPath(m_dir.absolutePath());
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &PixmapIndex::invalidate);
+}
+
+/*!
+    Returns the path of the first file (in name order) whose name starts with
+    \a prefix, like QDir::entryList() with a "prefix*" glob would; or an empty
+    string if there is none.
+*/
+QString PixmapIndex::find(const QString &prefix)
+{
+    ensureBuilt();
+    QReadLocker lock(&m_lock);
+    auto it = std::lower_bound(m_names.constBegin(), m_names.constEnd(), prefix);
+    if (it == m_names.constEnd() || !it->startsWith(prefix))
+        return QString();
+    return m_dir.filePath(*it);
+}
+
+bool PixmapIndex::isKnownMiss(const QString &id)
+{
+    ensureBuilt();
+    QReadLocker lock(&m_lock);
+    return m_misses.contains(id);
+}
+
+void PixmapIndex::addMiss(const QString &id)
+{
+    QWriteLocker lock(&m_lock);
+    m_misses.insert(id);
+}
+
+void PixmapIndex::clearMisses()
+{
+    QWriteLocker lock(&m_lock);
+    m_misses.clear();
+}
+
+void PixmapIndex::invalidate()
+{
+    m_dirty.storeRelease(1);
+    // the watch is lost if the directory was removed and recreated
+    if (m_watcher.directories().isEmpty() && m_dir.exists())
+        m_watcher.addPath(m_dir.absolutePath());
+}
+
+void PixmapIndex::ensureBuilt()
+{
+    if (!m_dirty.loadAcquire())
+        return;
+    QWriteLocker lock(&m_lock);
+    if (!m_dirty.testAndSetOrdered(1, 0))
+        return; // another thread got here first
+    m_names = m_dir.entryList(QDir::Files, QDir::NoSort);
+    std::sort(m_names.begin(), m_names.end());
+    // something new might have been installed
+    m_misses.clear();
+}
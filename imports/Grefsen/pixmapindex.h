@@ -0,0 +1,50 @@
+#ifndef PIXMAPINDEX_H
+#define PIXMAPINDEX_H
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
+
+/*!
+    Sorted index of the file names in a directory such as /usr/share/pixmaps,
+    for finding an icon by prefix without scanning the directory every time.
+
+    The index is built on first use and rebuilt lazily after the
+    QFileSystemWatcher reports a change.  It also remembers the ids which
+    could not be found anywhere, so that repeated misses are cheap too,
+    until the directory changes or clearMisses() is called (when the icon
+    theme has changed, say).
+    find() and the miss functions may be called from any thread.
+*/
+class PixmapIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PixmapIndex(const QString &path, QObject *parent = 0);
+
+    QString find(const QString &prefix);
+
+    bool isKnownMiss(const QString &id);
+    void addMiss(const QString &id);
+    void clearMisses();
+
+protected slots:
+    void invalidate();
+
+protected:
+    void ensureBuilt();
+
+protected:
+    QDir m_dir;
+    QFileSystemWatcher m_watcher;
+    QReadWriteLock m_lock;
+    QStringList m_names; // sorted, guarded by m_lock
+    QSet<QString> m_misses; // guarded by m_lock
+    QAtomicInt m_dirty;
+};
+
+#endif // PIXMAPINDEX_H
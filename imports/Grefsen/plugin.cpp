@@ -6,14 +6,20 @@
 #include <QQmlExtensionPlugin>
 #include <QtQml>
 
+#include "connmanmodel.h"
+#include "glyphprovider.h"
 #include "hoverarea.h"
 #include "iconprovider.h"
 #include "launchermodel.h"
+#include "popoverregistry.h"
+#include "tracescope.h"
+#include "wallclock.h"
+#include "wallpaperprovider.h"
 
 Q_LOGGING_CATEGORY(lcRegistration, "grefsen.registration")
+Q_LOGGING_CATEGORY(lcTrace, "grefsen.trace", QtWarningMsg)
 
 static const char *ModuleName = "Grefsen";
-static QJSValue launcherModelSingleton;
 
 static QString ensureFinalSlash(const QString &path)
 {
@@ -37,13 +43,31 @@ static QJSValue environmentSingletonProvider(QQmlEngine *engine, QJSEngine *scri
     return v;
 }
 
-static QJSValue launcherModelSingletonProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
+static QObject *launcherModelSingletonProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
 {
     Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
 
-    if (launcherModelSingleton.isUndefined())
-        launcherModelSingleton = scriptEngine->newQObject(new LauncherModel(scriptEngine));
-    return launcherModelSingleton;
+    TraceScope trace("LauncherModel construction");
+    return new LauncherModel;
+}
+
+static QObject *wallClockSingletonProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
+{
+    Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
+
+    QQmlEngine::setObjectOwnership(WallClock::instance(), QQmlEngine::CppOwnership);
+    return WallClock::instance();
+}
+
+static QObject *popoverRegistrySingletonProvider(QQmlEngine *engine, QJSEngine *scriptEngine)
+{
+    Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
+
+    QQmlEngine::setObjectOwnership(PopoverRegistry::instance(), QQmlEngine::CppOwnership);
+    return PopoverRegistry::instance();
 }
 
 class GrefsenPlugin : public QQmlExtensionPlugin
@@ -57,15 +81,29 @@ public:
     virtual void initializeEngine(QQmlEngine *engine, const char * uri) {
         Q_UNUSED(engine)
         qCDebug(lcRegistration) << uri;
+        TraceScope trace("Grefsen plugin: initializeEngine");
         engine->addImageProvider(QLatin1String("icon"), new IconProvider);
+        engine->addImageProvider(QLatin1String("wallpaper"), new WallpaperProvider);
+        // the compositor has its own, which prewarms the glyphs of its Chrome too
+        if (!engine->imageProvider(QLatin1String("glyph"))) {
+            GlyphProvider *glyphs = new GlyphProvider;
+            glyphs->prewarm(QStringLiteral("f00d/white"), 36); // QuitButton
+            engine->addImageProvider(QLatin1String("glyph"), glyphs);
+        }
     }
 
     virtual void registerTypes(const char *uri) {
         qCDebug(lcRegistration) << uri;
         Q_ASSERT(uri == QLatin1String(ModuleName));
+        TraceScope trace("Grefsen plugin: registerTypes");
         qmlRegisterType<HoverArea>(uri, 1, 0, "HoverArea");
+        qmlRegisterType<ClockTimer>(uri, 1, 0, "ClockTimer");
+        qmlRegisterType<ConnmanTechnologyModel>(uri, 1, 0, "ConnmanTechnologyModel");
+        qmlRegisterType<ConnmanServiceModel>(uri, 1, 0, "ConnmanServiceModel");
         qmlRegisterSingletonType(ModuleName, 1, 0, "Env", environmentSingletonProvider);
-        qmlRegisterSingletonType(ModuleName, 1, 0, "LauncherModel", launcherModelSingletonProvider);
+        qmlRegisterSingletonType<LauncherModel>(ModuleName, 1, 0, "LauncherModel", launcherModelSingletonProvider);
+        qmlRegisterSingletonType<WallClock>(ModuleName, 1, 0, "WallClock", wallClockSingletonProvider);
+        qmlRegisterSingletonType<PopoverRegistry>(ModuleName, 1, 0, "PopoverRegistry", popoverRegistrySingletonProvider);
     }
 };
 
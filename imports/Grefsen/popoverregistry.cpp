@@ -0,0 +1,37 @@
+#include "popoverregistry.h"
+
+#include <QQuickItem>
+#include <QQuickWindow>
+
+static const int DefaultIdleTimeout = 60 * 1000; // ms
+
+PopoverRegistry *PopoverRegistry::instance()
+{
+    static PopoverRegistry *ret = new PopoverRegistry;
+    return ret;
+}
+
+PopoverRegistry::PopoverRegistry()
+    : m_idleTimeout(DefaultIdleTimeout)
+{
+}
+
+void PopoverRegistry::setIdleTimeout(int ms)
+{
+    if (m_idleTimeout == ms)
+        return;
+    m_idleTimeout = ms;
+    emit idleTimeoutChanged();
+}
+
+QQuickItem *PopoverRegistry::glassPane(QQuickWindow *window) const
+{
+    if (!window)
+        return 0;
+    return window->contentItem()->findChild<QQuickItem *>(QStringLiteral("glassPane"));
+}
+
+void PopoverRegistry::releaseAll()
+{
+    emit releaseRequested();
+}
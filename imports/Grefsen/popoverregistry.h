@@ -0,0 +1,50 @@
+#ifndef POPOVERREGISTRY_H
+#define POPOVERREGISTRY_H
+
+#include <QObject>
+
+class QQuickItem;
+class QQuickWindow;
+
+/*!
+    Shared state of the PopoverLoaders on all outputs.
+
+    Popovers are created on demand: a PopoverLoader starts incubating its
+    popover asynchronously as soon as the pointer enters the panel which it
+    is in, so that it is usually ready by the time it's clicked, and
+    releases it after it has been closed for idleTimeout ms, or when
+    releaseAll() is called.  An item can only be shown in one window, so
+    each output gets its own instance; but only on outputs where the
+    popover is actually used, and the compiled component is shared.
+
+    glassPane() finds the glassPane item of a given window, so that each
+    popover is shown above everything on its own output.
+*/
+class PopoverRegistry : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int idleTimeout READ idleTimeout WRITE setIdleTimeout NOTIFY idleTimeoutChanged)
+
+public:
+    static PopoverRegistry *instance();
+
+    int idleTimeout() const { return m_idleTimeout; }
+    void setIdleTimeout(int ms);
+
+    Q_INVOKABLE QQuickItem *glassPane(QQuickWindow *window) const;
+
+public slots:
+    void releaseAll();
+
+signals:
+    void idleTimeoutChanged();
+    void releaseRequested();
+
+protected:
+    PopoverRegistry();
+
+protected:
+    int m_idleTimeout;
+};
+
+#endif // POPOVERREGISTRY_H
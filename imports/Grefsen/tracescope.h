@@ -0,0 +1,37 @@
+#ifndef TRACESCOPE_H
+#define TRACESCOPE_H
+
+#include <QLoggingCategory>
+#include <time.h>
+
+Q_DECLARE_LOGGING_CATEGORY(lcTrace)
+
+/*!
+    Times the enclosing scope for the compositor's --trace output, by
+    sending "<start µs> <duration µs> <name>" to the grefsen.trace logging
+    category, which the compositor only enables while tracing.
+*/
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name), m_start(lcTrace().isDebugEnabled() ? now() : 0) { }
+    ~TraceScope()
+    {
+        if (m_start)
+            qCDebug(lcTrace, "%lld %lld %s", m_start, now() - m_start, m_name);
+    }
+
+    static qint64 now()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+private:
+    const char *m_name;
+    qint64 m_start;
+};
+
+#endif // TRACESCOPE_H
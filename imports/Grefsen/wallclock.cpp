@@ -0,0 +1,188 @@
+#include "wallclock.h"
+
+#include <QDateTime>
+#include <QMetaProperty>
+#include <QQuickItem>
+#include <QQuickWindow>
+
+static const int SecondsPerDay = 24 * 60 * 60;
+
+static QString twoDigits(int n)
+{
+    // shared, so that the seconds don't allocate a string every time
+    static QStringList table;
+    if (table.isEmpty())
+        for (int i = 0; i < 60; ++i)
+            table << QString::number(i).rightJustified(2, QLatin1Char('0'));
+    return n >= 0 && n < table.count() ? table.at(n) : QString();
+}
+
+WallClock *WallClock::instance()
+{
+    static WallClock *ret = new WallClock;
+    return ret;
+}
+
+WallClock::WallClock()
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer); // a coarse timer may fire before the boundary
+    connect(&m_timer, &QTimer::timeout, this, &WallClock::onTimeout);
+}
+
+QString WallClock::secondText() const
+{
+    return twoDigits(m_second);
+}
+
+void WallClock::setTimerActive(ClockTimer *timer, bool active)
+{
+    if (active == m_active.contains(timer))
+        return;
+    if (active) {
+        m_active << timer;
+        // it may have been a while since anyone looked
+        update();
+        timer->scheduleAfter(QDateTime::currentMSecsSinceEpoch());
+    } else {
+        m_active.removeOne(timer);
+    }
+    reschedule();
+}
+
+void WallClock::reschedule()
+{
+    if (m_active.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+    qint64 next = m_active.first()->due();
+    for (const ClockTimer *timer : m_active)
+        next = qMin(next, timer->due());
+    m_timer.start(int(qBound<qint64>(0, next - QDateTime::currentMSecsSinceEpoch(), SecondsPerDay * 1000)));
+}
+
+void WallClock::onTimeout()
+{
+    update();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    // a handler may stop its own or another timer
+    const QVector<ClockTimer *> active = m_active;
+    for (ClockTimer *timer : active) {
+        if (timer->due() <= now && m_active.contains(timer)) {
+            timer->scheduleAfter(now);
+            emit timer->triggered();
+        }
+    }
+    reschedule();
+}
+
+void WallClock::update()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    const QTime time = now.time();
+    const QDate date = now.date();
+    if (date != m_date) {
+        m_date = date;
+        m_dateText = date.toString(QStringLiteral("yyyy.MM.dd"));
+        emit dateChanged();
+    }
+    if (time.minute() != m_minute || time.hour() != m_hour) {
+        m_minute = time.minute();
+        m_hour = time.hour();
+        m_timeText = twoDigits(m_hour) + QLatin1Char(':') + twoDigits(m_minute);
+        emit minuteChanged();
+    }
+    if (time.second() != m_second) {
+        m_second = time.second();
+        emit secondChanged();
+    }
+}
+
+ClockTimer::ClockTimer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ClockTimer::~ClockTimer()
+{
+    WallClock::instance()->setTimerActive(this, false);
+}
+
+void ClockTimer::setInterval(int seconds)
+{
+    seconds = qBound(1, seconds, SecondsPerDay);
+    if (m_interval == seconds)
+        return;
+    m_interval = seconds;
+    emit intervalChanged();
+    if (m_active) {
+        scheduleAfter(QDateTime::currentMSecsSinceEpoch());
+        WallClock::instance()->reschedule();
+    }
+}
+
+void ClockTimer::setRunning(bool running)
+{
+    if (m_running == running)
+        return;
+    m_running = running;
+    emit runningChanged();
+    updateActive();
+}
+
+void ClockTimer::scheduleAfter(qint64 nowMs)
+{
+    // the next whole multiple of the interval in local time, after now
+    const QDateTime now = QDateTime::fromMSecsSinceEpoch(nowMs);
+    const qint64 offsetMs = qint64(now.offsetFromUtc()) * 1000;
+    const qint64 intervalMs = qint64(m_interval) * 1000;
+    m_due = ((nowMs + offsetMs) / intervalMs + 1) * intervalMs - offsetMs;
+}
+
+void ClockTimer::componentComplete()
+{
+    m_complete = true;
+    m_item = qobject_cast<QQuickItem *>(parent());
+    if (m_item) {
+        connect(m_item.data(), &QQuickItem::visibleChanged, this, &ClockTimer::updateActive);
+        connect(m_item.data(), &QQuickItem::windowChanged, this, &ClockTimer::onWindowChanged);
+        onWindowChanged(m_item->window());
+        for (QQuickItem *ancestor = m_item; ancestor && !m_panel; ancestor = ancestor->parentItem()) {
+            const int index = ancestor->metaObject()->indexOfProperty("showing");
+            if (index < 0)
+                continue;
+            const QMetaProperty showing = ancestor->metaObject()->property(index);
+            if (showing.hasNotifySignal()) {
+                m_panel = ancestor;
+                connect(ancestor, showing.notifySignal(), this,
+                        metaObject()->method(metaObject()->indexOfSlot("updateActive()")));
+            }
+        }
+    }
+    updateActive();
+}
+
+void ClockTimer::onWindowChanged(QQuickWindow *window)
+{
+    if (m_window)
+        disconnect(m_window.data(), &QWindow::visibleChanged, this, &ClockTimer::updateActive);
+    m_window = window;
+    if (window)
+        connect(window, &QWindow::visibleChanged, this, &ClockTimer::updateActive);
+    updateActive();
+}
+
+void ClockTimer::updateActive()
+{
+    bool active = m_complete && m_running;
+    if (active && m_item)
+        active = m_item->isVisible() && m_window && m_window->isVisible();
+    if (active && m_panel)
+        active = m_panel->property("showing").toBool();
+    if (m_active == active)
+        return;
+    m_active = active;
+    WallClock::instance()->setTimerActive(this, active);
+    emit activeChanged();
+}
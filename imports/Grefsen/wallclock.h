@@ -0,0 +1,133 @@
+#ifndef WALLCLOCK_H
+#define WALLCLOCK_H
+
+#include <QDate>
+#include <QObject>
+#include <QPointer>
+#include <QQmlParserStatus>
+#include <QTimer>
+#include <QVector>
+
+class ClockTimer;
+class QQuickItem;
+class QQuickWindow;
+
+/*!
+    The local time, for clocks and other panel widgets, with one wakeup for
+    all of them.
+
+    The properties change exactly at the wall-clock boundaries, and each
+    kind has a separate signal, so that a binding to the date is evaluated
+    once a day rather than every second.  The clock has no timer of its
+    own: the properties are updated whenever an active ClockTimer fires, so
+    a clock showing seconds needs a ClockTimer with an interval of 1.  A
+    single-shot timer is aimed at the next due time of all the active
+    ClockTimers, so timers which share a boundary also share the wakeup; with
+    no active ClockTimers, nothing wakes up at all.
+*/
+class WallClock : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int second READ second NOTIFY secondChanged)
+    Q_PROPERTY(int minute READ minute NOTIFY minuteChanged)
+    Q_PROPERTY(int hour READ hour NOTIFY minuteChanged)
+    Q_PROPERTY(QDate date READ date NOTIFY dateChanged)
+    // preformatted, so that bindings don't need to build strings: "ss", "hh:mm", "yyyy.MM.dd"
+    Q_PROPERTY(QString secondText READ secondText NOTIFY secondChanged)
+    Q_PROPERTY(QString timeText READ timeText NOTIFY minuteChanged)
+    Q_PROPERTY(QString dateText READ dateText NOTIFY dateChanged)
+
+public:
+    static WallClock *instance();
+
+    int second() const { return m_second; }
+    int minute() const { return m_minute; }
+    int hour() const { return m_hour; }
+    QDate date() const { return m_date; }
+    QString secondText() const;
+    QString timeText() const { return m_timeText; }
+    QString dateText() const { return m_dateText; }
+
+    void setTimerActive(ClockTimer *timer, bool active);
+    void reschedule();
+
+signals:
+    void secondChanged();
+    void minuteChanged();
+    void dateChanged();
+
+protected slots:
+    void onTimeout();
+
+protected:
+    WallClock();
+
+    void update();
+
+protected:
+    QVector<ClockTimer *> m_active;
+    QTimer m_timer;
+    int m_second = -1;
+    int m_minute = -1;
+    int m_hour = -1;
+    QDate m_date;
+    QString m_timeText;
+    QString m_dateText;
+};
+
+/*!
+    Fires at wall-clock boundaries: every interval seconds, at whole
+    multiples of it in local time (so 60 means on the minute, and 86400 at
+    midnight), sharing the wakeup with every other ClockTimer.
+
+    It pauses on its own while the item it belongs to is not visible, or its
+    window is not shown, or an ancestor with a "showing" property (like
+    LeftSlidePanel) is not showing; and also when running is false.  A
+    ClockTimer which is active also keeps the WallClock properties current.
+*/
+class ClockTimer : public QObject, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
+    Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    Q_PROPERTY(bool running READ running WRITE setRunning NOTIFY runningChanged)
+    Q_PROPERTY(bool active READ isActive NOTIFY activeChanged)
+
+public:
+    explicit ClockTimer(QObject *parent = 0);
+    ~ClockTimer();
+
+    int interval() const { return m_interval; }
+    void setInterval(int seconds);
+    bool running() const { return m_running; }
+    void setRunning(bool running);
+    bool isActive() const { return m_active; }
+
+    qint64 due() const { return m_due; }
+    void scheduleAfter(qint64 nowMs);
+
+    void classBegin() Q_DECL_OVERRIDE { }
+    void componentComplete() Q_DECL_OVERRIDE;
+
+signals:
+    void triggered();
+    void intervalChanged();
+    void runningChanged();
+    void activeChanged();
+
+protected slots:
+    void updateActive();
+    void onWindowChanged(QQuickWindow *window);
+
+protected:
+    QPointer<QQuickItem> m_item;
+    QPointer<QQuickWindow> m_window;
+    QPointer<QObject> m_panel;
+    qint64 m_due = 0; // ms since the epoch
+    int m_interval = 1;
+    bool m_running = true;
+    bool m_active = false;
+    bool m_complete = false;
+};
+
+#endif // WALLCLOCK_H
@@ -0,0 +1,139 @@
+#include "wallpaperprovider.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <utime.h>
+
+static const qint64 PruneAge = 7LL * 24 * 60 * 60 * 1000; // ms since a cached image was last used
+
+class WallpaperResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    WallpaperResponse(const QString &path, const QSize &requestedSize, WallpaperProvider *provider)
+      : m_path(path)
+      , m_requestedSize(requestedSize)
+      , m_provider(provider)
+    {
+        setAutoDelete(false);
+    }
+
+    QQuickTextureFactory *textureFactory() const Q_DECL_OVERRIDE
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    QString errorString() const Q_DECL_OVERRIDE
+    {
+        return m_image.isNull() ? QLatin1String("failed to load wallpaper ") + m_path : QString();
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        m_image = m_provider->image(m_path, m_requestedSize);
+        emit finished();
+    }
+
+protected:
+    QString m_path;
+    QSize m_requestedSize;
+    WallpaperProvider *m_provider;
+    QImage m_image;
+};
+
+WallpaperProvider::WallpaperProvider()
+  : m_diskDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+              QLatin1String("/grefsen/wallpapers/"))
+{
+    if (!QDir().mkpath(m_diskDir)) {
+        qWarning() << "failed to create wallpaper cache directory" << m_diskDir;
+        m_diskDir.clear();
+    }
+    // usually there is only one wallpaper; more threads would just compete for memory bandwidth
+    m_pool.setMaxThreadCount(2);
+}
+
+QQuickImageResponse *WallpaperProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    WallpaperResponse *response = new WallpaperResponse(id, requestedSize, this);
+    m_pool.start(response);
+    return response;
+}
+
+QImage WallpaperProvider::image(const QString &path, const QSize &requestedSize)
+{
+    const QString cached = diskPath(path, requestedSize);
+    if (!cached.isEmpty() && QFileInfo::exists(cached)) {
+        QImage ret(cached);
+        if (!ret.isNull()) {
+            // still in use: see pruneDiskCache()
+            utime(QFile::encodeName(cached).constData(), 0);
+            pruneDiskCache();
+            return ret;
+        }
+    }
+
+    QImageReader reader(path);
+    QSize size = reader.size();
+    if (!size.isValid()) {
+        qWarning() << "failed to read wallpaper" << path << reader.errorString();
+        return QImage();
+    }
+    if (!requestedSize.isEmpty()) {
+        // cover the requested size, then cut off what sticks out on either side
+        const QSize scaled = size.scaled(requestedSize, Qt::KeepAspectRatioByExpanding);
+        reader.setScaledSize(scaled);
+        reader.setScaledClipRect(QRect(QPoint((scaled.width() - requestedSize.width()) / 2,
+                                              (scaled.height() - requestedSize.height()) / 2), requestedSize));
+    }
+    QImage ret = reader.read();
+    if (ret.isNull()) {
+        qWarning() << "failed to decode wallpaper" << path << reader.errorString();
+        return ret;
+    }
+
+    if (!cached.isEmpty()) {
+        QSaveFile f(cached);
+        if (!f.open(QIODevice::WriteOnly) || !ret.save(&f, "PNG") || !f.commit())
+            qWarning() << "failed to write wallpaper cache file" << cached;
+        pruneDiskCache();
+    }
+    return ret;
+}
+
+/*!
+    Removes the cached images which have not been used for PruneAge ms.
+    Done once per run, after the first wallpaper has been cached or found
+    in the cache.
+*/
+void WallpaperProvider::pruneDiskCache()
+{
+    if (!m_pruned.testAndSetOrdered(0, 1))
+        return;
+    const QDateTime oldest = QDateTime::currentDateTime().addMSecs(-PruneAge);
+    QDir dir(m_diskDir);
+    const QFileInfoList files = dir.entryInfoList(QStringList() << QStringLiteral("*.png") << QStringLiteral("*.jpg"), QDir::Files);
+    for (const QFileInfo &fi : files) {
+        if (fi.lastModified() < oldest && !dir.remove(fi.fileName()))
+            qWarning() << "failed to remove stale wallpaper cache file" << fi.absoluteFilePath();
+    }
+}
+
+QString WallpaperProvider::diskPath(const QString &path, const QSize &requestedSize) const
+{
+    if (m_diskDir.isEmpty())
+        return QString();
+    const QString key = path + QLatin1Char('@') +
+            QString::number(QFileInfo(path).lastModified().toMSecsSinceEpoch()) + QLatin1Char('/') +
+            QString::number(requestedSize.width()) + QLatin1Char('x') + QString::number(requestedSize.height());
+    return m_diskDir + QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(),
+            QCryptographicHash::Sha1).toHex()) + QLatin1String(".png");
+}
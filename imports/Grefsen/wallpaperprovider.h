@@ -0,0 +1,45 @@
+#ifndef WALLPAPERPROVIDER_H
+#define WALLPAPERPROVIDER_H
+
+#include <QAtomicInt>
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+
+/*!
+    Provides wallpaper images, decoded off the GUI thread at exactly the
+    requested size: the image is scaled to cover the requested size and the
+    overhang is cropped, as Image.PreserveAspectCrop would.  The scaling is
+    done by the image reader, so that JPEG decoding can use DCT scaling and
+    never holds the full-resolution image in memory.
+
+    The results are cached in ~/.cache/grefsen/wallpapers, keyed on the
+    file, its age and the size, so that the next start only has to decode
+    an image of the size of the output.  The cache is PNG, so that it is
+    lossless and keeps the alpha channel.  A cached image's modification time
+    is set whenever it is used, and once per run the images which have not
+    been used for a week are removed: those of wallpapers which are no
+    longer configured, of older versions of the files, and of screen sizes
+    which are gone.
+
+    The id is the absolute path of the image file.
+*/
+class WallpaperProvider : public QQuickAsyncImageProvider
+{
+public:
+    WallpaperProvider();
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) Q_DECL_OVERRIDE;
+
+    QImage image(const QString &path, const QSize &requestedSize);
+
+protected:
+    QString diskPath(const QString &path, const QSize &requestedSize) const;
+    void pruneDiskCache();
+
+protected:
+    QString m_diskDir;
+    QThreadPool m_pool;
+    QAtomicInt m_pruned;
+};
+
+#endif // WALLPAPERPROVIDER_H